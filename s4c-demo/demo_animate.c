@@ -46,7 +46,7 @@ typedef enum Screen { LOGO = 0, GAMEPLAY, ENDING } Screen;
  * @see animate_file()
  * @return Result of the animation.
  */
-int demo(FILE* mainthread_file, FILE* newthread_file)
+int demo(FILE* sprites_file)
 {
 
     printf("\n\n\t\tDEMO for ");
@@ -152,7 +152,7 @@ int demo(FILE* mainthread_file, FILE* newthread_file)
 
     // Prepare the frames
     char sprites[S4C_MAXFRAMES][S4C_MAXROWS][S4C_MAXCOLS];
-    int loadCheck = s4c_load_sprites(sprites, mainthread_file, num_frames, frame_height-1, frame_width-1);
+    int loadCheck = s4c_load_sprites(sprites, sprites_file, num_frames, frame_height-1, frame_width-1);
 
     // Check for possible loadCheck() errors and in this case we return early if we couldn't load
     if (loadCheck < 0) {
@@ -174,8 +174,11 @@ int demo(FILE* mainthread_file, FILE* newthread_file)
 
 #ifndef S4C_RAYLIB_EXTENSION
 
-    while (s4c_check_win(stdscr, frame_height, frame_width, 1, 1) != 0) {
-        mvwprintw(stdscr, 3, 2, "Window too small, please resize your terminal.\n");
+    bool clip_sprites = false;
+    if (s4c_check_win(stdscr, frame_height, frame_width, 1, 1) != 0) {
+        // We don't wait for a resize: sprites will be drawn clipped to the window where possible
+        clip_sprites = true;
+        mvwprintw(stdscr, 3, 2, "Window too small, sprites will be clipped.\n");
         mvwprintw(stdscr, 4, 2, "[ Press Enter to continue.\n");
         wrefresh(stdscr);
     }
@@ -293,8 +296,12 @@ int demo(FILE* mainthread_file, FILE* newthread_file)
     wrefresh(stdscr);
     wclear(w);
     // Then we call the animation function with all the needed arguments
-
-    result = s4c_animate_sprites(sprites, w, reps, frametime, num_frames, frame_height, frame_width);
+    // There is no clipped s4c_animate_sprites(), so the whole range is played clipped instead
+    if (clip_sprites) {
+        result = s4c_animate_rangeof_sprites_at_coords_clipped(sprites, w, 0, num_frames, reps, frametime, num_frames, frame_height, frame_width, 0, 0);
+    } else {
+        result = s4c_animate_sprites(sprites, w, reps, frametime, num_frames, frame_height, frame_width);
+    }
 
     // We check animate_sprites() result to see if there were problems:
     if (result < 0) {
@@ -335,7 +342,11 @@ int demo(FILE* mainthread_file, FILE* newthread_file)
     wrefresh(stdscr);
 
     // We call the animation to be displayed at 3,3
-    result = s4c_animate_sprites_at_coords(sprites, w, reps, frametime, num_frames, frame_height, frame_width, try_y, try_x);
+    if (clip_sprites) {
+        result = s4c_animate_rangeof_sprites_at_coords_clipped(sprites, w, 0, num_frames, reps, frametime, num_frames, frame_height, frame_width, try_y, try_x);
+    } else {
+        result = s4c_animate_sprites_at_coords(sprites, w, reps, frametime, num_frames, frame_height, frame_width, try_y, try_x);
+    }
     // We should check animate_sprites_at_coords() result to see if there were problems, but in the demo we don't expect problems so we ignore the specific error content of result and just exit.
 
     if (result < 0) {
@@ -358,7 +369,11 @@ int demo(FILE* mainthread_file, FILE* newthread_file)
     wrefresh(stdscr);
 
     // We call the animation to be displayed at 3,3
-    result = s4c_display_sprite_at_coords(sprites, 13, w, num_frames, frame_height, frame_width, try_y, try_x);
+    if (clip_sprites) {
+        result = s4c_display_sprite_at_coords_clipped(sprites, 13, w, num_frames, frame_height, frame_width, try_y, try_x);
+    } else {
+        result = s4c_display_sprite_at_coords(sprites, 13, w, num_frames, frame_height, frame_width, try_y, try_x);
+    }
     // We should check animate_sprites_at_coords() result to see if there were problems, but in the demo we don't expect problems so we ignore the specific error content of result and just exit.
 
     if (result < 0) {
@@ -393,7 +408,11 @@ int demo(FILE* mainthread_file, FILE* newthread_file)
     wrefresh(stdscr);
 
     // We call the animation to be displayed at 3,3
-    result = s4c_animate_rangeof_sprites_at_coords(sprites, w, 10, 20, reps, frametime*3, num_frames, frame_height, frame_width, try_y, try_x);
+    if (clip_sprites) {
+        result = s4c_animate_rangeof_sprites_at_coords_clipped(sprites, w, 10, 20, reps, frametime*3, num_frames, frame_height, frame_width, try_y, try_x);
+    } else {
+        result = s4c_animate_rangeof_sprites_at_coords(sprites, w, 10, 20, reps, frametime*3, num_frames, frame_height, frame_width, try_y, try_x);
+    }
     // We should check animate_sprites_at_coords() result to see if there were problems, but in the demo we don't expect problems so we ignore the specific error content of result and just exit.
 
     if (result < 0) {
@@ -407,55 +426,45 @@ int demo(FILE* mainthread_file, FILE* newthread_file)
 
     wclear(stdscr);
     wrefresh(stdscr);
-    mvwprintw(stdscr,3,2, "Now animate_sprites_thread_at, we ask for a new thread.");
+    mvwprintw(stdscr,3,2, "Now s4c_animation_start, we ask for a new thread.");
     mvwprintw(stdscr,4,2, "UL animation corner will be at (y:%i,x:%i).", try_y, try_x);
     mvwprintw(stdscr,5,2, "Animation will loop until you press Enter on that screen.");
+    if (clip_sprites) {
+        // Animation threads draw clipped frames too
+        mvwprintw(stdscr,6,2, "Frames will be clipped to the window.");
+    }
     mvwprintw(stdscr,7,20, "[Press Enter to continue]");
     wrefresh(stdscr);
     drop_res = scanf("%*c");
     wclear(stdscr);
     wrefresh(stdscr);
 
-    pthread_mutex_t animation_mutex = PTHREAD_MUTEX_INITIALIZER;
-    pthread_cond_t animation_cond = PTHREAD_COND_INITIALIZER;
-    animate_args* animation_thread_args = (animate_args*) malloc(sizeof(animate_args));
-    pthread_t animation_thread;
-
-    int stop_animation=0;
-
-    animation_thread_args->frametime = frametime;
-
-    animation_thread_args->num_frames = num_frames;
-
-    animation_thread_args->frameheight = frame_height;
-    animation_thread_args->framewidth = frame_width;
-    animation_thread_args->startX = try_x;
-    animation_thread_args->startY = try_y;
-
-    //We load the sprites to animation_thread_args
-    loadCheck = s4c_load_sprites(animation_thread_args->sprites, newthread_file, animation_thread_args->num_frames, animation_thread_args->frameheight-1, animation_thread_args->framewidth-1);
-    //We check if the loading went ok
+    //We share the sprites already loaded with the animation thread, instead of loading the file again
+    S4C_Frame_Store* store = NULL;
+    result = s4c_frame_store_from_sprites(&store, sprites, NULL, loadCheck, frame_height, frame_width);
+    if (result < 0) {
+        endwin();
+        fprintf(stderr,"Demo error while allocating sprites for s4c_animation_start_shared()");
+        exit(EXIT_FAILURE);
+    }
 
-    // Start animation thread
-    animation_thread_args->win = w;
-    animation_thread_args->stop_thread = stop_animation;
-    pthread_create(&animation_thread, NULL, s4c_animate_sprites_thread_at, animation_thread_args);
-    refresh();
+    // Start animation thread, looping until stopped. It holds its own reference to the store
+    S4C_Animation_Handle* animation_handle = NULL;
+    result = s4c_animation_start_shared(&animation_handle, store, w, 0, loadCheck-1, 0, frametime, try_x, try_y);
+    s4c_frame_store_release(store);
+    if (result < 0) {
+        endwin();
+        fprintf(stderr,"Demo error while doing s4c_animation_start()");
+        exit(EXIT_FAILURE);
+    }
 
     //Wait for enter to stop animation
     drop_res = scanf("%*c");
-    stop_animation=1;
 
-    // Stop the animation
-    pthread_mutex_lock(&animation_mutex);
-    animation_thread_args->stop_thread = stop_animation;
-    pthread_cond_signal(&animation_cond);
-    // Wait for the animation thread to finish
-    pthread_join(animation_thread, NULL);
-    pthread_mutex_unlock(&animation_mutex);
+    // Stop the animation, the thread is woken right away and joined
+    s4c_animation_stop(animation_handle);
 
-    //Free animation thread arguments and end demo
-    free(animation_thread_args);
+    //The store was freed with the last reference, end demo
 
     clear();
     refresh();
@@ -475,7 +484,13 @@ int demo(FILE* mainthread_file, FILE* newthread_file)
     int framesCounter = 0;          // Useful to count frames
     SetTargetFPS(60);               // Set desired framerate (frames-per-second)
     int current_anim_frame = 0;
-    S4C_Sprite curr_sprite = s4c_new_sprite(sprites[current_anim_frame], 17, 17, palette, PALETTE_S4C_H_TOTCOLORS);
+    S4C_Frame_Store* store = NULL;
+    if (s4c_frame_store_from_sprites(&store, sprites, NULL, loadCheck, 17, 17) != 0) {
+        fprintf(stderr,"Demo error while allocating sprites");
+        exit(EXIT_FAILURE);
+    }
+    // Refers to the current frame, without copying it
+    S4C_Sprite_Ref curr_sprite = s4c_sprite_ref(store, current_anim_frame, palette, PALETTE_S4C_H_TOTCOLORS);
 
     while (!WindowShouldClose()) {
         // Update
@@ -497,8 +512,8 @@ int demo(FILE* mainthread_file, FILE* newthread_file)
             // TODO: Update GAMEPLAY screen variables here!
             framesCounter++;    // Count frames
             if (framesCounter % 2 == 0) {
-                current_anim_frame = ( current_anim_frame < num_frames-1 ? current_anim_frame +1 : 0);
-                curr_sprite = s4c_new_sprite(sprites[current_anim_frame], 17, 17, palette, PALETTE_S4C_H_TOTCOLORS);
+                current_anim_frame = ( current_anim_frame < store->frame_count-1 ? current_anim_frame +1 : 0);
+                curr_sprite.frame_index = current_anim_frame;
             }
             // Press enter to change to ENDING screen
             if (IsKeyPressed(KEY_ENTER) || IsGestureDetected(GESTURE_TAP)) {
@@ -542,10 +557,10 @@ int demo(FILE* mainthread_file, FILE* newthread_file)
             DrawRectangleRec(r, RAYWHITE);
             //int res = s4rl_draw_sprite_at_rect(sprites[current_anim_frame], r, 17, 17, 24, palette, PALETTE_S4C_H_TOTCOLORS);
             //int res = DrawSpriteRect(sprites[current_anim_frame], r, 17, 17, 24, palette, PALETTE_S4C_H_TOTCOLORS);
-            //int res = s4rl_draw_s4c_sprite_at_rect(curr_sprite, r, 24);
-            int res = DrawS4CSpriteRect(curr_sprite, r, 24);
+            //int res = s4rl_draw_sprite_ref_at_rect(curr_sprite, r, 24);
+            int res = DrawS4CSpriteRefRect(curr_sprite, r, 24);
             if (res != 0) {
-                fprintf(stderr,"%s():    Failed s4rl_draw_s4c_sprite_at_rect().\n", __func__);
+                fprintf(stderr,"%s():    Failed s4rl_draw_sprite_ref_at_rect().\n", __func__);
             }
         }
         break;
@@ -566,6 +581,7 @@ int demo(FILE* mainthread_file, FILE* newthread_file)
     }
 
     CloseWindow();
+    s4c_frame_store_release(store);
     return 0;
 #endif
     printf("\n\n\t\tEnd of demo.");
@@ -583,17 +599,12 @@ int main(int argc, char** argv)
     }
 
     FILE *f = fopen(argv[1], "r");
-    FILE *f2 = fopen(argv[1], "r");
     if (!f) {
-        fprintf(stderr,"Error opening file %s as f1.\n",argv[1]);
-        usage(argv[0]);
-    }
-    if (!f2) {
-        fprintf(stderr,"Error opening file %s as f2.\n",argv[1]);
+        fprintf(stderr,"Error opening file %s.\n",argv[1]);
         usage(argv[0]);
     }
-    int result = demo(f,f2);
-    //Since we passed f and f2 to load_sprites(), each one was already closed in that call after the sprites had been set
+    int result = demo(f);
+    //Since we passed f to load_sprites(), it was already closed in that call after the sprites had been set
 
     return result;
 }
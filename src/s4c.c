@@ -236,715 +236,6339 @@ void s4c_animate_dbg_features(void)
     }
 }
 
+s4c_animate_malloc_func* s4c_animate_inner_malloc = &S4C_ANIMATE_MALLOC;
+s4c_animate_calloc_func* s4c_animate_inner_calloc = &S4C_ANIMATE_CALLOC;
+s4c_animate_realloc_func* s4c_animate_inner_realloc = &S4C_ANIMATE_REALLOC;
+s4c_animate_free_func* s4c_animate_inner_free = &S4C_ANIMATE_FREE;
+
 /**
- * Takes a S4C_Color pointer and a FILE pointer to print to.
- *
- * @param color The color to debug.
- * @param fp The file to debug to.
+ * Sets the functions used by loaders, caches, players and the other animate allocations.
+ * Must be called before anything is allocated: memory is given back to the functions set when it is freed.
+ * Any NULL argument restores the default for that function (S4C_ANIMATE_MALLOC and friends).
+ * @param malloc_func The allocation function.
+ * @param calloc_func The counted allocation function, must return zeroed memory.
+ * @param realloc_func The reallocation function.
+ * @param free_func The free function.
  */
-void debug_s4c_color_2file(S4C_Color* color, FILE* fp)
+void s4c_set_allocator(s4c_animate_malloc_func* malloc_func, s4c_animate_calloc_func* calloc_func, s4c_animate_realloc_func* realloc_func, s4c_animate_free_func* free_func)
 {
-    if (!fp) {
-        fprintf(stderr,"Error while trying to debug an S4C_Color, invalid file pointer.\n");
-        exit(EXIT_FAILURE);
-    }
-    fprintf(fp,"[S4C_Color] => { red: [%i], green: [%i], blue: [%i], name: [%s] }\n", color->red, color->green, color->blue, color->name);
+    s4c_animate_inner_malloc = (malloc_func != NULL ? malloc_func : &S4C_ANIMATE_MALLOC);
+    s4c_animate_inner_calloc = (calloc_func != NULL ? calloc_func : &S4C_ANIMATE_CALLOC);
+    s4c_animate_inner_realloc = (realloc_func != NULL ? realloc_func : &S4C_ANIMATE_REALLOC);
+    s4c_animate_inner_free = (free_func != NULL ? free_func : &S4C_ANIMATE_FREE);
 }
 
+#define S4C_ALLOC_ALIGN (_Alignof(max_align_t)) /**< Alignment of the blocks returned by S4C_Arena and S4C_Block_Pool.*/
+#define S4C_ALLOC_ROUND(size) (((size) + S4C_ALLOC_ALIGN - 1) & ~(S4C_ALLOC_ALIGN - 1)) /**< Rounds size up to S4C_ALLOC_ALIGN.*/
+
 /**
- * Takes a S4C_Color pointer and prints it to stdout.
- *
- * @param color The color to debug.
+ * Returns how many bytes from buffer to the first address aligned to S4C_ALLOC_ALIGN.
  */
-void debug_s4c_color(S4C_Color* color)
+static size_t s4c_alloc_padding(const void* buffer)
 {
-    debug_s4c_color_2file(color,stdout);
+    uintptr_t addr = (uintptr_t) buffer;
+    return (size_t) (S4C_ALLOC_ROUND(addr) - addr);
 }
 
 /**
- * Takes a char matrix (maximum line size is S4C_MAXCOLS), the height of each frame, the width of each frame, the S4C_Color palette pointer and the palette size.
- * Contructs and returns an S4C_Sprite with its fields using the passed arguments.
- * @param data The char matrix to wrap.
- * @param frameheight The height of each frame.
- * @param framewidth The width of each frame.
- * @param palette The pointer to s4c color palette/array.
- * @param palette_size The size of s4c color palette/array.
+ * Initialises a S4C_Arena over a caller-provided buffer, which must outlive the arena.
+ * @param arena The S4C_Arena to initialise.
+ * @param buffer The memory to hand out.
+ * @param size Size of buffer.
+ * @see s4c_arena_use()
+ * @return 0 if successful, S4C_ERR_RANGE if the arguments are invalid or the buffer is too small.
  */
-S4C_Sprite s4c_new_sprite(char data[][S4C_MAXCOLS], int frameheight, int framewidth, S4C_Color* palette, int palette_size)
+int s4c_arena_init(S4C_Arena* arena, void* buffer, size_t size)
 {
-    S4C_Sprite res = {0};
-    res.frame_height = frameheight;
-    res.frame_width = framewidth;
-    res.palette = palette;
-    res.palette_size = palette_size;
-    for (int i = 0; i < frameheight; i++) {
-        for (int j = 0; j < framewidth; j++) {
-            res.data[i][j] = data[i][j];
-        }
+    if (arena == NULL || buffer == NULL) {
+        return S4C_ERR_RANGE;
     }
-    return res;
+    size_t padding = s4c_alloc_padding(buffer);
+    if (size < padding + S4C_ALLOC_ALIGN) {
+        return S4C_ERR_RANGE;
+    }
+    arena->base = (char*) buffer + padding;
+    arena->size = (size - padding) & ~(S4C_ALLOC_ALIGN - 1);
+    atomic_init(&arena->used, 0);
+    atomic_init(&arena->failures, 0);
+    return 0;
 }
 
-#ifndef S4C_RAYLIB_EXTENSION
-
 /**
- * Initialises a color pair from a passed S4C_Color pointer.
- * @param palette The S4C_Color pointer array at hand.
- * @param color_index The resulting color index for defined colorpair.
- * @param bg_color_index The color index for background color of defined colorpair. Typical values are 0 or, only after use_default_colors(), -1.
+ * Takes size bytes from a S4C_Arena. Each block is preceded by a header holding its size, for s4c_arena_realloc().
+ * @param arena The S4C_Arena to allocate from.
+ * @param size How many bytes to allocate.
+ * @return The block, or NULL if it does not fit.
  */
-void init_s4c_color_pair_ex(S4C_Color* color, int color_index, int bg_color_index)
+void* s4c_arena_alloc(S4C_Arena* arena, size_t size)
 {
-
-    if (color == NULL) {
-        fprintf(stderr,"Error: invalid S4C_Color at %s().",__func__);
-        exit(EXIT_FAILURE);
+    if (arena == NULL) {
+        return NULL;
     }
-
-    int r, g, b;
-    char color_name[50];
-
-    r = color->red;
-    g = color->green;
-    b = color->blue;
-    strcpy(color_name,color->name);
-
-    int proportional_r = (((float)r + 1.0) / 256)*1000;
-    int proportional_g = (((float)g + 1.0) / 256)*1000;
-    int proportional_b = (((float)b + 1.0) / 256)*1000;
-    init_color(color_index, proportional_r, proportional_g, proportional_b);
-    init_pair(color_index, color_index, bg_color_index);
+    size_t header = S4C_ALLOC_ROUND(sizeof(size_t));
+    if (size > arena->size - header) {
+        atomic_fetch_add(&arena->failures, 1);
+        return NULL;
+    }
+    size_t need = header + S4C_ALLOC_ROUND(size);
+    size_t used = atomic_load_explicit(&arena->used, memory_order_relaxed);
+    do {
+        if (need > arena->size - used) {
+            atomic_fetch_add(&arena->failures, 1);
+            return NULL;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&arena->used, &used, used + need, memory_order_relaxed, memory_order_relaxed));
+    char* block = arena->base + used;
+    memcpy(block, &size, sizeof(size_t));
+    return block + header;
 }
 
 /**
- * Initialises a color pair from a passed S4C_Color pointer.
- * The background color index for the defined color pair is 0.
- * @param palette The S4C_Color pointer array at hand.
- * @param color_index The resulting color index for defined colorpair.
+ * Resizes a block taken from a S4C_Arena, by copying it into a new block. The old block stays taken until s4c_arena_reset().
+ * @param arena The S4C_Arena the block comes from.
+ * @param obj The block to resize, or NULL to allocate a new one.
+ * @param size The new size.
+ * @return The new block, or NULL if it does not fit, leaving obj untouched.
  */
-void init_s4c_color_pair(S4C_Color* color, int color_index)
+void* s4c_arena_realloc(S4C_Arena* arena, void* obj, size_t size)
 {
-    init_s4c_color_pair_ex(color, color_index, 0);
+    void* res = s4c_arena_alloc(arena, size);
+    if (res == NULL || obj == NULL) {
+        return res;
+    }
+    size_t old_size = 0;
+    memcpy(&old_size, (char*) obj - S4C_ALLOC_ROUND(sizeof(size_t)), sizeof(size_t));
+    memcpy(res, obj, (old_size < size ? old_size : size));
+    return res;
 }
 
 /**
- * Initialises a color pair from a passed S4C_Color pointer.
- * It sets the background color index for the pair to -1.
- * This is useless to any curses implementation that does not support use_default_colors().
- * In that case, plain init_s4c_color_pair() should be used.
- * @param palette The S4C_Color pointer array at hand.
- * @param color_index The resulting color index for defined colorpair.
+ * Gives back all the blocks of a S4C_Arena at once. No block taken from it can be used afterwards.
+ * @param arena The S4C_Arena to reset.
  */
-void init_s4c_color_pair_default_bg(S4C_Color* color, int color_index)
+void s4c_arena_reset(S4C_Arena* arena)
 {
-    init_s4c_color_pair_ex(color, color_index, -1);
+    if (arena == NULL) {
+        return;
+    }
+    atomic_store(&arena->used, 0);
 }
 
-#endif
+static S4C_Arena* s4c_current_arena = NULL; /**< The S4C_Arena set by s4c_arena_use().*/
 
-const char* s4c_color_strings[S4C_MAX_COLOR_INDEX+1] = {
-    "S4C_BLACK",
-    "S4C_RED",
-    "S4C_BRIGHT_GREEN",
-    "S4C_BRIGHT_YELLOW",
-    "S4C_BLUE",
-    "S4C_MAGENTA",
-    "S4C_CYAN",
-    "S4C_WHITE",
-    "S4C_ORANGE",
-    "S4C_LIGHT_BROWN",
-    "S4C_DARK_BROWN",
-    "S4C_PURPLE",
-    "S4C_DARK_GREEN",
-    "S4C_GREY",
-    "S4C_LIGHT_YELLOW",
-    "S4C_LIGHT_BLUE",
-    "S4C_DARK_YELLOW",
-    "S4C_DARK_OLIVE",
-    "S4C_LIGHT_OLIVE",
-    "S4C_OLIVE",
-    "S4C_DARK_CHERRY",
-    "S4C_LIGHT_CHERRY",
-    "S4C_CHERRY",
-    "S4C_SALMON",
-    "S4C_DARK_BLUE",
-    "S4C_VIOLET",
-    "S4C_INDIGO",
-    "S4C_LIGHT_ORANGE",
-    "S4C_TEAL",
-    "S4C_DARK_CYAN",
-    "S4C_DARK_PURPLE",
-    "S4C_LIGHT_PURPLE",
-};
+static void* s4c_arena_malloc_hook(size_t size)
+{
+    return s4c_arena_alloc(s4c_current_arena, size);
+}
 
-const char* s4c_color_name(S4C_Color_Index color_index)
+static void* s4c_arena_calloc_hook(size_t count, size_t size)
 {
-    if (color_index < S4C_MIN_COLOR_INDEX || color_index > S4C_MAX_COLOR_INDEX) {
-        fprintf(stderr,"[%s]:  Invalid color index { %i }, { %s -> [%i] }.", __func__, color_index, (color_index < S4C_MIN_COLOR_INDEX ? "Below min valid value " : "Above max valid value"), (color_index < S4C_MIN_COLOR_INDEX ? S4C_MIN_COLOR_INDEX : S4C_MAX_COLOR_INDEX));
-        abort();
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
     }
-    return s4c_color_strings[color_index-S4C_MIN_COLOR_INDEX];
+    void* res = s4c_arena_alloc(s4c_current_arena, count * size);
+    if (res != NULL) {
+        memset(res, 0, count * size);
+    }
+    return res;
 }
 
-#ifndef S4C_RAYLIB_EXTENSION
-/**
- * Initialises all the needed color pairs for animate, from the palette file.
- * @param palette The palette file to read the colors from.
- */
-void init_s4c_color_pairs(FILE* palette)
+static void* s4c_arena_realloc_hook(void* obj, size_t size)
 {
+    return s4c_arena_realloc(s4c_current_arena, obj, size);
+}
 
-    char line[S4C_MAX_LINE_LENGTH];
-    int color_index = 9;
-
-    while (fgets(line, S4C_MAX_LINE_LENGTH, palette) != NULL) {
-        // Check if the line starts with "#", "GIMP Palette", "Name:" or "Columns:"
-        if (strncmp(line, "#", 1) == 0 || strncmp(line, "GIMP Palette", 12) == 0 ||
-            strncmp(line, "Name:", 5) == 0 || strncmp(line, "Columns:", 8) == 0) {
-            // Skip the comment or irrelevant line
-            continue;
-        }
-
-        // Parse the color values and name
-        int r, g, b;
-        char name[S4C_PALETTEFILE_MAX_COLOR_NAME_LEN];
-        if (sscanf(line, "%d %d %d %[^\n]", &r, &g, &b, name) != 4) {
-            fprintf(stderr, "[%s]  Error: could not parse palette line: %s\n", __func__, line);
-            continue;
-        }
-
-        int proportional_r = (((float)r + 1.0) / 256)*1000;
-        int proportional_g = (((float)g + 1.0) / 256)*1000;
-        int proportional_b = (((float)b + 1.0) / 256)*1000;
-        init_color(color_index, proportional_r, proportional_g, proportional_b);
-        init_pair(color_index, color_index, 0);
-
-        color_index++;
-    }
-
-    //We close the palette file ourselves
-    fclose(palette);
+static void s4c_arena_free_hook(void* obj)
+{
+    (void) obj;
 }
 
 /**
- * Demoes all colors supported by the palette in the passed WINDOW. Not guaranteed to work.
- * Since it uses indexes defined by default from animate.h, it should work only when your currently initialised palette has color pairs for the expected index range.
- * @param win The window to print the demo to.
+ * Makes the animate module allocate from a S4C_Arena, or go back to the default functions if arena is NULL.
+ * Same constraints as s4c_set_allocator().
+ * @param arena The S4C_Arena to use. Must outlive all the allocations made from it.
+ * @see s4c_set_allocator()
  */
-void test_s4c_color_pairs(WINDOW* win)
+void s4c_arena_use(S4C_Arena* arena)
 {
-    for (int i = S4C_MIN_COLOR_INDEX; i < S4C_MAX_COLOR_INDEX +1; i++) {
-        int color_index = i;
-        if (color_index >= 0 && color_index < S4C_MAX_COLORS) {
-            wattron(win, COLOR_PAIR(color_index));
-            mvwaddch(win, 2, 2+i-S4C_MIN_COLOR_INDEX, ' ' | A_REVERSE);
-            wattroff(win, COLOR_PAIR(color_index));
-        }
+    s4c_current_arena = arena;
+    if (arena == NULL) {
+        s4c_set_allocator(NULL, NULL, NULL, NULL);
+    } else {
+        s4c_set_allocator(&s4c_arena_malloc_hook, &s4c_arena_calloc_hook, &s4c_arena_realloc_hook, &s4c_arena_free_hook);
     }
-
-    wrefresh(win);
-    refresh();
 }
 
-int s4c_check_has_colors(void)
+/**
+ * Initialises a S4C_Block_Pool over a caller-provided buffer, which must outlive the pool.
+ * @param pool The S4C_Block_Pool to initialise.
+ * @param buffer The memory to split into blocks.
+ * @param size Size of buffer.
+ * @param block_size Size of each block.
+ * @see s4c_block_pool_destroy()
+ * @return 0 if successful, S4C_ERR_RANGE if the arguments are invalid or no block fits in the buffer, S4C_ERR_ALLOC if the lock can't be initialised.
+ */
+int s4c_block_pool_init(S4C_Block_Pool* pool, void* buffer, size_t size, size_t block_size)
 {
-    if (has_colors() == FALSE) {
-        return  S4C_ERR_TERMCOLOR;
+    if (pool == NULL || buffer == NULL || block_size == 0 || block_size > SIZE_MAX / 2) {
+        return S4C_ERR_RANGE;
+    }
+    size_t padding = s4c_alloc_padding(buffer);
+    block_size = S4C_ALLOC_ROUND(block_size < sizeof(void*) ? sizeof(void*) : block_size);
+    if (size < padding + block_size) {
+        return S4C_ERR_RANGE;
+    }
+    if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+        return S4C_ERR_ALLOC;
+    }
+    pool->base = (char*) buffer + padding;
+    pool->block_size = block_size;
+    pool->blocks = (size - padding) / block_size;
+    pool->used = 0;
+    pool->failures = 0;
+    pool->free_list = NULL;
+    for (size_t i = pool->blocks; i > 0; i--) {
+        char* block = pool->base + (i - 1) * block_size;
+        memcpy(block, &pool->free_list, sizeof(void*));
+        pool->free_list = block;
     }
     return 0;
 }
 
-int s4c_check_can_change_color(void)
+/**
+ * Takes a block from a S4C_Block_Pool.
+ * @param pool The S4C_Block_Pool to allocate from.
+ * @param size How many bytes are needed, at most pool->block_size.
+ * @return The block, or NULL if size is too big or no block is free.
+ */
+void* s4c_block_pool_alloc(S4C_Block_Pool* pool, size_t size)
 {
-    if (can_change_color() == FALSE) {
-        return S4C_ERR_TERMCHANGECOLOR;
+    if (pool == NULL) {
+        return NULL;
     }
-    return 0;
+    pthread_mutex_lock(&pool->lock);
+    char* res = pool->free_list;
+    if (size > pool->block_size || res == NULL) {
+        pool->failures++;
+        pthread_mutex_unlock(&pool->lock);
+        return NULL;
+    }
+    memcpy(&pool->free_list, res, sizeof(void*));
+    pool->used++;
+    pthread_mutex_unlock(&pool->lock);
+    return res;
 }
 
 /**
- * Checks terminal color capabilities.
- * @return 0 if successful, a negative value otherwise.
+ * Gives a block back to a S4C_Block_Pool. Pointers not coming from the pool are ignored.
+ * @param pool The S4C_Block_Pool the block comes from.
+ * @param obj The block to free.
  */
-int s4c_check_term(void)
+void s4c_block_pool_free(S4C_Block_Pool* pool, void* obj)
 {
+    if (pool == NULL || obj == NULL) {
+        return;
+    }
+    char* block = obj;
+    if (block < pool->base || block >= pool->base + pool->blocks * pool->block_size
+        || (size_t) (block - pool->base) % pool->block_size != 0) {
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    memcpy(block, &pool->free_list, sizeof(void*));
+    pool->free_list = block;
+    pool->used--;
+    pthread_mutex_unlock(&pool->lock);
+}
 
-    bool curses_was_ready = (stdscr != NULL) ? true : false;
-
-    if (!curses_was_ready) { //We temporarily try to start curses ourselves.
-        setlocale(LC_ALL, "");
-        initscr();
-        clear();
-        refresh();
-        start_color();
+/**
+ * Releases the lock of a S4C_Block_Pool. The buffer is left to the caller.
+ * @param pool The S4C_Block_Pool to destroy.
+ */
+void s4c_block_pool_destroy(S4C_Block_Pool* pool)
+{
+    if (pool == NULL) {
+        return;
     }
+    pthread_mutex_destroy(&pool->lock);
+}
 
-    int checks[2] = {0};
+static S4C_Block_Pool* s4c_current_block_pool = NULL; /**< The S4C_Block_Pool set by s4c_block_pool_use().*/
 
-    checks[0] = s4c_check_has_colors();
-    checks[1] = s4c_check_can_change_color();
-    if (checks[0] != 0) {
-        if (!curses_was_ready) {
-            endwin();
-        }
-        return checks[0];
+static void* s4c_block_pool_malloc_hook(size_t size)
+{
+    return s4c_block_pool_alloc(s4c_current_block_pool, size);
+}
+
+static void* s4c_block_pool_calloc_hook(size_t count, size_t size)
+{
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
     }
-    if (checks[1] != 0) {
-        if (!curses_was_ready) {
-            endwin();
-        }
-        return checks[1];
+    void* res = s4c_block_pool_alloc(s4c_current_block_pool, count * size);
+    if (res != NULL) {
+        memset(res, 0, count * size);
     }
-    if (!curses_was_ready) {
-        endwin();
+    return res;
+}
+
+static void* s4c_block_pool_realloc_hook(void* obj, size_t size)
+{
+    if (obj == NULL) {
+        return s4c_block_pool_alloc(s4c_current_block_pool, size);
     }
-    return 0;
+    return (size <= s4c_current_block_pool->block_size ? obj : NULL);
+}
+
+static void s4c_block_pool_free_hook(void* obj)
+{
+    s4c_block_pool_free(s4c_current_block_pool, obj);
 }
 
 /**
- * Checks window size using s4c_animate() logic check.
- * @param win The window to check.
- * @param rows Height of animation.
- * @param cols Width of animation.
- * @param startX The X coord we want to draw at.
- * @param startY The Y coord we want to draw at.
- * @return 0 if successful, a negative value otherwise.
+ * Makes the animate module allocate from a S4C_Block_Pool, or go back to the default functions if pool is NULL.
+ * Same constraints as s4c_set_allocator(). Allocations larger than the block size fail, so the pool should be sized for the biggest one.
+ * Each allocation also holds a header of _Alignof(max_align_t) bytes, used by s4c_mem_stats().
+ * @param pool The S4C_Block_Pool to use. Must outlive all the allocations made from it.
+ * @see s4c_set_allocator()
  */
-int s4c_check_win(WINDOW* win, int rows, int cols, int startX, int startY)
+void s4c_block_pool_use(S4C_Block_Pool* pool)
 {
+    s4c_current_block_pool = pool;
+    if (pool == NULL) {
+        s4c_set_allocator(NULL, NULL, NULL, NULL);
+    } else {
+        s4c_set_allocator(&s4c_block_pool_malloc_hook, &s4c_block_pool_calloc_hook, &s4c_block_pool_realloc_hook, &s4c_block_pool_free_hook);
+    }
+}
+
+/**
+ * Precedes each block allocated by s4c_mem_malloc(), to account for it when it is freed.
+ */
+typedef struct S4C_Mem_Header {
+    size_t size; /**< Requested size.*/
+    S4C_Mem_Kind kind; /**< What the block holds.*/
+} S4C_Mem_Header;
+
+#define S4C_MEM_HEADER_SIZE S4C_ALLOC_ROUND(sizeof(S4C_Mem_Header)) /**< Space taken by S4C_Mem_Header, keeping blocks aligned.*/
+
+static atomic_size_t s4c_mem_bytes[S4C_MEM_KINDS]; /**< Bytes held for each S4C_Mem_Kind.*/
+static atomic_size_t s4c_mem_total = 0; /**< Bytes held in total.*/
+static atomic_size_t s4c_mem_peak = 0; /**< Highest value of s4c_mem_total.*/
+static atomic_size_t s4c_mem_allocations = 0; /**< How many blocks are held.*/
+
+/**
+ * Adds size bytes of the passed kind to the counters, raising the peak if needed.
+ */
+static void s4c_mem_account(S4C_Mem_Kind kind, size_t size)
+{
+    atomic_fetch_add_explicit(&s4c_mem_bytes[kind], size, memory_order_relaxed);
+    size_t total = atomic_fetch_add_explicit(&s4c_mem_total, size, memory_order_relaxed) + size;
+    size_t peak = atomic_load_explicit(&s4c_mem_peak, memory_order_relaxed);
+    while (total > peak && !atomic_compare_exchange_weak_explicit(&s4c_mem_peak, &peak, total, memory_order_relaxed, memory_order_relaxed));
+}
+
+/**
+ * Removes size bytes of the passed kind from the counters.
+ */
+static void s4c_mem_unaccount(S4C_Mem_Kind kind, size_t size)
+{
+    atomic_fetch_sub_explicit(&s4c_mem_bytes[kind], size, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&s4c_mem_total, size, memory_order_relaxed);
+}
+
+/**
+ * Writes the header of a new block of size bytes and counts it as kind.
+ * @return The user part of the block.
+ */
+static void* s4c_mem_tag(char* block, S4C_Mem_Kind kind, size_t size)
+{
+    S4C_Mem_Header header = {
+        .size = size,
+        .kind = kind,
+    };
+    memcpy(block, &header, sizeof(header));
+    s4c_mem_account(kind, size);
+    atomic_fetch_add_explicit(&s4c_mem_allocations, 1, memory_order_relaxed);
+    return block + S4C_MEM_HEADER_SIZE;
+}
+
+/**
+ * Allocates size bytes through s4c_animate_inner_malloc, counting them as kind.
+ * Blocks must be resized with s4c_mem_realloc() and freed with s4c_mem_free().
+ */
+static void* s4c_mem_malloc(S4C_Mem_Kind kind, size_t size)
+{
+    if (size > SIZE_MAX - S4C_MEM_HEADER_SIZE) {
+        return NULL;
+    }
+    char* block = s4c_animate_inner_malloc(S4C_MEM_HEADER_SIZE + size);
+    if (block == NULL) {
+        return NULL;
+    }
+    return s4c_mem_tag(block, kind, size);
+}
+
+/**
+ * Allocates count zeroed elements of size bytes through s4c_animate_inner_calloc, counting them as kind.
+ */
+static void* s4c_mem_calloc(S4C_Mem_Kind kind, size_t count, size_t size)
+{
+    if (size != 0 && count > (SIZE_MAX - S4C_MEM_HEADER_SIZE) / size) {
+        return NULL;
+    }
+    char* block = s4c_animate_inner_calloc(1, S4C_MEM_HEADER_SIZE + count * size);
+    if (block == NULL) {
+        return NULL;
+    }
+    return s4c_mem_tag(block, kind, count * size);
+}
+
+/**
+ * Resizes a block from s4c_mem_malloc(), keeping its kind. On failure obj is left untouched.
+ * If obj is NULL, a new block of the passed kind is allocated.
+ */
+static void* s4c_mem_realloc(S4C_Mem_Kind kind, void* obj, size_t size)
+{
+    if (obj == NULL) {
+        return s4c_mem_malloc(kind, size);
+    }
+    if (size > SIZE_MAX - S4C_MEM_HEADER_SIZE) {
+        return NULL;
+    }
+    S4C_Mem_Header header;
+    memcpy(&header, (char*) obj - S4C_MEM_HEADER_SIZE, sizeof(header));
+    char* block = s4c_animate_inner_realloc((char*) obj - S4C_MEM_HEADER_SIZE, S4C_MEM_HEADER_SIZE + size);
+    if (block == NULL) {
+        return NULL;
+    }
+    s4c_mem_unaccount(header.kind, header.size);
+    s4c_mem_account(header.kind, size);
+    header.size = size;
+    memcpy(block, &header, sizeof(header));
+    return block + S4C_MEM_HEADER_SIZE;
+}
+
+/**
+ * Returns the requested size of a block from s4c_mem_malloc(), or 0 for NULL.
+ */
+static size_t s4c_mem_size(const void* obj)
+{
+    if (obj == NULL) {
+        return 0;
+    }
+    S4C_Mem_Header header;
+    memcpy(&header, (const char*) obj - S4C_MEM_HEADER_SIZE, sizeof(header));
+    return header.size;
+}
+
+/**
+ * Frees a block from s4c_mem_malloc() through s4c_animate_inner_free. Does nothing for NULL.
+ */
+static void s4c_mem_free(void* obj)
+{
+    if (obj == NULL) {
+        return;
+    }
+    S4C_Mem_Header header;
+    memcpy(&header, (char*) obj - S4C_MEM_HEADER_SIZE, sizeof(header));
+    s4c_mem_unaccount(header.kind, header.size);
+    atomic_fetch_sub_explicit(&s4c_mem_allocations, 1, memory_order_relaxed);
+    s4c_animate_inner_free((char*) obj - S4C_MEM_HEADER_SIZE);
+}
+
+/**
+ * Fills a S4C_Mem_Stats with the memory currently held by the animate module.
+ * Counters are updated without locks, so while other threads allocate the values may be slightly apart from each other.
+ * @param stats The S4C_Mem_Stats to fill.
+ * @see s4c_frame_store_bytes()
+ * @see s4c_index_plane_bytes()
+ * @see s4c_blob_cache_bytes()
+ */
+void s4c_mem_stats(S4C_Mem_Stats* stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    for (int i = 0; i < S4C_MEM_KINDS; i++) {
+        stats->bytes[i] = atomic_load_explicit(&s4c_mem_bytes[i], memory_order_relaxed);
+    }
+    stats->total = atomic_load_explicit(&s4c_mem_total, memory_order_relaxed);
+    stats->peak = atomic_load_explicit(&s4c_mem_peak, memory_order_relaxed);
+    stats->allocations = atomic_load_explicit(&s4c_mem_allocations, memory_order_relaxed);
+}
+
+/**
+ * Sets the peak reported by s4c_mem_stats() to the memory currently held.
+ */
+void s4c_mem_reset_peak(void)
+{
+    atomic_store(&s4c_mem_peak, atomic_load(&s4c_mem_total));
+}
+
+/**
+ * Returns a name for the passed S4C_Mem_Kind.
+ * @param kind The S4C_Mem_Kind to name.
+ * @return A constant string, "unknown" for invalid kinds.
+ */
+const char* s4c_mem_kind_name(S4C_Mem_Kind kind)
+{
+    switch (kind) {
+    case S4C_MEM_ANIMATIONS: {
+        return "animations";
+    }
+    break;
+    case S4C_MEM_BLOB_CACHES: {
+        return "blob caches";
+    }
+    break;
+    case S4C_MEM_PALETTES: {
+        return "palettes";
+    }
+    break;
+    case S4C_MEM_TARGETS: {
+        return "targets";
+    }
+    break;
+    case S4C_MEM_PLAYBACK: {
+        return "playback";
+    }
+    break;
+    case S4C_MEM_THREADS: {
+        return "threads";
+    }
+    break;
+    default: {
+        return "unknown";
+    }
+    break;
+    }
+}
+
+/**
+ * Prints the memory currently held by the animate module to the passed file, one line per S4C_Mem_Kind.
+ * @param f The FILE to print to.
+ * @see s4c_mem_stats()
+ */
+void s4c_mem_stats_print(FILE* f)
+{
+    if (f == NULL) {
+        return;
+    }
+    S4C_Mem_Stats stats;
+    s4c_mem_stats(&stats);
+    for (int i = 0; i < S4C_MEM_KINDS; i++) {
+        fprintf(f, "[S4C]    %-12s %zu bytes\n", s4c_mem_kind_name(i), stats.bytes[i]);
+    }
+    fprintf(f, "[S4C]    Total: %zu bytes in %zu allocations, peak: %zu bytes\n", stats.total, stats.allocations, stats.peak);
+}
+
+/**
+ * Takes a S4C_Color pointer and a FILE pointer to print to.
+ *
+ * @param color The color to debug.
+ * @param fp The file to debug to.
+ */
+void debug_s4c_color_2file(S4C_Color* color, FILE* fp)
+{
+    if (!fp) {
+        fprintf(stderr,"Error while trying to debug an S4C_Color, invalid file pointer.\n");
+        exit(EXIT_FAILURE);
+    }
+    fprintf(fp,"[S4C_Color] => { red: [%i], green: [%i], blue: [%i], name: [%s] }\n", color->red, color->green, color->blue, color->name);
+}
+
+/**
+ * Takes a S4C_Color pointer and prints it to stdout.
+ *
+ * @param color The color to debug.
+ */
+void debug_s4c_color(S4C_Color* color)
+{
+    debug_s4c_color_2file(color,stdout);
+}
+
+/**
+ * Takes a char matrix (maximum line size is S4C_MAXCOLS), the height of each frame, the width of each frame, the S4C_Color palette pointer and the palette size.
+ * Contructs and returns an S4C_Sprite with its fields using the passed arguments.
+ * @param data The char matrix to wrap.
+ * @param frameheight The height of each frame.
+ * @param framewidth The width of each frame.
+ * @param palette The pointer to s4c color palette/array.
+ * @param palette_size The size of s4c color palette/array.
+ */
+S4C_Sprite s4c_new_sprite(char data[][S4C_MAXCOLS], int frameheight, int framewidth, S4C_Color* palette, int palette_size)
+{
+    S4C_Sprite res = {0};
+    res.frame_height = frameheight;
+    res.frame_width = framewidth;
+    res.palette = palette;
+    res.palette_size = palette_size;
+    for (int i = 0; i < frameheight; i++) {
+        for (int j = 0; j < framewidth; j++) {
+            res.data[i][j] = data[i][j];
+        }
+    }
+    return res;
+}
+
+/**
+ * Defines a 256 entries initializer, calling the passed macro on each byte value.
+ */
+#define S4C_LUT_4(f, b) f(b), f((b)+1), f((b)+2), f((b)+3)
+#define S4C_LUT_16(f, b) S4C_LUT_4(f, (b)), S4C_LUT_4(f, (b)+4), S4C_LUT_4(f, (b)+8), S4C_LUT_4(f, (b)+12)
+#define S4C_LUT_64(f, b) S4C_LUT_16(f, (b)), S4C_LUT_16(f, (b)+16), S4C_LUT_16(f, (b)+32), S4C_LUT_16(f, (b)+48)
+#define S4C_LUT_256(f) S4C_LUT_64(f, 0), S4C_LUT_64(f, 64), S4C_LUT_64(f, 128), S4C_LUT_64(f, 192)
+
+/**
+ * Defines the value of a byte read as a plain char, which may be signed.
+ */
+#define S4C_CHAR_VALUE(b) ((CHAR_MIN < 0 && (b) > CHAR_MAX) ? (b) - 256 : (b))
+
+/**
+ * Defines the palette entry for a sprite char, so that '1' is the first color, or -1.
+ */
+#define S4C_CHAR_PALETTE(b) (S4C_CHAR_VALUE(b) - '1' >= 0 ? S4C_CHAR_VALUE(b) - '1' : -1)
+
+/**
+ * Defines the palette entry for a palette index, or -1 for S4C_INDEX_TRANSPARENT.
+ */
+#define S4C_INDEX_PALETTE(b) ((b) == S4C_INDEX_TRANSPARENT ? -1 : (b))
+
+/**
+ * Maps sprite chars to palette entries, as used by raylib and ANSI renderers. -1 means no entry.
+ */
+static const short s4c_char_palette_lut[256] = { S4C_LUT_256(S4C_CHAR_PALETTE) };
+
+#ifdef S4C_RAYLIB_EXTENSION
+/**
+ * Maps palette indexes to palette entries. -1 means S4C_INDEX_TRANSPARENT.
+ */
+static const short s4c_index_palette_lut[256] = { S4C_LUT_256(S4C_INDEX_PALETTE) };
+#endif // S4C_RAYLIB_EXTENSION
+
+/**
+ * Builds a S4C_Frame_View over pixels with the passed row pitch, applying a S4C_Transform.
+ * @param base Pointer to the first pixel of the frame.
+ * @param line Offset between a pixel and the one below it in the frame.
+ * @param frameheight The height of the frame.
+ * @param framewidth The width of the frame.
+ * @param transform The S4C_Transform to apply.
+ * @param encoding The S4C_Pixel_Encoding of the pixels.
+ * @return The S4C_Frame_View for the frame.
+ */
+static S4C_Frame_View s4c_make_view(const unsigned char* base, ptrdiff_t line, int frameheight, int framewidth, S4C_Transform transform, S4C_Pixel_Encoding encoding)
+{
+    const ptrdiff_t last_row = (frameheight > 0 ? frameheight - 1 : 0) * line;
+    const ptrdiff_t last_col = (framewidth > 0 ? framewidth - 1 : 0);
+    S4C_Frame_View res = {0};
+    res.rows = frameheight;
+    res.cols = framewidth;
+    res.encoding = encoding;
+    switch (transform) {
+    case S4C_TRANSFORM_FLIP_H: {
+        res.origin = base + last_col;
+        res.row_stride = line;
+        res.col_stride = -1;
+    }
+    break;
+    case S4C_TRANSFORM_FLIP_V: {
+        res.origin = base + last_row;
+        res.row_stride = -line;
+        res.col_stride = 1;
+    }
+    break;
+    case S4C_TRANSFORM_ROT90: {
+        res.origin = base + last_row;
+        res.row_stride = 1;
+        res.col_stride = -line;
+        res.rows = framewidth;
+        res.cols = frameheight;
+    }
+    break;
+    case S4C_TRANSFORM_ROT180: {
+        res.origin = base + last_row + last_col;
+        res.row_stride = -line;
+        res.col_stride = -1;
+    }
+    break;
+    case S4C_TRANSFORM_ROT270: {
+        res.origin = base + last_col;
+        res.row_stride = -1;
+        res.col_stride = line;
+        res.rows = framewidth;
+        res.cols = frameheight;
+    }
+    break;
+    default: {
+        res.origin = base;
+        res.row_stride = line;
+        res.col_stride = 1;
+    }
+    break;
+    }
+    return res;
+}
+
+/**
+ * Takes a frame (maximum line size is S4C_MAXCOLS), its height and width, and a S4C_Transform.
+ * Returns a S4C_Frame_View showing the transformed frame, without copying it.
+ * The frame must outlive the view.
+ * @param frame The frame to view.
+ * @param frameheight The height of the frame.
+ * @param framewidth The width of the frame.
+ * @param transform The S4C_Transform to apply.
+ * @see S4C_Frame_View
+ * @return The S4C_Frame_View for the frame.
+ */
+S4C_Frame_View s4c_frame_view(char frame[][S4C_MAXCOLS], int frameheight, int framewidth, S4C_Transform transform)
+{
+    return s4c_make_view((const unsigned char*) &frame[0][0], S4C_MAXCOLS, frameheight, framewidth, transform, S4C_PIXELS_CHARS);
+}
+
+/**
+ * Holds a call to s4c_pool_parallel_for() while its chunks are run.
+ */
+typedef struct S4C_Pool_Job {
+    void (*fn)(void* arg, int from, int to); /**< Function run on each chunk.*/
+    void* arg; /**< Argument passed to fn.*/
+    atomic_int remaining; /**< How many chunks were not completed yet.*/
+} S4C_Pool_Job;
+
+/**
+ * Holds a chunk of a S4C_Pool_Job.
+ */
+typedef struct S4C_Pool_Task {
+    S4C_Pool_Job* job; /**< Job the chunk belongs to.*/
+    int from; /**< First index of the chunk.*/
+    int to; /**< Index past the last one of the chunk.*/
+} S4C_Pool_Task;
+
+/**
+ * Holds the chunks queued for a worker of a S4C_Pool.
+ * The worker takes chunks from the back, other threads steal them from the front.
+ */
+typedef struct S4C_Pool_Deque {
+    pthread_mutex_t lock; /**< Protects the deque.*/
+    S4C_Pool_Task* tasks; /**< The chunks.*/
+    int head; /**< Index of the first chunk, stolen by other threads.*/
+    int tail; /**< Index past the last chunk, taken by the worker.*/
+    int capacity; /**< How many chunks are allocated.*/
+} S4C_Pool_Deque;
+
+/**
+ * Holds a worker thread of a S4C_Pool.
+ */
+typedef struct S4C_Pool_Worker {
+    S4C_Pool* pool; /**< The pool.*/
+    int index; /**< Index of the worker deque.*/
+    pthread_t thread; /**< The thread.*/
+} S4C_Pool_Worker;
+
+struct S4C_Pool {
+    S4C_Pool_Worker* workers; /**< The workers.*/
+    S4C_Pool_Deque* deques; /**< A deque for each worker.*/
+    int count; /**< How many workers there are.*/
+    atomic_int pending; /**< How many chunks are queued in the deques.*/
+    atomic_uint next; /**< Deque the next chunk is pushed to.*/
+    atomic_ulong steals; /**< How many chunks were taken from the deque of another worker.*/
+    pthread_mutex_t lock; /**< Protects the waits on work and done.*/
+    pthread_cond_t work; /**< Broadcast when chunks are queued.*/
+    pthread_cond_t done; /**< Broadcast when a job completes.*/
+    bool stopping; /**< Set by s4c_pool_stop().*/
+};
+
+/**
+ * Pool used by the library to preprocess frames, or NULL.
+ * @see s4c_set_pool()
+ */
+static S4C_Pool* s4c_shared_pool = NULL;
+
+/**
+ * Appends a chunk to the back of a S4C_Pool_Deque.
+ * @return true if successful, false if allocation failed.
+ */
+static bool s4c_pool_push(S4C_Pool* pool, S4C_Pool_Deque* deque, S4C_Pool_Task task)
+{
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail == deque->capacity) {
+        // Reclaim the front left by steals before growing
+        int len = deque->tail - deque->head;
+        if (deque->head > 0) {
+            memmove(deque->tasks, deque->tasks + deque->head, len * sizeof(S4C_Pool_Task));
+            deque->head = 0;
+            deque->tail = len;
+        } else {
+            int capacity = (deque->capacity > 0 ? deque->capacity * 2 : 16);
+            S4C_Pool_Task* tasks = s4c_mem_realloc(S4C_MEM_THREADS, deque->tasks, capacity * sizeof(S4C_Pool_Task));
+            if (tasks == NULL) {
+                pthread_mutex_unlock(&deque->lock);
+                return false;
+            }
+            deque->tasks = tasks;
+            deque->capacity = capacity;
+        }
+    }
+    deque->tasks[deque->tail++] = task;
+    atomic_fetch_add(&pool->pending, 1);
+    pthread_mutex_unlock(&deque->lock);
+    return true;
+}
+
+/**
+ * Takes a chunk from a S4C_Pool_Deque, from the back for its worker or from the front for other threads.
+ * @return true if a chunk was taken, false if the deque was empty.
+ */
+static bool s4c_pool_take_from(S4C_Pool* pool, S4C_Pool_Deque* deque, bool own, S4C_Pool_Task* task)
+{
+    pthread_mutex_lock(&deque->lock);
+    bool res = (deque->head < deque->tail);
+    if (res) {
+        *task = (own ? deque->tasks[--deque->tail] : deque->tasks[deque->head++]);
+        if (deque->head == deque->tail) {
+            deque->head = 0;
+            deque->tail = 0;
+        }
+        atomic_fetch_sub(&pool->pending, 1);
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return res;
+}
+
+/**
+ * Takes a chunk for the passed worker, from its own deque first and then stealing from the others.
+ * @param self Index of the worker, or -1 for threads outside the pool.
+ * @return true if a chunk was taken, false if all deques were empty.
+ */
+static bool s4c_pool_take(S4C_Pool* pool, int self, S4C_Pool_Task* task)
+{
+    if (self >= 0 && s4c_pool_take_from(pool, &pool->deques[self], true, task)) {
+        return true;
+    }
+    for (int k = 1; k <= pool->count; k++) {
+        int victim = (self + k) % pool->count;
+        if (victim != self && s4c_pool_take_from(pool, &pool->deques[victim], false, task)) {
+            atomic_fetch_add(&pool->steals, 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Runs a chunk, and wakes the threads waiting for its job if it was the last one.
+ */
+static void s4c_pool_run(S4C_Pool* pool, const S4C_Pool_Task* task)
+{
+    S4C_Pool_Job* job = task->job;
+    job->fn(job->arg, task->from, task->to);
+    if (atomic_fetch_sub(&job->remaining, 1) == 1) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_broadcast(&pool->done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+/**
+ * Body of the worker threads of a S4C_Pool: runs chunks until the pool is stopped, sleeping while there are none.
+ */
+static void* s4c_pool_worker(void* arg)
+{
+    S4C_Pool_Worker* worker = arg;
+    S4C_Pool* pool = worker->pool;
+    for (;;) {
+        S4C_Pool_Task task;
+        if (s4c_pool_take(pool, worker->index, &task)) {
+            s4c_pool_run(pool, &task);
+            continue;
+        }
+        pthread_mutex_lock(&pool->lock);
+        while (atomic_load(&pool->pending) == 0 && !pool->stopping) {
+            pthread_cond_wait(&pool->work, &pool->lock);
+        }
+        bool stop = (pool->stopping && atomic_load(&pool->pending) == 0);
+        pthread_mutex_unlock(&pool->lock);
+        if (stop) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Stops the passed number of started workers of a S4C_Pool, once the queued chunks are done, and frees the pool.
+ */
+static void s4c_pool_join(S4C_Pool* pool, int started)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < started; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    for (int i = 0; i < pool->count; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        s4c_mem_free(pool->deques[i].tasks);
+    }
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->work);
+    pthread_mutex_destroy(&pool->lock);
+    s4c_mem_free(pool->workers);
+    s4c_mem_free(pool->deques);
+    s4c_mem_free(pool);
+}
+
+/**
+ * Returns how many threads the system can run in parallel, or 1 if it can't be found.
+ */
+static int s4c_cpu_count(void)
+{
+#ifndef _WIN32
+    long res = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    const char* env = getenv("NUMBER_OF_PROCESSORS");
+    long res = (env != NULL ? atol(env) : 1);
+#endif // _WIN32
+    return (res > 0 ? (int) res : 1);
+}
+
+/**
+ * Starts a S4C_Pool, and sets the passed pointer to it.
+ * The thread calling s4c_pool_parallel_for() also runs chunks, so a pool of N threads runs N+1 chunks at once.
+ * @param pool Pointer to set to the new S4C_Pool.
+ * @param threads How many worker threads to start. 0 starts one less than the number of online processors.
+ * @see s4c_pool_parallel_for()
+ * @see s4c_pool_stop()
+ * @return 0 if successful, S4C_ERR_RANGE if the arguments are invalid, S4C_ERR_ALLOC if allocation or thread creation failed.
+ */
+int s4c_pool_start(S4C_Pool** pool, int threads)
+{
+    if (pool == NULL || threads < 0) {
+        return S4C_ERR_RANGE;
+    }
+    if (threads == 0) {
+        threads = s4c_cpu_count() - 1;
+    }
+    S4C_Pool* res = s4c_mem_calloc(S4C_MEM_THREADS, 1, sizeof(S4C_Pool));
+    if (res == NULL) {
+        return S4C_ERR_ALLOC;
+    }
+    res->workers = s4c_mem_calloc(S4C_MEM_THREADS, (threads > 0 ? threads : 1), sizeof(S4C_Pool_Worker));
+    res->deques = s4c_mem_calloc(S4C_MEM_THREADS, (threads > 0 ? threads : 1), sizeof(S4C_Pool_Deque));
+    if (res->workers == NULL || res->deques == NULL) {
+        s4c_mem_free(res->workers);
+        s4c_mem_free(res->deques);
+        s4c_mem_free(res);
+        return S4C_ERR_ALLOC;
+    }
+    atomic_init(&res->pending, 0);
+    atomic_init(&res->next, 0);
+    atomic_init(&res->steals, 0);
+    pthread_mutex_init(&res->lock, NULL);
+    pthread_cond_init(&res->work, NULL);
+    pthread_cond_init(&res->done, NULL);
+    res->count = threads;
+    for (int i = 0; i < threads; i++) {
+        pthread_mutex_init(&res->deques[i].lock, NULL);
+        res->workers[i] = (S4C_Pool_Worker) {
+            .pool = res, .index = i,
+        };
+    }
+    int started = 0;
+    while (started < threads && pthread_create(&res->workers[started].thread, NULL, s4c_pool_worker, &res->workers[started]) == 0) {
+        started++;
+    }
+    if (started < threads) {
+        s4c_pool_join(res, started);
+        return S4C_ERR_ALLOC;
+    }
+    *pool = res;
+    return 0;
+}
+
+/**
+ * Returns how many worker threads a S4C_Pool has.
+ * @param pool The S4C_Pool to read, may be NULL.
+ * @return How many worker threads the pool has, 0 for NULL.
+ */
+int s4c_pool_threads(const S4C_Pool* pool)
+{
+    return (pool != NULL ? pool->count : 0);
+}
+
+/**
+ * Returns how many chunks were stolen by a thread from the deque of another worker of a S4C_Pool.
+ * @param pool The S4C_Pool to read, may be NULL.
+ * @return How many chunks were stolen, 0 for NULL.
+ */
+unsigned long s4c_pool_steals(S4C_Pool* pool)
+{
+    return (pool != NULL ? atomic_load(&pool->steals) : 0);
+}
+
+/**
+ * Calls fn on chunks of the range from 0 to count, in parallel on the threads of a S4C_Pool, and returns once all chunks completed.
+ * The calling thread runs chunks too. Calls can be nested inside fn, or made from different threads at once.
+ * Runs fn on the whole range on the calling thread when pool is NULL, has no workers, or the range fits in one chunk.
+ * @param pool The S4C_Pool to use, may be NULL.
+ * @param count How many indexes there are.
+ * @param grain How many indexes go in a chunk. 0 or less picks a size giving a few chunks to each worker.
+ * @param fn Function called with arg and each chunk, from an index to the one past its last.
+ * @param arg Argument passed to fn.
+ */
+void s4c_pool_parallel_for(S4C_Pool* pool, int count, int grain, void (*fn)(void* arg, int from, int to), void* arg)
+{
+    if (count <= 0) {
+        return;
+    }
+    if (grain <= 0) {
+        grain = (pool != NULL ? count / (4 * (pool->count + 1)) : count);
+        grain = (grain > 0 ? grain : 1);
+    }
+    if (pool == NULL || pool->count == 0 || count <= grain) {
+        fn(arg, 0, count);
+        return;
+    }
+    int chunks = (count + grain - 1) / grain;
+    S4C_Pool_Job job = {
+        .fn = fn, .arg = arg,
+    };
+    atomic_init(&job.remaining, chunks);
+    for (int from = 0; from < count; from += grain) {
+        S4C_Pool_Task task = {
+            .job = &job, .from = from, .to = (count - from > grain ? from + grain : count),
+        };
+        unsigned int next = atomic_fetch_add(&pool->next, 1);
+        if (!s4c_pool_push(pool, &pool->deques[next % pool->count], task)) {
+            // Out of memory, run the chunk here
+            s4c_pool_run(pool, &task);
+        }
+    }
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+    // Help with any queued chunk, then wait for the ones still running
+    while (atomic_load(&job.remaining) > 0) {
+        S4C_Pool_Task task;
+        if (s4c_pool_take(pool, -1, &task)) {
+            s4c_pool_run(pool, &task);
+            continue;
+        }
+        pthread_mutex_lock(&pool->lock);
+        if (atomic_load(&job.remaining) > 0) {
+            pthread_cond_wait(&pool->done, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+/**
+ * Waits for the queued chunks of a S4C_Pool, joins its threads and frees it.
+ * If the pool is the one set with s4c_set_pool(), s4c_set_pool(NULL) should be called first.
+ * @param pool The S4C_Pool to stop.
+ */
+void s4c_pool_stop(S4C_Pool* pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+    s4c_pool_join(pool, pool->count);
+}
+
+/**
+ * Sets the S4C_Pool used by the library to preprocess frames: decoding index planes and computing diff stats.
+ * Not thread-safe, meant to be called before loading.
+ * @param pool The S4C_Pool to use, or NULL to preprocess on the calling thread.
+ * @see s4c_index_plane_from_sprites()
+ * @see s4c_sprites_diff_stats()
+ */
+void s4c_set_pool(S4C_Pool* pool)
+{
+    s4c_shared_pool = pool;
+}
+
+/**
+ * Returns the S4C_Pool used by the library to preprocess frames.
+ * @see s4c_set_pool()
+ * @return The S4C_Pool, or NULL.
+ */
+S4C_Pool* s4c_get_pool(void)
+{
+    return s4c_shared_pool;
+}
+
+/**
+ * Initialises a S4C_State_Buffer, with three empty snapshots of capacity instances.
+ * @param buf The S4C_State_Buffer to initialise.
+ * @param capacity How many instances a snapshot can hold.
+ * @see s4c_state_buffer_free()
+ * @return 0 if successful, S4C_ERR_RANGE if the arguments are invalid, S4C_ERR_ALLOC if allocation failed.
+ */
+int s4c_state_buffer_init(S4C_State_Buffer* buf, int capacity)
+{
+    if (buf == NULL || capacity < 1) {
+        return S4C_ERR_RANGE;
+    }
+    S4C_Instance_State* states = s4c_mem_calloc(S4C_MEM_PLAYBACK, 3 * (size_t) capacity, sizeof(S4C_Instance_State));
+    if (states == NULL) {
+        return S4C_ERR_ALLOC;
+    }
+    *buf = (S4C_State_Buffer) {
+        .states = states,
+        .capacity = capacity,
+        .back = 0,
+        .front = 2,
+    };
+    atomic_init(&buf->middle, 1);
+    return 0;
+}
+
+/**
+ * Returns the buffer of a S4C_State_Buffer for the writer to fill. Only called by the writer thread.
+ * It holds an older snapshot, so all the instances to publish should be set again.
+ * @param buf The S4C_State_Buffer to write.
+ * @see s4c_state_buffer_publish()
+ * @return The buffer, holding buf->capacity instances.
+ */
+S4C_Instance_State* s4c_state_buffer_write(S4C_State_Buffer* buf)
+{
+    return buf->states + (size_t) buf->back * buf->capacity;
+}
+
+/**
+ * Publishes the buffer filled by the writer of a S4C_State_Buffer, and takes another one to fill. Never blocks.
+ * Only called by the writer thread.
+ * @param buf The S4C_State_Buffer to publish to.
+ * @param count How many instances were set, clamped to the capacity.
+ * @see s4c_state_buffer_write()
+ */
+void s4c_state_buffer_publish(S4C_State_Buffer* buf, int count)
+{
+    buf->counts[buf->back] = (count < 0 ? 0 : (count > buf->capacity ? buf->capacity : count));
+    buf->seqs[buf->back] = ++buf->published;
+    // Releases the snapshot to the reader, and acquires the buffer it last released
+    int prev = atomic_exchange_explicit(&buf->middle, buf->back | S4C_STATE_FRESH, memory_order_acq_rel);
+    buf->back = prev & ~S4C_STATE_FRESH;
+}
+
+/**
+ * Returns the latest snapshot published to a S4C_State_Buffer. Never blocks. Only called by the reader thread.
+ * The snapshot stays valid and unchanged until the next call.
+ * @param buf The S4C_State_Buffer to read.
+ * @param count Set to how many instances the snapshot holds.
+ * @param seq If not NULL, set to how many snapshots were published up to this one, 0 if none was.
+ * @return The snapshot.
+ */
+const S4C_Instance_State* s4c_state_buffer_read(S4C_State_Buffer* buf, int* count, unsigned long* seq)
+{
+    if (atomic_load_explicit(&buf->middle, memory_order_relaxed) & S4C_STATE_FRESH) {
+        int prev = atomic_exchange_explicit(&buf->middle, buf->front, memory_order_acq_rel);
+        buf->front = prev & ~S4C_STATE_FRESH;
+    }
+    *count = buf->counts[buf->front];
+    if (seq != NULL) {
+        *seq = buf->seqs[buf->front];
+    }
+    return buf->states + (size_t) buf->front * buf->capacity;
+}
+
+/**
+ * Frees the buffers of a S4C_State_Buffer. The threads using it must be done with it.
+ * @param buf The S4C_State_Buffer to free.
+ */
+void s4c_state_buffer_free(S4C_State_Buffer* buf)
+{
+    if (buf == NULL) {
+        return;
+    }
+    s4c_mem_free(buf->states);
+    *buf = (S4C_State_Buffer) {
+        0
+    };
+}
+
+/**
+ * Returns the palette index for a sprite char, so that '1' is index 0.
+ * Chars with no palette entry, and entries past the range of an index, are mapped to S4C_INDEX_TRANSPARENT.
+ * @param c The sprite char.
+ * @return The palette index.
+ */
+uint8_t s4c_char_to_index(char c)
+{
+    short p = s4c_char_palette_lut[(unsigned char) c];
+    return ((p < 0 || p >= S4C_INDEX_TRANSPARENT) ? S4C_INDEX_TRANSPARENT : (uint8_t) p);
+}
+
+/**
+ * Initialises a S4C_Index_Plane with all pixels set to S4C_INDEX_TRANSPARENT.
+ * @param plane The S4C_Index_Plane to initialise.
+ * @param frame_count How many frames the plane has.
+ * @param frameheight Height of each frame.
+ * @param framewidth Width of each frame.
+ * @see s4c_index_plane_free()
+ * @see S4C_ERR_RANGE
+ * @return 0 if successful, a negative value otherwise.
+ */
+int s4c_index_plane_init(S4C_Index_Plane* plane, int frame_count, int frameheight, int framewidth)
+{
+    if (plane == NULL || frame_count <= 0 || frameheight <= 0 || framewidth <= 0) {
+        return S4C_ERR_RANGE;
+    }
+    size_t size = (size_t) frame_count * frameheight * framewidth;
+    S4C_Index_Plane res = {0};
+    res.data = s4c_mem_malloc(S4C_MEM_ANIMATIONS, size);
+    res.durations = s4c_mem_calloc(S4C_MEM_ANIMATIONS, frame_count, sizeof(int));
+    if (res.data == NULL || res.durations == NULL) {
+        s4c_mem_free(res.data);
+        s4c_mem_free(res.durations);
+        return S4C_ERR_ALLOC;
+    }
+    memset(res.data, S4C_INDEX_TRANSPARENT, size);
+    res.frame_count = frame_count;
+    res.frameheight = frameheight;
+    res.framewidth = framewidth;
+    *plane = res;
+    return 0;
+}
+
+/**
+ * Holds the arguments of s4c_decode_frames().
+ */
+typedef struct S4C_Decode_Job {
+    S4C_Index_Plane* plane; /**< Plane to decode to.*/
+    char (*sprites)[S4C_MAXROWS][S4C_MAXCOLS]; /**< Frames to decode.*/
+} S4C_Decode_Job;
+
+/**
+ * Decodes a range of frames into a S4C_Index_Plane, as a chunk of s4c_pool_parallel_for().
+ */
+static void s4c_decode_frames(void* arg, int from, int to)
+{
+    S4C_Decode_Job* job = arg;
+    uint8_t* dst = s4c_index_plane_frame(job->plane, from);
+    for (int f = from; f < to; f++) {
+        for (int j = 0; j < job->plane->frameheight; j++) {
+            for (int i = 0; i < job->plane->framewidth; i++) {
+                *dst++ = s4c_char_to_index(job->sprites[f][j][i]);
+            }
+        }
+    }
+}
+
+/**
+ * Decodes a sprites array into a new S4C_Index_Plane, once, so that renderers don't have to decode chars on each draw.
+ * Frames are decoded in parallel on the pool set with s4c_set_pool(), if any.
+ * @param plane The S4C_Index_Plane to initialise.
+ * @param sprites The sprites array.
+ * @param frame_count How many frames to decode.
+ * @param frameheight Height of each frame.
+ * @param framewidth Width of each frame.
+ * @see s4c_char_to_index()
+ * @return 0 if successful, a negative value otherwise.
+ */
+int s4c_index_plane_from_sprites(S4C_Index_Plane* plane, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int frame_count, int frameheight, int framewidth)
+{
+    int res = s4c_index_plane_init(plane, frame_count, frameheight, framewidth);
+    if (res != 0) {
+        return res;
+    }
+    S4C_Decode_Job job = {
+        .plane = plane, .sprites = sprites,
+    };
+    s4c_pool_parallel_for(s4c_shared_pool, frame_count, 0, s4c_decode_frames, &job);
+    return 0;
+}
+
+/**
+ * Returns a S4C_Frame_View showing a frame of a S4C_Index_Plane with a S4C_Transform applied, without copying it.
+ * @param plane The S4C_Index_Plane to view.
+ * @param frame_index Index of the frame.
+ * @param transform The S4C_Transform to apply.
+ * @return The S4C_Frame_View for the frame.
+ */
+S4C_Frame_View s4c_index_plane_view(const S4C_Index_Plane* plane, int frame_index, S4C_Transform transform)
+{
+    return s4c_make_view(s4c_index_plane_frame(plane, frame_index), plane->framewidth, plane->frameheight, plane->framewidth, transform, S4C_PIXELS_INDEXES);
+}
+
+/**
+ * Frees the memory held by a S4C_Index_Plane.
+ * @param plane The S4C_Index_Plane to free.
+ */
+void s4c_index_plane_free(S4C_Index_Plane* plane)
+{
+    if (plane == NULL) {
+        return;
+    }
+    s4c_mem_free(plane->data);
+    s4c_mem_free(plane->durations);
+    plane->data = NULL;
+    plane->durations = NULL;
+    plane->frame_count = 0;
+}
+
+/**
+ * Returns how many bytes of memory are held by the passed S4C_Index_Plane.
+ * @param plane The S4C_Index_Plane to query.
+ * @see s4c_mem_stats()
+ * @return The number of bytes held.
+ */
+size_t s4c_index_plane_bytes(const S4C_Index_Plane* plane)
+{
+    if (plane == NULL) {
+        return 0;
+    }
+    return s4c_mem_size(plane->data) + s4c_mem_size(plane->durations);
+}
+
+/**
+ * Returns the name of the kernel used by s4c_unpack_row(): "avx2", "sse2" or "scalar".
+ * The kernel is picked at compile time. Defining S4C_NO_SIMD forces the scalar one.
+ * Without AVX2, 5-bit fields are unpacked eight at a time from 40-bit words.
+ * @return The kernel name.
+ */
+const char* s4c_unpack_kernel_name(void)
+{
+#if defined(S4C_UNPACK_AVX2)
+    return "avx2";
+#elif defined(S4C_UNPACK_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+/**
+ * Unpacks a row of 4-bit or 5-bit pixel codes into one byte for each pixel.
+ * Uses SSE2 for 4-bit rows, and AVX2 for 5-bit rows, when available at compile time.
+ * Reads no byte past the (count * bits + 7) / 8 bytes of the packed row.
+ * @param packed The packed row.
+ * @param bits Bits for each pixel, 4 or 5.
+ * @param count How many pixels to unpack.
+ * @param out Buffer of at least count bytes, set to the pixel codes.
+ * @see s4c_unpack_kernel_name()
+ * @see S4C_ERR_RANGE
+ * @return 0 if successful, S4C_ERR_RANGE if bits is not 4 or 5, leaving out untouched.
+ */
+int s4c_unpack_row(const uint8_t* packed, int bits, int count, uint8_t* out)
+{
+    if (bits != 4 && bits != 5) {
+        return S4C_ERR_RANGE;
+    }
+    int i = 0;
+    if (bits == 4) {
+#if defined(S4C_UNPACK_AVX2) || defined(S4C_UNPACK_SSE2)
+        const __m128i nibble = _mm_set1_epi8(0x0F);
+        for (; i + 32 <= count; i += 32) {
+            __m128i v = _mm_loadu_si128((const __m128i*) (packed + i / 2));
+            __m128i lo = _mm_and_si128(v, nibble);
+            __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+            _mm_storeu_si128((__m128i*) (out + i), _mm_unpacklo_epi8(lo, hi));
+            _mm_storeu_si128((__m128i*) (out + i + 16), _mm_unpackhi_epi8(lo, hi));
+        }
+#endif
+        for (; i + 2 <= count; i += 2) {
+            uint8_t b = packed[i / 2];
+            out[i] = b & 0x0F;
+            out[i + 1] = b >> 4;
+        }
+        if (i < count) {
+            out[i] = packed[i / 2] & 0x0F;
+        }
+        return 0;
+    }
+#if defined(S4C_UNPACK_AVX2)
+    // Each 32-bit lane gets the 4 bytes holding one of 8 pixels, then is shifted to it
+    const __m256i gather = _mm256_setr_epi8(0, 1, 2, 3, 0, 1, 2, 3, 1, 2, 3, 4, 1, 2, 3, 4,
+                                            2, 3, 4, 5, 3, 4, 5, 6, 3, 4, 5, 6, 4, 5, 6, 7);
+    const __m256i shifts = _mm256_setr_epi32(0, 5, 2, 7, 4, 1, 6, 3);
+    const __m256i field = _mm256_set1_epi32(0x1F);
+    const __m256i low_bytes = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                              0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i join = _mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1);
+    // Loads 8 bytes for 8 pixels: 12 pixels left guarantee the 3 extra bytes are in the row
+    for (; i + 12 <= count; i += 8) {
+        __m128i bytes = _mm_loadl_epi64((const __m128i*) (packed + i / 8 * 5));
+        __m256i v = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(bytes), gather);
+        v = _mm256_and_si256(_mm256_srlv_epi32(v, shifts), field);
+        v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, low_bytes), join);
+        _mm_storel_epi64((__m128i*) (out + i), _mm256_castsi256_si128(v));
+    }
+#endif
+    for (; i + 8 <= count; i += 8) {
+        const uint8_t* src = packed + i / 8 * 5;
+        uint64_t word = (uint64_t) src[0] | ((uint64_t) src[1] << 8) | ((uint64_t) src[2] << 16)
+                        | ((uint64_t) src[3] << 24) | ((uint64_t) src[4] << 32);
+        for (int k = 0; k < 8; k++) {
+            out[i + k] = (word >> (5 * k)) & 0x1F;
+        }
+    }
+    for (; i < count; i++) {
+        int bit = i * 5;
+        unsigned int v = packed[bit / 8] >> (bit % 8);
+        if (bit % 8 > 3) {
+            v |= (unsigned int) packed[bit / 8 + 1] << (8 - bit % 8);
+        }
+        out[i] = v & 0x1F;
+    }
+    return 0;
+}
+
+/**
+ * Packs a S4C_Index_Plane into a new S4C_Packed_Plane, mapping each palette index it uses to a pixel code.
+ * The index plane is left untouched, and can be freed afterwards.
+ * @param packed The S4C_Packed_Plane to initialise.
+ * @param plane The S4C_Index_Plane to pack. Frames can't be bigger than S4C_MAXROWS by S4C_MAXCOLS.
+ * @param bits Bits for each pixel: 4 for up to 16 distinct indexes, 5 for up to 32, or 0 to pick the smallest that fits.
+ * @see s4c_packed_plane_free()
+ * @see S4C_ERR_RANGE
+ * @return 0 if successful, S4C_ERR_RANGE if the plane uses too many indexes or is too big, S4C_ERR_ALLOC if allocation failed.
+ */
+int s4c_packed_plane_from_index_plane(S4C_Packed_Plane* packed, const S4C_Index_Plane* plane, int bits)
+{
+    if (packed == NULL || plane == NULL || plane->data == NULL || (bits != 0 && bits != 4 && bits != 5)
+        || plane->frameheight > S4C_MAXROWS || plane->framewidth > S4C_MAXCOLS) {
+        return S4C_ERR_RANGE;
+    }
+    size_t rows = (size_t) plane->frame_count * plane->frameheight;
+    bool used[256] = {0};
+    for (size_t p = 0; p < rows * plane->framewidth; p++) {
+        used[plane->data[p]] = true;
+    }
+    S4C_Packed_Plane res = {0};
+    uint8_t codes[256] = {0};
+    for (int idx = 0; idx < 256; idx++) {
+        if (used[idx]) {
+            if (res.num_indexes == S4C_PACKED_MAX_CODES) {
+                return S4C_ERR_RANGE;
+            }
+            codes[idx] = res.num_indexes;
+            res.indexes[res.num_indexes++] = idx;
+        }
+    }
+    if (bits == 0) {
+        bits = (res.num_indexes <= 16 ? 4 : 5);
+    }
+    if (res.num_indexes > (1 << bits)) {
+        return S4C_ERR_RANGE;
+    }
+    res.bits = bits;
+    res.row_bytes = ((size_t) plane->framewidth * bits + 7) / 8;
+    res.data = s4c_mem_calloc(S4C_MEM_ANIMATIONS, rows, res.row_bytes);
+    res.durations = s4c_mem_calloc(S4C_MEM_ANIMATIONS, plane->frame_count, sizeof(int));
+    if (res.data == NULL || res.durations == NULL) {
+        s4c_mem_free(res.data);
+        s4c_mem_free(res.durations);
+        return S4C_ERR_ALLOC;
+    }
+    if (plane->durations != NULL) {
+        memcpy(res.durations, plane->durations, plane->frame_count * sizeof(int));
+    }
+    for (size_t r = 0; r < rows; r++) {
+        const uint8_t* src = plane->data + r * plane->framewidth;
+        uint8_t* dst = res.data + r * res.row_bytes;
+        for (int i = 0; i < plane->framewidth; i++) {
+            int bit = i * bits;
+            unsigned int code = codes[src[i]];
+            dst[bit / 8] |= (uint8_t) (code << (bit % 8));
+            if (bit % 8 + bits > 8) {
+                dst[bit / 8 + 1] |= (uint8_t) (code >> (8 - bit % 8));
+            }
+        }
+    }
+    res.frame_count = plane->frame_count;
+    res.frameheight = plane->frameheight;
+    res.framewidth = plane->framewidth;
+    *packed = res;
+    return 0;
+}
+
+/**
+ * Unpacks a frame of a S4C_Packed_Plane into scratch, one row at a time, as pixel codes.
+ * @param packed The S4C_Packed_Plane to unpack.
+ * @param frame_index Index of the frame.
+ * @param scratch Buffer of at least S4C_PACKED_SCRATCH_SIZE bytes. Rows are framewidth bytes apart.
+ */
+static void s4c_packed_plane_unpack_frame(const S4C_Packed_Plane* packed, int frame_index, uint8_t* scratch)
+{
+    for (int j = 0; j < packed->frameheight; j++) {
+        s4c_unpack_row(s4c_packed_plane_row(packed, frame_index, j), packed->bits, packed->framewidth, scratch + (size_t) j * packed->framewidth);
+    }
+}
+
+/**
+ * Unpacks a frame of a S4C_Packed_Plane into scratch, and returns a S4C_Frame_View of its palette indexes with a S4C_Transform applied.
+ * The view is valid while scratch is not changed.
+ * @param packed The S4C_Packed_Plane to view.
+ * @param frame_index Index of the frame.
+ * @param transform The S4C_Transform to apply.
+ * @param scratch Buffer of at least S4C_PACKED_SCRATCH_SIZE bytes.
+ * @return The S4C_Frame_View for the frame, with no rows if frame_index is out of range.
+ */
+S4C_Frame_View s4c_packed_plane_view(const S4C_Packed_Plane* packed, int frame_index, S4C_Transform transform, uint8_t* scratch)
+{
+    if (packed == NULL || packed->data == NULL || scratch == NULL || frame_index < 0 || frame_index >= packed->frame_count) {
+        return (S4C_Frame_View) {
+            .origin = scratch, .encoding = S4C_PIXELS_INDEXES,
+        };
+    }
+    s4c_packed_plane_unpack_frame(packed, frame_index, scratch);
+    size_t pixels = (size_t) packed->frameheight * packed->framewidth;
+    for (size_t p = 0; p < pixels; p++) {
+        scratch[p] = packed->indexes[scratch[p]];
+    }
+    return s4c_make_view(scratch, packed->framewidth, packed->frameheight, packed->framewidth, transform, S4C_PIXELS_INDEXES);
+}
+
+/**
+ * Frees the memory held by a S4C_Packed_Plane.
+ * @param packed The S4C_Packed_Plane to free.
+ */
+void s4c_packed_plane_free(S4C_Packed_Plane* packed)
+{
+    if (packed == NULL) {
+        return;
+    }
+    s4c_mem_free(packed->data);
+    s4c_mem_free(packed->durations);
+    packed->data = NULL;
+    packed->durations = NULL;
+    packed->frame_count = 0;
+}
+
+/**
+ * Returns how many bytes of memory are held by the passed S4C_Packed_Plane.
+ * @param packed The S4C_Packed_Plane to query.
+ * @see s4c_mem_stats()
+ * @return The number of bytes held.
+ */
+size_t s4c_packed_plane_bytes(const S4C_Packed_Plane* packed)
+{
+    if (packed == NULL) {
+        return 0;
+    }
+    return s4c_mem_size(packed->data) + s4c_mem_size(packed->durations);
+}
+
+/**
+ * Returns the name of the kernel used by s4c_diff_row(): "avx2", "sse2" or "scalar".
+ * The kernel is picked at compile time. Defining S4C_NO_SIMD forces the scalar one.
+ * @return The kernel name.
+ */
+const char* s4c_diff_kernel_name(void)
+{
+#if defined(S4C_DIFF_AVX2)
+    return "avx2";
+#elif defined(S4C_DIFF_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+#if defined(S4C_DIFF_AVX2) || defined(S4C_DIFF_SSE2)
+/**
+ * Marks the changed bytes of a compared chunk in first and last.
+ * @param mask Bitmask of the changed bytes in the chunk, bit 0 being the byte at offset.
+ * @param offset Offset of the chunk in the row.
+ * @param first Pointer to the first changed byte, -1 if none yet.
+ * @param last Pointer to the last changed byte.
+ */
+static inline void s4c_diff_mark(unsigned int mask, int offset, int* first, int* last)
+{
+    if (mask == 0) {
+        return;
+    }
+#if defined(__GNUC__) || defined(__clang__)
+    int lo = __builtin_ctz(mask);
+    int hi = 31 - __builtin_clz(mask);
+#else
+    int lo = 0, hi = 31;
+    while (!(mask & (1u << lo))) {
+        lo++;
+    }
+    while (!(mask & (1u << hi))) {
+        hi--;
+    }
+#endif
+    if (*first < 0) {
+        *first = offset + lo;
+    }
+    *last = offset + hi;
+}
+#endif
+
+/**
+ * Compares two rows of pixels and finds the changed span.
+ * Uses AVX2 or SSE2 when available at compile time, so that a row takes one or two vector compares.
+ * @param a The first row.
+ * @param b The second row.
+ * @param len How many pixels to compare.
+ * @param from Pointer to set to the first changed column. Can be NULL.
+ * @param to Pointer to set to the column past the last changed one. Can be NULL.
+ * @see s4c_diff_kernel_name()
+ * @return 1 if the rows differ, 0 otherwise.
+ */
+int s4c_diff_row(const char* a, const char* b, int len, int* from, int* to)
+{
+    int first = -1;
+    int last = -1;
+    int i = 0;
+#if defined(S4C_DIFF_AVX2)
+    for (; i + 32 <= len; i += 32) {
+        __m256i va = _mm256_loadu_si256((const __m256i*) (a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*) (b + i));
+        unsigned int eq = (unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+        s4c_diff_mark(~eq, i, &first, &last);
+    }
+#endif
+#if defined(S4C_DIFF_AVX2) || defined(S4C_DIFF_SSE2)
+    for (; i + 16 <= len; i += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i*) (a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*) (b + i));
+        unsigned int eq = (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb));
+        s4c_diff_mark(~eq & 0xFFFFu, i, &first, &last);
+    }
+#endif
+    for (; i < len; i++) {
+        if (a[i] != b[i]) {
+            if (first < 0) {
+                first = i;
+            }
+            last = i;
+        }
+    }
+    if (first < 0) {
+        return 0;
+    }
+    if (from != NULL) {
+        *from = first;
+    }
+    if (to != NULL) {
+        *to = last + 1;
+    }
+    return 1;
+}
+
+/**
+ * Compares two frames row by row and returns the changed spans, one for each changed row.
+ * @param prev The first frame.
+ * @param next The second frame.
+ * @param frameheight Height of the frames.
+ * @param framewidth Width of the frames.
+ * @param spans Array of at least frameheight S4C_Span, set to the changed spans in row order. Can be NULL.
+ * @see s4c_diff_row()
+ * @return How many rows changed.
+ */
+int s4c_frame_diff(char prev[][S4C_MAXCOLS], char next[][S4C_MAXCOLS], int frameheight, int framewidth, S4C_Span* spans)
+{
+    int changed = 0;
+    for (int j = 0; j < frameheight; j++) {
+        int from, to;
+        if (s4c_diff_row(prev[j], next[j], framewidth, &from, &to)) {
+            if (spans != NULL) {
+                spans[changed] = (S4C_Span) {
+                    j, from, to
+                };
+            }
+            changed++;
+        }
+    }
+    return changed;
+}
+
+/**
+ * Holds the arguments and result of s4c_diff_frames().
+ */
+typedef struct S4C_Diff_Job {
+    char (*sprites)[S4C_MAXROWS][S4C_MAXCOLS]; /**< Frames to compare.*/
+    int frameheight; /**< Height of the frames.*/
+    int framewidth; /**< Width of the frames.*/
+    pthread_mutex_t lock; /**< Protects res.*/
+    S4C_Diff_Stats res; /**< Stats added up by all chunks.*/
+} S4C_Diff_Job;
+
+/**
+ * Compares a range of frames with the ones before them, as a chunk of s4c_pool_parallel_for().
+ * Index k stands for frame k+1, since the first frame has no previous one.
+ */
+static void s4c_diff_frames(void* arg, int from, int to)
+{
+    S4C_Diff_Job* job = arg;
+    S4C_Diff_Stats res = {0};
+    S4C_Span spans[S4C_MAXROWS];
+    for (int i = from + 1; i < to + 1; i++) {
+        int changed = s4c_frame_diff(job->sprites[i-1], job->sprites[i], job->frameheight, job->framewidth, spans);
+        res.total_cells += (long) job->frameheight * job->framewidth;
+        res.changed_rows += changed;
+        for (int k = 0; k < changed; k++) {
+            res.changed_cells += spans[k].to - spans[k].from;
+        }
+        if (changed == 0) {
+            res.unchanged_frames++;
+            res.duplicate_frames++;
+            continue;
+        }
+        for (int j = 0; j < i - 1; j++) {
+            if (s4c_frame_diff(job->sprites[j], job->sprites[i], job->frameheight, job->framewidth, NULL) == 0) {
+                res.duplicate_frames++;
+                break;
+            }
+        }
+    }
+    pthread_mutex_lock(&job->lock);
+    job->res.duplicate_frames += res.duplicate_frames;
+    job->res.unchanged_frames += res.unchanged_frames;
+    job->res.changed_rows += res.changed_rows;
+    job->res.changed_cells += res.changed_cells;
+    job->res.total_cells += res.total_cells;
+    pthread_mutex_unlock(&job->lock);
+}
+
+/**
+ * Computes dedup and delta stats for an animation.
+ * Frames are compared in parallel on the pool set with s4c_set_pool(), if any.
+ * Frames equal to an earlier one are counted as duplicates, and the changed spans between consecutive frames are summed up.
+ * @param sprites The sprites array.
+ * @param num_frames Index of the last frame of the animation.
+ * @param frameheight Height of the frames.
+ * @param framewidth Width of the frames.
+ * @param stats Pointer to the S4C_Diff_Stats to set.
+ * @see s4c_frame_diff()
+ */
+void s4c_sprites_diff_stats(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int num_frames, int frameheight, int framewidth, S4C_Diff_Stats* stats)
+{
+    S4C_Diff_Job job = {
+        .sprites = sprites, .frameheight = frameheight, .framewidth = framewidth,
+    };
+    pthread_mutex_init(&job.lock, NULL);
+    job.res.frames = (num_frames >= 0 ? num_frames + 1 : 0);
+    s4c_pool_parallel_for(s4c_shared_pool, num_frames, 0, s4c_diff_frames, &job);
+    pthread_mutex_destroy(&job.lock);
+    *stats = job.res;
+}
+
+/**
+ * Returns how many mseconds a frame is displayed.
+ * @param durations Display duration of each frame in mseconds, 0 for frames using frametime. Can be NULL.
+ * @param frame_index Index of the frame.
+ * @param frametime Duration used for frames without their own.
+ * @return The duration of the frame in mseconds.
+ */
+int s4c_frame_duration(const int durations[], int frame_index, int frametime)
+{
+    if (durations != NULL && frame_index >= 0 && durations[frame_index] > 0) {
+        return durations[frame_index];
+    }
+    return frametime;
+}
+
+/**
+ * Collapses runs of identical consecutive frames of a sprites array into one frame, adding up their durations.
+ * Useful for files where a frame is held by repeating it: playback with the returned durations is unchanged,
+ * while each held frame is stored and drawn once.
+ * Every entry of durations up to the returned index is set, to the frame duration or a sum of them.
+ * @param sprites The sprites array. Frames are moved down to fill the removed ones.
+ * @param durations Display duration of each frame in mseconds, 0 for frames using frametime. Must have num_frames + 1 entries.
+ * @param num_frames Index of the last frame of the array.
+ * @param frameheight Height of each frame.
+ * @param framewidth Width of each frame.
+ * @param frametime Duration for frames without their own.
+ * @see s4c_frame_duration()
+ * @return Index of the last frame left, to pass as num_frames to playback.
+ */
+int s4c_sprites_collapse_holds(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int durations[], int num_frames, int frameheight, int framewidth, int frametime)
+{
+    int res = 0;
+    for (int i = 0; i <= num_frames; i++) {
+        int duration = s4c_frame_duration(durations, i, frametime);
+        if (res > 0 && s4c_frame_diff(sprites[res-1], sprites[i], frameheight, framewidth, NULL) == 0) {
+            durations[res-1] += duration;
+            continue;
+        }
+        if (res != i) {
+            memcpy(sprites[res], sprites[i], sizeof(sprites[0]));
+        }
+        durations[res] = duration;
+        res++;
+    }
+    return res - 1;
+}
+
+#ifndef S4C_RAYLIB_EXTENSION
+
+/**
+ * Holds the render mode used by all the functions drawing sprites to a WINDOW.
+ * @see s4c_set_render_mode()
+ */
+static S4C_Render_Mode s4c_render_mode = S4C_RENDER_FULLBLOCK;
+
+/**
+ * Holds the highest color pair index initialised by s4c with a single background.
+ * Used to keep s4c_color_pair() from handing out an index already in use.
+ */
+static int s4c_highest_color_pair = 0;
+
+/**
+ * Holds the lazily allocated (fg,bg) -> color pair table used by s4c_color_pair().
+ * A 0 entry means the pair was not initialised yet.
+ */
+static short* s4c_pairs_cache = NULL;
+
+/**
+ * Holds the next color pair index s4c_color_pair() will initialise.
+ */
+static int s4c_pairs_cache_next = 0;
+
+/**
+ * Holds the user clip rectangle, in window coordinates, applied to all the functions drawing sprites to a WINDOW.
+ * @see s4c_set_clip_rect()
+ */
+static S4C_Rect s4c_clip_rect = {0};
+
+/**
+ * Holds true if s4c_clip_rect is set.
+ */
+static bool s4c_has_clip_rect = false;
+
+/**
+ * Defines the color pair for a sprite char, or -1.
+ */
+#define S4C_CHAR_PAIR(b) ((S4C_CHAR_VALUE(b) - '0' + 8 >= 0 && S4C_CHAR_VALUE(b) - '0' + 8 < S4C_MAX_COLORS) ? S4C_CHAR_VALUE(b) - '0' + 8 : -1)
+
+/**
+ * Defines the color pair for a palette index, or -1.
+ */
+#define S4C_INDEX_PAIR(b) (((b) != S4C_INDEX_TRANSPARENT && (b) + S4C_BASE_COLOR_INDEX < S4C_MAX_COLORS) ? (b) + S4C_BASE_COLOR_INDEX : -1)
+
+/**
+ * Maps sprite chars to color pairs, as initialised by init_s4c_color_pairs(). -1 means the char is not drawn.
+ */
+static const short s4c_char_pair_lut[256] = { S4C_LUT_256(S4C_CHAR_PAIR) };
+
+/**
+ * Maps palette indexes to color pairs, as initialised by init_s4c_color_pairs(). -1 means the index is not drawn.
+ */
+static const short s4c_index_pair_lut[256] = { S4C_LUT_256(S4C_INDEX_PAIR) };
+
+/**
+ * Returns the color pair lookup table for the passed S4C_Pixel_Encoding.
+ */
+static inline const short* s4c_pair_lut(S4C_Pixel_Encoding encoding)
+{
+    return (encoding == S4C_PIXELS_INDEXES ? s4c_index_pair_lut : s4c_char_pair_lut);
+}
+
+/**
+ * Sets the render mode used by all the functions drawing sprites to a WINDOW.
+ * Not thread-safe: it should be set before starting any animation.
+ * @param mode The S4C_Render_Mode to use.
+ * @see S4C_Render_Mode
+ */
+void s4c_set_render_mode(S4C_Render_Mode mode)
+{
+    s4c_render_mode = mode;
+}
+
+/**
+ * Returns the render mode used by all the functions drawing sprites to a WINDOW.
+ * @return The current S4C_Render_Mode.
+ */
+S4C_Render_Mode s4c_get_render_mode(void)
+{
+    return s4c_render_mode;
+}
+
+/**
+ * Returns how many terminal rows a frame with the passed height takes, using current render mode.
+ * @param frameheight Height of the frame.
+ * @return The number of terminal rows needed.
+ */
+int s4c_render_rows(int frameheight)
+{
+    if (s4c_render_mode == S4C_RENDER_HALFBLOCK) {
+        return (frameheight + 1) / 2;
+    }
+    return frameheight;
+}
+
+/**
+ * Returns a color pair index for the passed foreground and background color indexes.
+ * Pairs are initialised lazily the first time a combination is requested, then cached.
+ * Indexes are handed out starting after S4C_PAIRS_CACHE_BASE and any pair s4c already initialised.
+ * @param fg_color_index The foreground color index.
+ * @param bg_color_index The background color index. -1 for the default background, which needs use_default_colors().
+ * @see S4C_ERR_RANGE
+ * @see S4C_ERR_COLORPAIRS
+ * @return The color pair index if successful, a negative value otherwise.
+ */
+int s4c_color_pair(int fg_color_index, int bg_color_index)
+{
+    if (fg_color_index < 0 || fg_color_index >= S4C_MAX_COLORS || bg_color_index < -1 || bg_color_index >= S4C_MAX_COLORS) {
+        return S4C_ERR_RANGE;
+    }
+    if (s4c_pairs_cache == NULL) {
+        // One more background column, for the default background
+        s4c_pairs_cache = s4c_mem_calloc(S4C_MEM_PALETTES, S4C_MAX_COLORS * (S4C_MAX_COLORS + 1), sizeof(short));
+        if (s4c_pairs_cache == NULL) {
+            return S4C_ERR_COLORPAIRS;
+        }
+        s4c_pairs_cache_next = S4C_PAIRS_CACHE_BASE;
+    }
+    if (s4c_pairs_cache_next <= s4c_highest_color_pair) {
+        s4c_pairs_cache_next = s4c_highest_color_pair + 1;
+    }
+    short* cached = &s4c_pairs_cache[fg_color_index * (S4C_MAX_COLORS + 1) + bg_color_index + 1];
+    if (*cached > 0) {
+        return *cached;
+    } else if (*cached < 0) {
+        // init_pair() already failed for this combination
+        return S4C_ERR_COLORPAIRS;
+    }
+    int max_pairs = (COLOR_PAIRS < SHRT_MAX ? COLOR_PAIRS : SHRT_MAX);
+    if (s4c_pairs_cache_next >= max_pairs) {
+        return S4C_ERR_COLORPAIRS;
+    }
+    if (init_pair(s4c_pairs_cache_next, fg_color_index, bg_color_index) == ERR) {
+        *cached = -1;
+        return S4C_ERR_COLORPAIRS;
+    }
+    *cached = s4c_pairs_cache_next++;
+    return *cached;
+}
+
+/**
+ * Frees the color pair cache used by s4c_color_pair().
+ * Should be called if color pairs are reset, e.g. after calling start_color() again.
+ */
+void s4c_reset_color_pairs_cache(void)
+{
+    s4c_mem_free(s4c_pairs_cache);
+    s4c_pairs_cache = NULL;
+    s4c_pairs_cache_next = 0;
+}
+
+/**
+ * Initialises a color pair from a passed S4C_Color pointer.
+ * @param palette The S4C_Color pointer array at hand.
+ * @param color_index The resulting color index for defined colorpair.
+ * @param bg_color_index The color index for background color of defined colorpair. Typical values are 0 or, only after use_default_colors(), -1.
+ */
+void init_s4c_color_pair_ex(S4C_Color* color, int color_index, int bg_color_index)
+{
+
+    if (color == NULL) {
+        fprintf(stderr,"Error: invalid S4C_Color at %s().",__func__);
+        exit(EXIT_FAILURE);
+    }
+
+    int r, g, b;
+    char color_name[50];
+
+    r = color->red;
+    g = color->green;
+    b = color->blue;
+    strcpy(color_name,color->name);
+
+    int proportional_r = (((float)r + 1.0) / 256)*1000;
+    int proportional_g = (((float)g + 1.0) / 256)*1000;
+    int proportional_b = (((float)b + 1.0) / 256)*1000;
+    init_color(color_index, proportional_r, proportional_g, proportional_b);
+    init_pair(color_index, color_index, bg_color_index);
+    if (color_index > s4c_highest_color_pair) {
+        s4c_highest_color_pair = color_index;
+    }
+}
+
+/**
+ * Initialises a color pair from a passed S4C_Color pointer.
+ * The background color index for the defined color pair is 0.
+ * @param palette The S4C_Color pointer array at hand.
+ * @param color_index The resulting color index for defined colorpair.
+ */
+void init_s4c_color_pair(S4C_Color* color, int color_index)
+{
+    init_s4c_color_pair_ex(color, color_index, 0);
+}
+
+/**
+ * Initialises a color pair from a passed S4C_Color pointer.
+ * It sets the background color index for the pair to -1.
+ * This is useless to any curses implementation that does not support use_default_colors().
+ * In that case, plain init_s4c_color_pair() should be used.
+ * @param palette The S4C_Color pointer array at hand.
+ * @param color_index The resulting color index for defined colorpair.
+ */
+void init_s4c_color_pair_default_bg(S4C_Color* color, int color_index)
+{
+    init_s4c_color_pair_ex(color, color_index, -1);
+}
+
+#endif
+
+const char* s4c_color_strings[S4C_MAX_COLOR_INDEX+1] = {
+    "S4C_BLACK",
+    "S4C_RED",
+    "S4C_BRIGHT_GREEN",
+    "S4C_BRIGHT_YELLOW",
+    "S4C_BLUE",
+    "S4C_MAGENTA",
+    "S4C_CYAN",
+    "S4C_WHITE",
+    "S4C_ORANGE",
+    "S4C_LIGHT_BROWN",
+    "S4C_DARK_BROWN",
+    "S4C_PURPLE",
+    "S4C_DARK_GREEN",
+    "S4C_GREY",
+    "S4C_LIGHT_YELLOW",
+    "S4C_LIGHT_BLUE",
+    "S4C_DARK_YELLOW",
+    "S4C_DARK_OLIVE",
+    "S4C_LIGHT_OLIVE",
+    "S4C_OLIVE",
+    "S4C_DARK_CHERRY",
+    "S4C_LIGHT_CHERRY",
+    "S4C_CHERRY",
+    "S4C_SALMON",
+    "S4C_DARK_BLUE",
+    "S4C_VIOLET",
+    "S4C_INDIGO",
+    "S4C_LIGHT_ORANGE",
+    "S4C_TEAL",
+    "S4C_DARK_CYAN",
+    "S4C_DARK_PURPLE",
+    "S4C_LIGHT_PURPLE",
+};
+
+const char* s4c_color_name(S4C_Color_Index color_index)
+{
+    if (color_index < S4C_MIN_COLOR_INDEX || color_index > S4C_MAX_COLOR_INDEX) {
+        fprintf(stderr,"[%s]:  Invalid color index { %i }, { %s -> [%i] }.", __func__, color_index, (color_index < S4C_MIN_COLOR_INDEX ? "Below min valid value " : "Above max valid value"), (color_index < S4C_MIN_COLOR_INDEX ? S4C_MIN_COLOR_INDEX : S4C_MAX_COLOR_INDEX));
+        abort();
+    }
+    return s4c_color_strings[color_index-S4C_MIN_COLOR_INDEX];
+}
+
+#ifndef S4C_RAYLIB_EXTENSION
+/**
+ * Initialises all the needed color pairs for animate, from the palette file.
+ * @param palette The palette file to read the colors from.
+ */
+void init_s4c_color_pairs(FILE* palette)
+{
+
+    char line[S4C_MAX_LINE_LENGTH];
+    int color_index = 9;
+
+    while (fgets(line, S4C_MAX_LINE_LENGTH, palette) != NULL) {
+        // Check if the line starts with "#", "GIMP Palette", "Name:" or "Columns:"
+        if (strncmp(line, "#", 1) == 0 || strncmp(line, "GIMP Palette", 12) == 0 ||
+            strncmp(line, "Name:", 5) == 0 || strncmp(line, "Columns:", 8) == 0) {
+            // Skip the comment or irrelevant line
+            continue;
+        }
+
+        // Parse the color values and name
+        int r, g, b;
+        char name[S4C_PALETTEFILE_MAX_COLOR_NAME_LEN];
+        if (sscanf(line, "%d %d %d %[^\n]", &r, &g, &b, name) != 4) {
+            fprintf(stderr, "[%s]  Error: could not parse palette line: %s\n", __func__, line);
+            continue;
+        }
+
+        int proportional_r = (((float)r + 1.0) / 256)*1000;
+        int proportional_g = (((float)g + 1.0) / 256)*1000;
+        int proportional_b = (((float)b + 1.0) / 256)*1000;
+        init_color(color_index, proportional_r, proportional_g, proportional_b);
+        init_pair(color_index, color_index, 0);
+        if (color_index > s4c_highest_color_pair) {
+            s4c_highest_color_pair = color_index;
+        }
+
+        color_index++;
+    }
+
+    //We close the palette file ourselves
+    fclose(palette);
+}
+
+/**
+ * Demoes all colors supported by the palette in the passed WINDOW. Not guaranteed to work.
+ * Since it uses indexes defined by default from animate.h, it should work only when your currently initialised palette has color pairs for the expected index range.
+ * @param win The window to print the demo to.
+ */
+void test_s4c_color_pairs(WINDOW* win)
+{
+    for (int i = S4C_MIN_COLOR_INDEX; i < S4C_MAX_COLOR_INDEX +1; i++) {
+        int color_index = i;
+        if (color_index >= 0 && color_index < S4C_MAX_COLORS) {
+            wattron(win, COLOR_PAIR(color_index));
+            mvwaddch(win, 2, 2+i-S4C_MIN_COLOR_INDEX, ' ' | A_REVERSE);
+            wattroff(win, COLOR_PAIR(color_index));
+        }
+    }
+
+    wrefresh(win);
+    refresh();
+}
+
+int s4c_check_has_colors(void)
+{
+    if (has_colors() == FALSE) {
+        return  S4C_ERR_TERMCOLOR;
+    }
+    return 0;
+}
+
+int s4c_check_can_change_color(void)
+{
+    if (can_change_color() == FALSE) {
+        return S4C_ERR_TERMCHANGECOLOR;
+    }
+    return 0;
+}
+
+/**
+ * Checks terminal color capabilities.
+ * @return 0 if successful, a negative value otherwise.
+ */
+int s4c_check_term(void)
+{
+
+    bool curses_was_ready = (stdscr != NULL) ? true : false;
+
+    if (!curses_was_ready) { //We temporarily try to start curses ourselves.
+        setlocale(LC_ALL, "");
+        initscr();
+        clear();
+        refresh();
+        start_color();
+    }
+
+    int checks[2] = {0};
+
+    checks[0] = s4c_check_has_colors();
+    checks[1] = s4c_check_can_change_color();
+    if (checks[0] != 0) {
+        if (!curses_was_ready) {
+            endwin();
+        }
+        return checks[0];
+    }
+    if (checks[1] != 0) {
+        if (!curses_was_ready) {
+            endwin();
+        }
+        return checks[1];
+    }
+    if (!curses_was_ready) {
+        endwin();
+    }
+    return 0;
+}
+
+/**
+ * Checks window size using s4c_animate() logic check.
+ * @param win The window to check.
+ * @param rows Height of animation.
+ * @param cols Width of animation.
+ * @param startX The X coord we want to draw at.
+ * @param startY The Y coord we want to draw at.
+ * @return 0 if successful, a negative value otherwise.
+ */
+int s4c_check_win(WINDOW* win, int rows, int cols, int startX, int startY)
+{
+    // Check if window is big enough
+    int win_rows, win_cols;
+    getmaxyx(win, win_rows, win_cols);
+
+    if (win_rows < s4c_render_rows(rows) + startY || win_cols < cols + startX) {
+        return S4C_ERR_SMALL_WIN;
+    }
+    return 0;
+}
+
+/**
+ * Sets the clip rectangle applied to all the functions drawing sprites to a WINDOW.
+ * Cells outside of it are not drawn. Coordinates are relative to the window being drawn to.
+ * Not thread-safe: it should be set before starting any animation.
+ * @param clip The S4C_Rect to clip to. If NULL, only the window bounds are used.
+ * @see s4c_visible_rect()
+ */
+void s4c_set_clip_rect(const S4C_Rect* clip)
+{
+    if (clip == NULL) {
+        s4c_has_clip_rect = false;
+        return;
+    }
+    s4c_clip_rect = *clip;
+    s4c_has_clip_rect = true;
+}
+
+/**
+ * Gets the clip rectangle set by s4c_set_clip_rect().
+ * @param clip Pointer to the S4C_Rect to set. Can be NULL.
+ * @return True if a clip rectangle is set, false otherwise.
+ */
+bool s4c_get_clip_rect(S4C_Rect* clip)
+{
+    if (s4c_has_clip_rect && clip != NULL) {
+        *clip = s4c_clip_rect;
+    }
+    return s4c_has_clip_rect;
+}
+
+static bool s4c_visible_rect_in(WINDOW* win, int rows, int cols, int startX, int startY, const S4C_Rect* bounds, S4C_Rect* visible);
+
+/**
+ * Clips a span starting at start, long len, to the range [lo, hi).
+ * @return How many cells of the span are left, or 0 if none.
+ */
+static inline int s4c_clip_span(int start, int len, int lo, int hi, int* first)
+{
+    int from = (start < lo ? lo : start);
+    int to = (start + len > hi ? hi : start + len);
+    *first = from - start;
+    return (to > from ? to - from : 0);
+}
+
+/**
+ * Computes which part of a frame is visible when drawn at the passed coordinates, using current render mode.
+ * The frame is intersected with the window and with the clip rectangle, if one is set.
+ * Visible rectangle is given in frame coordinates: x is the first visible column, y is the first visible terminal row
+ * (which is a pair of sprite rows with S4C_RENDER_HALFBLOCK).
+ * @param win The window to draw to.
+ * @param rows Height of the frame.
+ * @param cols Width of the frame.
+ * @param startX The X coord we want to draw at.
+ * @param startY The Y coord we want to draw at. Can be negative, as startX.
+ * @param visible Pointer to the S4C_Rect to set.
+ * @see s4c_set_clip_rect()
+ * @return True if any cell is visible, false otherwise.
+ */
+bool s4c_visible_rect(WINDOW* win, int rows, int cols, int startX, int startY, S4C_Rect* visible)
+{
+    return s4c_visible_rect_in(win, rows, cols, startX, startY, NULL, visible);
+}
+
+/**
+ * Intersects the passed bounds with a rectangle.
+ * @param min_x Pointer to the lowest X coord, updated in place.
+ * @param min_y Pointer to the lowest Y coord, updated in place.
+ * @param max_x Pointer to the X coord past the last column, updated in place.
+ * @param max_y Pointer to the Y coord past the last row, updated in place.
+ * @param rect The S4C_Rect to intersect with.
+ */
+static inline void s4c_intersect_bounds(int* min_x, int* min_y, int* max_x, int* max_y, const S4C_Rect* rect)
+{
+    *min_x = (rect->x > *min_x ? rect->x : *min_x);
+    *min_y = (rect->y > *min_y ? rect->y : *min_y);
+    *max_x = (rect->x + rect->width < *max_x ? rect->x + rect->width : *max_x);
+    *max_y = (rect->y + rect->height < *max_y ? rect->y + rect->height : *max_y);
+}
+
+/**
+ * Computes which part of a frame is visible when drawn at the passed coordinates, as s4c_visible_rect().
+ * The frame is also intersected with the passed bounds, if not NULL.
+ * @see s4c_visible_rect()
+ * @return True if any cell is visible, false otherwise.
+ */
+static bool s4c_visible_rect_in(WINDOW* win, int rows, int cols, int startX, int startY, const S4C_Rect* bounds, S4C_Rect* visible)
+{
+    int win_rows, win_cols;
+    getmaxyx(win, win_rows, win_cols);
+    int min_x = 0, min_y = 0;
+    int max_x = win_cols, max_y = win_rows;
+    if (s4c_has_clip_rect) {
+        s4c_intersect_bounds(&min_x, &min_y, &max_x, &max_y, &s4c_clip_rect);
+    }
+    if (bounds != NULL) {
+        s4c_intersect_bounds(&min_x, &min_y, &max_x, &max_y, bounds);
+    }
+    visible->width = s4c_clip_span(startX + 1, cols, min_x, max_x, &visible->x);
+    visible->height = s4c_clip_span(startY + 1, s4c_render_rows(rows), min_y, max_y, &visible->y);
+    if (visible->width == 0 || visible->height == 0) {
+        visible->width = 0;
+        visible->height = 0;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Holds the stats for all paced loops.
+ * @see s4c_get_pacing_stats()
+ */
+static S4C_Pacing_Stats s4c_pacing_stats = {0};
+
+/**
+ * Protects s4c_pacing_stats, since paced loops can run on separate threads.
+ */
+static pthread_mutex_t s4c_pacing_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Records a wakeup delay in the stats for all paced loops.
+ * @param late How many nanoseconds the wakeup was late.
+ * @param missed True if the deadline had already passed by more than a frame.
+ */
+static void s4c_pacing_record(int64_t late, bool missed)
+{
+    double late_ms = late / 1e6;
+    pthread_mutex_lock(&s4c_pacing_stats_mutex);
+    s4c_pacing_stats.frames++;
+    if (missed) {
+        s4c_pacing_stats.missed++;
+    }
+    if (late > s4c_pacing_stats.max_late_ns) {
+        s4c_pacing_stats.max_late_ns = late;
+    }
+    s4c_pacing_stats.total_late_ns += late;
+    s4c_pacing_stats.total_late_sq += late_ms * late_ms;
+    pthread_mutex_unlock(&s4c_pacing_stats_mutex);
+}
+
+/**
+ * Returns current time on the monotonic clock, in nanoseconds.
+ * @return Current time in nanoseconds.
+ */
+uint64_t s4c_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+/**
+ * Sleeps until the passed absolute deadline on the monotonic clock.
+ * Uses clock_nanosleep() with TIMER_ABSTIME where available, otherwise a relative nanosleep() to the deadline.
+ * Interrupt-safe: when a signal handler interrupts the sleep, it resumes towards the same deadline.
+ * @param deadline_ns The deadline, in nanoseconds from s4c_now_ns().
+ * @return 0 if successful, an errno value otherwise.
+ */
+int s4c_sleep_until_ns(uint64_t deadline_ns)
+{
+#if defined(TIMER_ABSTIME) && !defined(__APPLE__) && !defined(_WIN32)
+    struct timespec ts = {
+        .tv_sec = (time_t) (deadline_ns / 1000000000ULL),
+        .tv_nsec = (long) (deadline_ns % 1000000000ULL),
+    };
+    int res;
+    while ((res = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)) == EINTR) {
+        continue;
+    }
+    return res;
+#else
+    uint64_t now;
+    while ((now = s4c_now_ns()) < deadline_ns) {
+        uint64_t left = deadline_ns - now;
+        struct timespec ts = {
+            .tv_sec = (time_t) (left / 1000000000ULL),
+            .tv_nsec = (long) (left % 1000000000ULL),
+        };
+        if (nanosleep(&ts, NULL) != 0 && errno != EINTR) {
+            return errno;
+        }
+    }
+    return 0;
+#endif
+}
+
+/**
+ * Starts a S4C_Pacer, setting its deadline to now.
+ * @param pacer The S4C_Pacer to start.
+ */
+void s4c_pacer_start(S4C_Pacer* pacer)
+{
+    pacer->deadline_ns = s4c_now_ns();
+}
+
+/**
+ * Advances the deadline of a S4C_Pacer by the passed frametime and sleeps until it.
+ * Since the deadline is absolute, time spent drawing since last wait is not added to the frametime.
+ * If the deadline was already missed by more than a frame, it is moved to now instead of bursting frames to catch up.
+ * Wakeup delays are recorded in the stats returned by s4c_get_pacing_stats().
+ * @param pacer The S4C_Pacer to wait on.
+ * @param frametime How many mseconds the frame lasts.
+ * @see s4c_sleep_until_ns()
+ */
+void s4c_pacer_wait(S4C_Pacer* pacer, int frametime)
+{
+    uint64_t period = (uint64_t) (frametime > 0 ? frametime : 0) * 1000000ULL;
+    pacer->deadline_ns += period;
+    uint64_t now = s4c_now_ns();
+    if (now > pacer->deadline_ns + period) {
+        // Lateness is measured against the missed deadline, before resyncing to now
+        s4c_pacing_record((int64_t) (now - pacer->deadline_ns), true);
+        pacer->deadline_ns = now;
+        return;
+    }
+    s4c_sleep_until_ns(pacer->deadline_ns);
+    now = s4c_now_ns();
+    int64_t late = (now > pacer->deadline_ns ? (int64_t) (now - pacer->deadline_ns) : 0);
+    s4c_pacing_record(late, false);
+}
+
+/**
+ * Advances the deadline of a S4C_Pacer past the frame just drawn, and sleeps until the next frame to draw is due.
+ * When output fell behind, frames whose display time already ended are skipped, so the animation keeps its length instead of stretching.
+ * The last frame of the range is never skipped. Skipped frames are counted in the stats returned by s4c_get_pacing_stats().
+ * @param pacer The S4C_Pacer to wait on.
+ * @param durations Display duration of each frame in mseconds, 0 for frames using frametime. Can be NULL.
+ * @param frame_index Index of the frame just drawn.
+ * @param last_frame Index of the last frame of the range.
+ * @param frametime How many mseconds a frame without its own duration lasts.
+ * @see s4c_pacer_wait()
+ * @return Index of the next frame to draw, last_frame + 1 when the range is done.
+ */
+int s4c_pacer_next_frame(S4C_Pacer* pacer, const int durations[], int frame_index, int last_frame, int frametime)
+{
+    frametime = (frametime > 0 ? frametime : 0);
+    pacer->deadline_ns += (uint64_t) s4c_frame_duration(durations, frame_index, frametime) * 1000000ULL;
+    int next = frame_index + 1;
+    uint64_t now = s4c_now_ns();
+    int skipped = 0;
+    while (next < last_frame) {
+        uint64_t next_ns = (uint64_t) s4c_frame_duration(durations, next, frametime) * 1000000ULL;
+        // Frames with no duration, as when benchmarking, are never skipped
+        if (next_ns == 0 || now < pacer->deadline_ns + next_ns) {
+            break;
+        }
+        pacer->deadline_ns += next_ns;
+        next++;
+        skipped++;
+    }
+    if (skipped > 0) {
+        pthread_mutex_lock(&s4c_pacing_stats_mutex);
+        s4c_pacing_stats.skipped += skipped;
+        pthread_mutex_unlock(&s4c_pacing_stats_mutex);
+    }
+    uint64_t period = (uint64_t) s4c_frame_duration(durations, (next <= last_frame ? next : frame_index), frametime) * 1000000ULL;
+    if (now > pacer->deadline_ns + period) {
+        // Only the last frame is left to skip to, resync as in s4c_pacer_wait()
+        s4c_pacing_record((int64_t) (now - pacer->deadline_ns), true);
+        pacer->deadline_ns = now;
+        return next;
+    }
+    s4c_sleep_until_ns(pacer->deadline_ns);
+    now = s4c_now_ns();
+    s4c_pacing_record((now > pacer->deadline_ns ? (int64_t) (now - pacer->deadline_ns) : 0), false);
+    return next;
+}
+
+/**
+ * Copies the stats for all paced loops.
+ * @param stats Pointer to the S4C_Pacing_Stats to set.
+ * @see s4c_pacing_jitter_ms()
+ */
+void s4c_get_pacing_stats(S4C_Pacing_Stats* stats)
+{
+    pthread_mutex_lock(&s4c_pacing_stats_mutex);
+    *stats = s4c_pacing_stats;
+    pthread_mutex_unlock(&s4c_pacing_stats_mutex);
+}
+
+/**
+ * Resets the stats for all paced loops.
+ */
+void s4c_reset_pacing_stats(void)
+{
+    pthread_mutex_lock(&s4c_pacing_stats_mutex);
+    s4c_pacing_stats = (S4C_Pacing_Stats) {
+        0
+    };
+    pthread_mutex_unlock(&s4c_pacing_stats_mutex);
+}
+
+/**
+ * Returns the jitter of paced loops, as the root mean square of wakeup delays.
+ * @param stats The S4C_Pacing_Stats to use.
+ * @return The jitter in milliseconds, or 0 if no frame was waited for.
+ */
+double s4c_pacing_jitter_ms(const S4C_Pacing_Stats* stats)
+{
+    if (stats->frames == 0) {
+        return 0;
+    }
+    return sqrt(stats->total_late_sq / stats->frames);
+}
+
+/**
+ * Demoes color pairs defined in s4c to the passed window.
+ * Since it uses indexes defined by default from animate.h, it should work only when your currently initialised palette has color pairs for the expected index range.
+ * @param win The Window pointer to print to.
+ * @param colors_per_row How many colors to print in each row.
+ */
+void slideshow_s4c_color_pairs(WINDOW* win)
+{
+    if (win == NULL) {
+        fprintf(stderr,"[%s]:  Passed Window was NULL.",__func__);
+        abort();
+    }
+    int cursorCheck = curs_set(0); // We try making the cursor invisible
+
+    if (cursorCheck == ERR) {
+        //TODO
+        //Log this
+        //fprintf(stderr,"animate => Terminal does not support cursor visibility state.\n");
+    }
+
+    // Get window max size
+    int win_rows, win_cols;
+    getmaxyx(win, win_rows, win_cols);
+
+    int picked = 0;
+    int quit = 0;
+    int c = -1;
+    wrefresh(win);
+    refresh();
+
+    int color_index = S4C_MIN_COLOR_INDEX;
+
+    do {
+        if (color_index >= 0) {
+            wattron(win,COLOR_PAIR(color_index));
+            for (int i=0; i<win_rows; i++) {
+                for (int j=0; j<win_cols; j++) {
+                    mvwaddch(win, i, j, ' ' | A_REVERSE);
+                }
+            }
+            wattroff(win,COLOR_PAIR(color_index));
+            if (win_cols > S4C_MAX_COLOR_NAME_LEN+9) {
+                mvwprintw(win, 2, 1, "[%i] [%s]", color_index, s4c_color_name(color_index));
+            } else if (win_cols > 5) {
+                mvwprintw(win, 1, 1, "[%i]", color_index);
+            }
+            box(win,0,0);
+            wrefresh(win);
+            refresh();
+        }
+        c = wgetch(win);
+        switch(c) {
+        case 'q': { /*Enter*/
+            quit = 1;
+
+        };
+        case 10: { /*Enter*/
+            picked = 1;
+        };
+        break;
+        case KEY_RIGHT: {
+            color_index = (color_index == S4C_MAX_COLOR_INDEX ? color_index : color_index+1);
+
+        };
+        break;
+        case KEY_LEFT: {
+            color_index = (color_index == S4C_MIN_COLOR_INDEX ? color_index : color_index-1);
+
+        };
+        break;
+        default: {
+            //fprintf(stderr,"[%s]:  Unexpected int [%i].\n",__func__,c);
+        }
+        break;
+        }
+    } while(!quit && !picked);
+}
+
+/**
+ * Prints a line of pixels, read with the passed step, in the passed WINDOW at the y value passed as curr_line_num.
+ * Used by s4c_print_spriteline() with a step of 1, and by S4C_Frame_View renderers with their column stride.
+ * @param win The window to print into.
+ * @param line Pointer to the first pixel to print.
+ * @param step Offset between consecutive pixels.
+ * @param lut Lookup table mapping pixels to color pairs.
+ * @param curr_line_num The y value to print at in win
+ * @param line_length How many pixels to print
+ * @param startX X coord of the win to start printing to.
+ */
+static void s4c_print_strided_line(WINDOW* win, const unsigned char* line, ptrdiff_t step, const short* lut, int curr_line_num, int line_length, int startX)
+{
+    for (int i = 0; i < line_length; i++) {
+        int color_index = lut[line[i * step]];
+        if (color_index >= 0) {
+            wattron(win, COLOR_PAIR(color_index));
+            mvwaddch(win, curr_line_num, startX + 1 + i, ' ' | A_REVERSE);
+            wattroff(win, COLOR_PAIR(color_index));
+        }
+
+    }
+}
+
+/**
+ * Picks the glyph and colors of a S4C_RENDER_HALFBLOCK cell from the colors of its two pixels.
+ * With both pixels drawn, U+2580 shows the upper color over the lower one. With only one, the half block on its side
+ * is drawn over the default background, so the transparent half is left alone.
+ * Shared by the ncurses, ANSI and headless renderers.
+ * @param upper Color of the upper pixel, negative if transparent.
+ * @param lower Color of the lower pixel, negative if transparent or missing.
+ * @param fg Set to the foreground color.
+ * @param bg Set to the background color, -1 for the default background.
+ * @return 0x2580 or 0x2584 for the glyph to draw, 0 if both pixels are transparent and the cell is not drawn.
+ */
+static inline int s4c_halfblock_cell(int upper, int lower, int* fg, int* bg)
+{
+    if (upper < 0) {
+        if (lower < 0) {
+            return 0;
+        }
+        *fg = lower;
+        *bg = -1;
+        return 0x2584;
+    }
+    *fg = upper;
+    *bg = (lower < 0 ? -1 : lower);
+    return 0x2580;
+}
+
+/**
+ * Returns the UTF-8 encoding of a glyph returned by s4c_halfblock_cell().
+ */
+static inline const char* s4c_halfblock_glyph(int glyph)
+{
+    return (glyph == 0x2584 ? S4C_LOWER_HALFBLOCK_GLYPH : S4C_HALFBLOCK_GLYPH);
+}
+
+/**
+ * Prints two lines of pixels, read with the passed step, in the passed WINDOW as a single half-block line.
+ * Used by s4c_print_spriteline_halfblock() with a step of 1, and by S4C_Frame_View renderers with their column stride.
+ * @param win The window to print into.
+ * @param upper_line Pointer to the first pixel of the upper row.
+ * @param lower_line Pointer to the first pixel of the lower row. If NULL, background color index 0 is used.
+ * @param step Offset between consecutive pixels.
+ * @param lut Lookup table mapping pixels to color pairs.
+ * @param curr_line_num The y value to print at in win
+ * @param line_length How many pixels to print
+ * @param startX X coord of the win to start printing to.
+ * @see s4c_print_spriteline_halfblock()
+ */
+static void s4c_print_strided_line_halfblock(WINDOW* win, const unsigned char* upper_line, const unsigned char* lower_line, ptrdiff_t step, const short* lut, int curr_line_num, int line_length, int startX)
+{
+    for (int i = 0; i < line_length; i++) {
+        int fg_index, bg_index;
+        int glyph = s4c_halfblock_cell(lut[upper_line[i * step]], (lower_line != NULL ? lut[lower_line[i * step]] : -1), &fg_index, &bg_index);
+        if (glyph == 0) {
+            continue;
+        }
+        int pair = s4c_color_pair(fg_index, bg_index);
+        if (pair < 0 && bg_index < 0) {
+            // No default background without use_default_colors()
+            pair = s4c_color_pair(fg_index, 0);
+        }
+        if (pair < 0) {
+            wattron(win, COLOR_PAIR(fg_index));
+            mvwaddch(win, curr_line_num, startX + 1 + i, ' ' | A_REVERSE);
+            wattroff(win, COLOR_PAIR(fg_index));
+            continue;
+        }
+        wattron(win, COLOR_PAIR(pair));
+        mvwaddstr(win, curr_line_num, startX + 1 + i, s4c_halfblock_glyph(glyph));
+        wattroff(win, COLOR_PAIR(pair));
+    }
+}
+
+/**
+ * Takes a string and a int and prints it in curses sdtscr at the y value passed as line_num.
+ * @param line The string to print
+ * @param line_num The y value to print at in win
+ * @param line_len The length of line to print
+ * @param startX X coord of the win to start printing to.
+ */
+void s4c_print_spriteline(WINDOW* win, char* line, int curr_line_num, int line_length, int startX)
+{
+    s4c_print_strided_line(win, (const unsigned char*) line, 1, s4c_char_pair_lut, curr_line_num, line_length, startX);
+}
+
+/**
+ * Takes two strings and prints them in the passed WINDOW as a single line, at the y value passed as line_num.
+ * Each cell is drawn as U+2580, using the upper pixel as foreground and the lower one as background.
+ * If only one pixel is transparent, the other is drawn as a half block over the default background, see s4c_halfblock_cell().
+ * Color pairs for each (fg,bg) combination are requested from s4c_color_pair(). Without use_default_colors(), color index 0
+ * is used for the default background.
+ * If no color pair is left, the foreground pixel is drawn as in s4c_print_spriteline().
+ * @param upper_line The string for the upper pixel row.
+ * @param lower_line The string for the lower pixel row. If NULL, the lower pixels are transparent.
+ * @param curr_line_num The y value to print at in win
+ * @param line_length The length of lines to print
+ * @param startX X coord of the win to start printing to.
+ * @see s4c_color_pair()
+ */
+void s4c_print_spriteline_halfblock(WINDOW* win, char* upper_line, char* lower_line, int curr_line_num, int line_length, int startX)
+{
+    s4c_print_strided_line_halfblock(win, (const unsigned char*) upper_line, (const unsigned char*) lower_line, 1, s4c_char_pair_lut, curr_line_num, line_length, startX);
+}
+
+/**
+ * Takes a S4C_Frame_View and prints it in the passed WINDOW, using current render mode and the passed color pair lookup table.
+ * Only the cells inside the window and the clip rectangle are printed.
+ * Transforms are only seen as strides: there is no per-cell branching on them.
+ * @param win The window to print into.
+ * @param view The S4C_Frame_View to print.
+ * @param lut Lookup table mapping the view pixels to color pairs.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @param bounds Optional S4C_Rect, in window coordinates, to further clip to. Can be NULL.
+ * @see s4c_visible_rect()
+ * @return True if any cell was visible, false otherwise.
+ */
+static bool s4c_print_view_lut(WINDOW* win, const S4C_Frame_View* view, const short* lut, int startX, int startY, const S4C_Rect* bounds)
+{
+    S4C_Rect v;
+    if (!s4c_visible_rect_in(win, view->rows, view->cols, startX, startY, bounds, &v)) {
+        return false;
+    }
+    const unsigned char* first_col = view->origin + v.x * view->col_stride;
+    if (s4c_render_mode == S4C_RENDER_HALFBLOCK) {
+        for (int j=v.y; j<v.y+v.height; j++) {
+            const unsigned char* upper = first_col + (2*j) * view->row_stride;
+            const unsigned char* lower = (2*j+1 < view->rows ? upper + view->row_stride : NULL);
+            s4c_print_strided_line_halfblock(win, upper, lower, view->col_stride, lut, j+startY+1, v.width, startX+v.x);
+        }
+        return true;
+    }
+    for (int j=v.y; j<v.y+v.height; j++) {
+        s4c_print_strided_line(win, first_col + j * view->row_stride, view->col_stride, lut, j+startY+1, v.width, startX+v.x);
+    }
+    return true;
+}
+
+/**
+ * Takes a S4C_Frame_View and prints it in the passed WINDOW, using current render mode and the lookup table for its encoding.
+ * @param win The window to print into.
+ * @param view The S4C_Frame_View to print.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @param bounds Optional S4C_Rect, in window coordinates, to further clip to. Can be NULL.
+ * @see s4c_print_view_lut()
+ * @return True if any cell was visible, false otherwise.
+ */
+static bool s4c_print_view(WINDOW* win, const S4C_Frame_View* view, int startX, int startY, const S4C_Rect* bounds)
+{
+    return s4c_print_view_lut(win, view, s4c_pair_lut(view->encoding), startX, startY, bounds);
+}
+
+/**
+ * Takes a frame and prints its rows in the passed WINDOW, using current render mode.
+ * Only the cells inside the window and the clip rectangle are printed.
+ * @param win The window to print into.
+ * @param frame The frame to print.
+ * @param rows Height of the frame.
+ * @param cols Width of the frame.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @see s4c_set_render_mode()
+ * @see s4c_visible_rect()
+ */
+static void s4c_print_frame(WINDOW* win, char frame[][S4C_MAXCOLS], int rows, int cols, int startX, int startY)
+{
+    S4C_Frame_View view = s4c_frame_view(frame, rows, cols, S4C_TRANSFORM_NONE);
+    s4c_print_view(win, &view, startX, startY, NULL);
+}
+
+/**
+ * Compares a row of two S4C_Frame_View of the same size and finds the changed span, in view columns.
+ * Rows read left to right or right to left in memory, as with S4C_TRANSFORM_NONE, FLIP_H, FLIP_V and ROT180,
+ * are compared with s4c_diff_row(). Rotated rows are compared pixel by pixel.
+ * @param a The first view.
+ * @param b The second view.
+ * @param row The view row to compare.
+ * @param from Pointer to set to the first changed column.
+ * @param to Pointer to set to the column past the last changed one.
+ * @see s4c_diff_row()
+ * @return 1 if the rows differ, 0 otherwise.
+ */
+static int s4c_view_diff_row(const S4C_Frame_View* a, const S4C_Frame_View* b, int row, int* from, int* to)
+{
+    const unsigned char* row_a = a->origin + row * a->row_stride;
+    const unsigned char* row_b = b->origin + row * b->row_stride;
+    if (a->col_stride == 1 && b->col_stride == 1) {
+        return s4c_diff_row((const char*) row_a, (const char*) row_b, a->cols, from, to);
+    }
+    if (a->col_stride == -1 && b->col_stride == -1) {
+        // Compare the row as laid out in memory, then mirror the span
+        int mem_from, mem_to;
+        if (!s4c_diff_row((const char*) (row_a - (a->cols - 1)), (const char*) (row_b - (b->cols - 1)), a->cols, &mem_from, &mem_to)) {
+            return 0;
+        }
+        *from = a->cols - mem_to;
+        *to = a->cols - mem_from;
+        return 1;
+    }
+    int first = -1;
+    int last = -1;
+    for (int i = 0; i < a->cols; i++) {
+        if (row_a[i * a->col_stride] != row_b[i * b->col_stride]) {
+            if (first < 0) {
+                first = i;
+            }
+            last = i;
+        }
+    }
+    if (first < 0) {
+        return 0;
+    }
+    *from = first;
+    *to = last + 1;
+    return 1;
+}
+
+/**
+ * Takes a S4C_Frame_View and the view currently shown in the passed WINDOW, and prints only the changed spans of each row,
+ * using current render mode and the passed color pair lookup table. If prev is NULL, the whole view is printed.
+ * With S4C_RENDER_HALFBLOCK, the spans of the two rows sharing a terminal row are merged.
+ * @param win The window to print into.
+ * @param prev The view currently shown in win, of the same size as view. Can be NULL.
+ * @param view The S4C_Frame_View to print.
+ * @param lut Lookup table mapping the view pixels to color pairs.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @see s4c_view_diff_row()
+ * @see s4c_print_view_lut()
+ */
+static void s4c_print_view_delta(WINDOW* win, const S4C_Frame_View* prev, const S4C_Frame_View* view, const short* lut, int startX, int startY)
+{
+    if (prev == NULL) {
+        s4c_print_view_lut(win, view, lut, startX, startY, NULL);
+        return;
+    }
+    int step = (s4c_render_mode == S4C_RENDER_HALFBLOCK ? 2 : 1);
+    for (int j = 0; j < view->rows; j += step) {
+        int from = 0, to = 0;
+        int changed = s4c_view_diff_row(prev, view, j, &from, &to);
+        int lower_from, lower_to;
+        if (step == 2 && j+1 < view->rows && s4c_view_diff_row(prev, view, j+1, &lower_from, &lower_to)) {
+            // Both rows of a pair are printed in the same terminal row
+            from = ((!changed || lower_from < from) ? lower_from : from);
+            to = ((!changed || lower_to > to) ? lower_to : to);
+            changed = 1;
+        }
+        if (!changed) {
+            continue;
+        }
+        S4C_Rect bounds = {startX + 1 + from, startY + 1 + j / step, to - from, 1};
+        s4c_print_view_lut(win, view, lut, startX, startY, &bounds);
+    }
+}
+
+/**
+ * Takes a frame and the frame currently shown in the passed WINDOW, and prints only the changed spans, using current render mode.
+ * If prev is NULL, the whole frame is printed.
+ * @param win The window to print into.
+ * @param prev The frame currently shown in win. Can be NULL.
+ * @param frame The frame to print.
+ * @param rows Height of the frames.
+ * @param cols Width of the frames.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @see s4c_print_view_delta()
+ */
+static void s4c_print_frame_delta(WINDOW* win, char prev[][S4C_MAXCOLS], char frame[][S4C_MAXCOLS], int rows, int cols, int startX, int startY)
+{
+    S4C_Frame_View view = s4c_frame_view(frame, rows, cols, S4C_TRANSFORM_NONE);
+    if (prev == NULL) {
+        s4c_print_view(win, &view, startX, startY, NULL);
+        return;
+    }
+    S4C_Frame_View prev_view = s4c_frame_view(prev, rows, cols, S4C_TRANSFORM_NONE);
+    s4c_print_view_delta(win, &prev_view, &view, s4c_pair_lut(view.encoding), startX, startY);
+}
+
+/**
+ * Checks if the contents of the passed WINDOW are erased by the clear() calls in the animation loops.
+ * @param win The window to check.
+ * @return True if win is stdscr or a subwindow.
+ */
+static bool s4c_is_cleared_by_loop(WINDOW* win)
+{
+    return (win == stdscr || wgetparent(win) != NULL);
+}
+
+/**
+ * Calls s4c_animate_sprites_at_coords() with 0,0 as starting coordinates.
+ * Every frame is displayed for frametime: per-frame durations are ignored, use s4c_animate_rangeof_sprites_timed_at_coords() for them.
+ * @see s4c_pacer_next_frame()
+ * @see s4c_animate_sprites_at_coords()
+ * @param sprites The sprites array.
+ * @param w The window to print into.
+ * @param repetition The number of times the animation will be cycled through.
+ * @param frametime How many mseconds each frame is displayed.
+ * @param num_frames How many frames the animation will have.
+ * @param frameheight Height of the frame.
+ * @param framewidth Width of the frame.
+ * @see S4C_ERR_CURSOR
+ * @see S4C_ERR_SMALL_WIN
+ * @return 1 if successful, a negative value for errors.
+ */
+int s4c_animate_sprites(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int repetitions, int frametime, int num_frames, int frameheight, int framewidth)
+{
+    return s4c_animate_sprites_at_coords(sprites, w,repetitions, frametime, num_frames, frameheight, framewidth, 0, 0);
+}
+
+/**
+ * Takes a WINDOW pointer to print into and a string for the file passed.
+ * Takes a pre-initialised array of sprites, valid format output by sprites.py or sheet_converter.py.
+ * Color-character map is define in s4c_print_spriteline().
+ * Sets all the frames to the passed array.
+ * Every frame is displayed for frametime: per-frame durations are ignored, use s4c_animate_rangeof_sprites_timed_at_coords() for them.
+ * @see s4c_pacer_next_frame()
+ * @see s4c_print_spriteline()
+ * @param sprites The sprites array.
+ * @param w The window to print into.
+ * @param repetition The number of times the animation will be cycled through.
+ * @param frametime How many mseconds each frame is displayed.
+ * @param num_frames How many frames the animation will have.
+ * @param frameheight Height of the frame.
+ * @param framewidth Width of the frame.
+ * @param startY Y coord of the window to start printing to.
+ * @param startY X coord of the window to start printing to.
+ * @see s4c_animate_rangeof_sprites_timed_at_coords()
+ * @see S4C_ERR_CURSOR
+ * @see S4C_ERR_SMALL_WIN
+ * @return 1 if successful, a negative value for errors.
+ */
+int s4c_animate_sprites_at_coords(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY)
+{
+    int cursorCheck = curs_set(0); // We make the cursor invisible or return early with the error
+
+    if (cursorCheck == ERR) {
+        return S4C_ERR_CURSOR; //fprintf(stderr,"animate => Terminal does not support cursor visibility state.\n");
+    }
+
+    int rows = frameheight;
+    int cols = framewidth;
+
+    // Check if window is big enough
+    int win_rows, win_cols;
+    getmaxyx(w, win_rows, win_cols);
+    if (win_rows < s4c_render_rows(rows) + startY || win_cols < cols + startX) {
+        return S4C_ERR_SMALL_WIN; //fprintf(stderr, "animate => Window is too small to display the sprite.\n");
+    }
+
+
+    // Only changed spans are printed, unless clear() erases the window between frames
+    bool delta = !s4c_is_cleared_by_loop(w);
+    int prev = -1;
+    int current_rep = 0;
+    S4C_Pacer pacer;
+    s4c_pacer_start(&pacer);
+    // Run the animation loop
+    while ( current_rep < repetitions ) {
+        for (int i=0; i<num_frames+1; ) {
+            box(w,0,0);
+            // Print current frame
+            s4c_print_frame_delta(w, ((delta && prev >= 0) ? sprites[prev] : NULL), sprites[i], rows, cols, startX, startY);
+            prev = i;
+            wrefresh(w);
+            // Refresh the screen
+            i = s4c_pacer_next_frame(&pacer, NULL, i, num_frames, frametime);
+            clear();
+        };
+        // We finished a whole cycle
+        current_rep++;
+    }
+    // We make the cursor normal again
+    curs_set(1);
+
+    return 1;
+}
+
+/**
+ * Takes a void pointer, to be cast to animate_args*, containing parameters to animate a sprite in a WINDOW, using a separate thread.
+ * @see s4c_pacer_next_frame()
+ * @param args_ptr Pointer to be cast to animate_args*.
+ * @see animate_args
+ */
+void *s4c_animate_sprites_thread_at(void *args_ptr)
+{
+
+    animate_args* args = (animate_args *)args_ptr;
+    WINDOW* w = args->win;
+    int frametime = args->frametime;
+    int num_frames = args->num_frames;
+    int frameheight = args->frameheight;
+    int framewidth = args->framewidth;
+    int startX = args->startX;
+    int startY = args->startY;
+
+    int cursorCheck = curs_set(0); // We make the cursor invisible or return early with the error
+
+    if (cursorCheck == ERR) {
+        //return S4C_ERR_CURSOR; //fprintf(stderr,"animate => Terminal does not support cursor visibility state.\n");
+        return NULL; // FIXME: should maybe return a meaningful constant pointer denoting the specific error?
+    }
+
+    int rows = frameheight;
+    int cols = framewidth;
+
+    // Check if window is big enough
+    int win_rows, win_cols;
+    getmaxyx(w, win_rows, win_cols);
+    if (win_rows < s4c_render_rows(rows) + startY || win_cols < cols + startX) {
+        fprintf(stderr, "[%s]  animate => Window is too small to display the sprite.\n",__func__);
+        pthread_exit(NULL);
+    }
+    // Open the palette file and read the color values and names
+    FILE* palette_file;
+    palette_file = fopen("palette.gpl", "r");
+    if (palette_file == NULL) {
+        fprintf(stderr, "[%s]  Error: could not open palette file.\n",__func__);
+        pthread_exit(NULL);
+    }
+
+    // Initialize all the colors and close palette file
+    init_s4c_color_pairs(palette_file);
+
+    int prev = -1;
+    S4C_Pacer pacer;
+    s4c_pacer_start(&pacer);
+    // Run the animation thread loop
+    do {
+        for (int i=0; i<num_frames+1; ) {
+            box(w,0,0);
+            if (args->stop_thread == 1) {
+                break;
+            }
+            // Print current frame, only the spans changed from the previous one
+            s4c_print_frame_delta(w, (prev >= 0 ? (args->sprites)[prev] : NULL), (args->sprites)[i], rows, cols, startX, startY);
+            prev = i;
+            wrefresh(w);
+            // Refresh the screen
+            i = s4c_pacer_next_frame(&pacer, NULL, i, num_frames, frametime);
+        };
+    } while ( args->stop_thread != 1);
+
+    // We make the cursor normal again
+    curs_set(1);
+
+    pthread_exit(NULL);
+    //FIXME
+    //Is this a bug? Do we have to return NULL here?
+#ifdef _WIN32
+    return NULL;
+#endif
+}
+
+/**
+ * Takes a WINDOW pointer to print into.
+ * Contrary to other of these functions, this one does not touch cursor settings.
+ * Uses the passed sprites and displays a range of them in the passed window if it is big enough.
+ * Color-character map is define in s4c_print_spriteline().
+ * @see s4c_pacer_next_frame()
+ * @see s4c_print_spriteline()
+ * @param sprites The sprites array.
+ * @param w The window to print into.
+ * @param repetition The number of times the animation will be cycled through.
+ * @param frametime How many mseconds each frame is displayed.
+ * @param num_frames How many frames the animation will have.
+ * @param frameheight Height of the frame.
+ * @param framewidth Width of the frame.
+ * @param startY Y coord of the window to start printing to.
+ * @param startY X coord of the window to start printing to.
+ * @see s4c_animate_rangeof_sprites_timed_at_coords()
+ * @see S4C_ERR_SMALL_WIN
+ * @return 1 if successful, a negative value for errors.
+ */
+int s4c_animate_rangeof_sprites_at_coords(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY)
+{
+    return s4c_animate_rangeof_sprites_timed_at_coords(sprites, NULL, w, fromFrame, toFrame, repetitions, frametime, num_frames, frameheight, framewidth, startX, startY);
+}
+
+/**
+ * Takes a WINDOW pointer to print into, and displays a range of the passed sprites in it if it is big enough.
+ * Each frame is displayed for its own duration from durations, frames without one use frametime.
+ * @see s4c_pacer_next_frame()
+ * @param sprites The sprites array.
+ * @param durations Display duration of each frame in mseconds, 0 for frames using frametime. Can be NULL.
+ * @param w The window to print into.
+ * @param fromFrame First frame of the range.
+ * @param toFrame Last frame of the range, included.
+ * @param repetition The number of times the animation will be cycled through.
+ * @param frametime How many mseconds a frame without its own duration is displayed.
+ * @param num_frames How many frames the animation will have.
+ * @param frameheight Height of the frame.
+ * @param framewidth Width of the frame.
+ * @param startY Y coord of the window to start printing to.
+ * @param startY X coord of the window to start printing to.
+ * @see s4c_load_sprites_timed()
+ * @see S4C_ERR_RANGE
+ * @see S4C_ERR_CURSOR
+ * @see S4C_ERR_SMALL_WIN
+ * @return 1 if successful, a negative value for errors.
+ */
+int s4c_animate_rangeof_sprites_timed_at_coords(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], const int durations[], WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY)
+{
+    //Validate requested range
+    if (fromFrame < 0 || toFrame < 0 || fromFrame > toFrame || toFrame > num_frames ) {
+        return S4C_ERR_RANGE;
+    }
+
+    int cursorCheck = curs_set(0); // We make the cursor invisible or return early with the error
+
+    if (cursorCheck == ERR) {
+        return S4C_ERR_CURSOR; //fprintf(stderr,"animate => Terminal does not support cursor visibility state.\n");
+    }
+
+    int rows = frameheight;
+    int cols = framewidth;
+
+    // Check if window is big enough
+    int win_rows, win_cols;
+    getmaxyx(w, win_rows, win_cols);
+    if (win_rows < s4c_render_rows(rows) + startY || win_cols < cols + startX) {
+        return S4C_ERR_SMALL_WIN; //fprintf(stderr, "animate => Window is too small to display the sprite.\n");
+    }
+
+
+    // Only changed spans are printed, unless clear() erases the window between frames
+    bool delta = !s4c_is_cleared_by_loop(w);
+    int prev = -1;
+    int current_rep = 0;
+    S4C_Pacer pacer;
+    s4c_pacer_start(&pacer);
+    // Run the animation loop
+    while ( current_rep < repetitions ) {
+        //+1 to include toFrame index
+        for (int i=fromFrame; i<toFrame+1 ; ) {
+            box(w,0,0);
+            // Print current frame
+            s4c_print_frame_delta(w, ((delta && prev >= 0) ? sprites[prev] : NULL), sprites[i], rows, cols, startX, startY);
+            prev = i;
+            wrefresh(w);
+            // Refresh the screen, skipping frames that should have already ended
+            i = s4c_pacer_next_frame(&pacer, durations, i, toFrame, frametime);
+            clear();
+        };
+        // We finished a whole cycle
+        current_rep++;
+    }
+
+    // We make the cursor normal again
+    curs_set(1);
+    return 1;
+}
+
+/**
+ * Takes a WINDOW pointer to print into and an animation array, plus the index of requested frame to print.
+ * Contrary to other of these functions, this one does not touch cursor settings.
+ * It checks if the passed WINDOW is big enough for the requested frame.
+ * Color-character map is define in s4c_print_spriteline().
+ * @see s4c_print_spriteline()
+ * @param sprites The sprites array.
+ * @param sprite_index The index of requested sprite.
+ * @param w The window to print into.
+ * @param num_frames How many frames the animation will have.
+ * @param frameheight Height of the frame.
+ * @param framewidth Width of the frame.
+ * @param startY Y coord of the window to start printing to.
+ * @param startY X coord of the window to start printing to.
+ * @see S4C_ERR_SMALL_WIN
+ * @return 1 if successful, a negative value for errors.
+ */
+int s4c_display_sprite_at_coords_checked(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int sprite_index, WINDOW* w, int num_frames, int frameheight, int framewidth, int startX, int startY)
+{
+    //Validate requested range
+    if (sprite_index < 0 || sprite_index > num_frames ) {
+        return S4C_ERR_RANGE;
+    }
+
+    int rows = frameheight;
+    int cols = framewidth;
+
     // Check if window is big enough
     int win_rows, win_cols;
-    getmaxyx(win, win_rows, win_cols);
+    getmaxyx(w, win_rows, win_cols);
+    if (win_rows < s4c_render_rows(rows) + startY || win_cols < cols + startX) {
+        return S4C_ERR_SMALL_WIN; //fprintf(stderr, "animate => Window is too small to display the sprite.\n");
+    }
+    // Print current frame
+    s4c_print_frame(w, sprites[sprite_index], rows, cols, startX, startY);
+    box(w,0,0);
+    wrefresh(w);
+    return 1;
+}
+
+/**
+ * Takes a WINDOW pointer to print into and an animation array, plus the index of requested frame to print.
+ * Contrary to other of these functions, this one does not touch cursor settings.
+ * It does not check if the passed WINDOW is big enough for the requested frame.
+ * Color-character map is define in s4c_print_spriteline().
+ * @see s4c_print_spriteline()
+ * @param sprites The sprites array.
+ * @param sprite_index The index of requested sprite.
+ * @param w The window to print into.
+ * @param num_frames How many frames the animation will have.
+ * @param frameheight Height of the frame.
+ * @param framewidth Width of the frame.
+ * @param startY Y coord of the window to start printing to.
+ * @param startY X coord of the window to start printing to.
+ * @return 1 if successful, a negative value for errors.
+ */
+int s4c_display_sprite_at_coords_unchecked(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int sprite_index, WINDOW* w, int num_frames, int frameheight, int framewidth, int startX, int startY)
+{
+    //Validate requested range
+    if (sprite_index < 0 || sprite_index > num_frames ) {
+        return S4C_ERR_RANGE;
+    }
+
+    // Print current frame
+    s4c_print_frame(w, sprites[sprite_index], frameheight, framewidth, startX, startY);
+    box(w,0,0);
+    wrefresh(w);
+    return 1;
+}
+
+/**
+ * Takes a WINDOW pointer to print into and an animation array, plus the index of requested frame to print.
+ * Contrary to other of these functions, this one does not touch cursor settings.
+ * Depending on if S4C_UNCHECKED is defined, it may or may not check if the passed WINDOW is big enough
+ * for the requested frame.
+ * Color-character map is define in s4c_print_spriteline().
+ * @see s4c_print_spriteline()
+ * @param sprites The sprites array.
+ * @param sprite_index The index of requested sprite.
+ * @param w The window to print into.
+ * @param num_frames How many frames the animation will have.
+ * @param frameheight Height of the frame.
+ * @param framewidth Width of the frame.
+ * @param startY Y coord of the window to start printing to.
+ * @param startY X coord of the window to start printing to.
+ * @return 1 if successful, a negative value for errors.
+ */
+int s4c_display_sprite_at_coords(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int sprite_index, WINDOW* w, int num_frames, int frameheight, int framewidth, int startX, int startY)
+{
+#ifdef S4C_UNCHECKED
+    return s4c_display_sprite_at_coords_unchecked(sprites, sprite_index, w, num_frames, frameheight, framewidth, startX, startY);
+#else
+    return s4c_display_sprite_at_coords_checked(sprites, sprite_index, w, num_frames, frameheight, framewidth, startX, startY);
+#endif // S4C_UNCHECKED
+}
+
+/**
+ * Takes a WINDOW pointer to print into and an animation array, plus the index of requested frame to print.
+ * Contrary to other of these functions, this one does not touch cursor settings.
+ * Instead of rejecting frames not fitting the passed WINDOW, it only prints the cells inside the window and the clip rectangle.
+ * Coordinates can be negative, to draw a frame partially out of the top or left border.
+ * @see s4c_set_clip_rect()
+ * @see s4c_visible_rect()
+ * @param sprites The sprites array.
+ * @param sprite_index The index of requested sprite.
+ * @param w The window to print into.
+ * @param num_frames How many frames the animation will have.
+ * @param frameheight Height of the frame.
+ * @param framewidth Width of the frame.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @see S4C_ERR_RANGE
+ * @return 1 if any cell was printed, 0 if the frame was not visible, a negative value for errors.
+ */
+int s4c_display_sprite_at_coords_clipped(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int sprite_index, WINDOW* w, int num_frames, int frameheight, int framewidth, int startX, int startY)
+{
+    //Validate requested range
+    if (sprite_index < 0 || sprite_index > num_frames ) {
+        return S4C_ERR_RANGE;
+    }
+    S4C_Rect v;
+    bool is_visible = s4c_visible_rect(w, frameheight, framewidth, startX, startY, &v);
+    if (is_visible) {
+        s4c_print_frame(w, sprites[sprite_index], frameheight, framewidth, startX, startY);
+    }
+    box(w,0,0);
+    wrefresh(w);
+    return (is_visible ? 1 : 0);
+}
+
+/**
+ * Blanks a window and draws the visible instances of a snapshot, such as one read with s4c_state_buffer_read().
+ * Only the cells inside the window and the clip rectangle are printed, and instances with an invalid frame index are skipped.
+ * Output is staged with wnoutrefresh(), so the caller flushes it with doupdate().
+ * @param w The window to print into.
+ * @param sprites The sprites array.
+ * @param num_frames Index of the last frame of the sprites array.
+ * @param states The instances.
+ * @param count How many instances there are.
+ * @param frameheight Height of the frames.
+ * @param framewidth Width of the frames.
+ * @see S4C_State_Buffer
+ * @return How many instances were drawn, at least partially.
+ */
+int s4c_display_instances(WINDOW* w, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int num_frames, const S4C_Instance_State* states, int count, int frameheight, int framewidth)
+{
+    int res = 0;
+    werase(w);
+    for (int i = 0; i < count; i++) {
+        const S4C_Instance_State* st = &states[i];
+        if (!st->visible || st->frame_index < 0 || st->frame_index > num_frames) {
+            continue;
+        }
+        S4C_Rect v;
+        if (s4c_visible_rect(w, frameheight, framewidth, st->x, st->y, &v)) {
+            s4c_print_frame(w, sprites[st->frame_index], frameheight, framewidth, st->x, st->y);
+            res++;
+        }
+    }
+    box(w,0,0);
+    wnoutrefresh(w);
+    return res;
+}
+
+/**
+ * Takes a WINDOW pointer to print into.
+ * Contrary to other of these functions, this one does not touch cursor settings.
+ * Uses the passed sprites and displays a range of them in the passed window, only printing the cells inside the window and the clip rectangle.
+ * @see s4c_pacer_next_frame()
+ * @see s4c_animate_rangeof_sprites_at_coords()
+ * @see s4c_set_clip_rect()
+ * @param sprites The sprites array.
+ * @param w The window to print into.
+ * @param fromFrame The first frame to display.
+ * @param toFrame The last frame to display, included.
+ * @param repetition The number of times the animation will be cycled through.
+ * @param frametime How many mseconds each frame is displayed.
+ * @param num_frames How many frames the animation will have.
+ * @param frameheight Height of the frame.
+ * @param framewidth Width of the frame.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @see S4C_ERR_RANGE
+ * @return 1 if successful, a negative value for errors.
+ */
+int s4c_animate_rangeof_sprites_at_coords_clipped(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY)
+{
+    //Validate requested range
+    if (fromFrame < 0 || toFrame < 0 || fromFrame > toFrame || toFrame > num_frames ) {
+        return S4C_ERR_RANGE;
+    }
+    int prev = -1;
+    S4C_Pacer pacer;
+    s4c_pacer_start(&pacer);
+    for (int current_rep = 0; current_rep < repetitions; current_rep++) {
+        //+1 to include toFrame index
+        for (int i=fromFrame; i<toFrame+1; ) {
+            box(w,0,0);
+            // Print current frame, only the spans changed from the previous one
+            s4c_print_frame_delta(w, (prev >= 0 ? sprites[prev] : NULL), sprites[i], frameheight, framewidth, startX, startY);
+            prev = i;
+            wrefresh(w);
+            i = s4c_pacer_next_frame(&pacer, NULL, i, toFrame, frametime);
+        }
+    }
+    return 1;
+}
+
+/**
+ * Takes a WINDOW pointer to print into and a S4C_Frame_View, and prints the view at the passed coordinates.
+ * Contrary to other of these functions, this one does not touch cursor settings.
+ * Only the cells inside the window and the clip rectangle are printed, as in s4c_display_sprite_at_coords_clipped().
+ * @param view The S4C_Frame_View to print.
+ * @param w The window to print into.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @see s4c_frame_view()
+ * @return 1 if any cell was printed, 0 if the view was not visible.
+ */
+int s4c_display_frame_view_at_coords(const S4C_Frame_View* view, WINDOW* w, int startX, int startY)
+{
+    bool is_visible = s4c_print_view(w, view, startX, startY, NULL);
+    box(w,0,0);
+    wrefresh(w);
+    return (is_visible ? 1 : 0);
+}
+
+/**
+ * Takes a WINDOW pointer to print into and a S4C_Index_Plane, and cycles through all of its frames.
+ * Contrary to other of these functions, this one does not touch cursor settings.
+ * Pixels are mapped to color pairs with a lookup table, with no decoding at draw time.
+ * Only the cells inside the window and the clip rectangle are printed, as in s4c_animate_rangeof_sprites_at_coords_clipped().
+ * @see s4c_pacer_next_frame()
+ * @param plane The S4C_Index_Plane to animate.
+ * @param w The window to print into.
+ * @param transform The S4C_Transform to apply.
+ * @param repetitions The number of times the animation will be cycled through.
+ * @param frametime How many mseconds a frame is displayed, when the plane has no duration for it.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @see s4c_load_index_plane()
+ * @see S4C_ERR_RANGE
+ * @return 1 if successful, a negative value for errors.
+ */
+int s4c_animate_index_plane_at_coords(const S4C_Index_Plane* plane, WINDOW* w, S4C_Transform transform, int repetitions, int frametime, int startX, int startY)
+{
+    if (plane == NULL || plane->data == NULL) {
+        return S4C_ERR_RANGE;
+    }
+    const short* lut = s4c_pair_lut(S4C_PIXELS_INDEXES);
+    S4C_Frame_View prev = {0};
+    bool has_prev = false;
+    S4C_Pacer pacer;
+    s4c_pacer_start(&pacer);
+    for (int current_rep = 0; current_rep < repetitions; current_rep++) {
+        for (int i=0; i<plane->frame_count; ) {
+            S4C_Frame_View view = s4c_index_plane_view(plane, i, transform);
+            box(w,0,0);
+            // Print current frame, only the spans changed from the previous one
+            s4c_print_view_delta(w, (has_prev ? &prev : NULL), &view, lut, startX, startY);
+            prev = view;
+            has_prev = true;
+            wrefresh(w);
+            i = s4c_pacer_next_frame(&pacer, plane->durations, i, plane->frame_count - 1, frametime);
+        }
+    }
+    return 1;
+}
+
+/**
+ * Maps the pixel codes of a S4C_Packed_Plane straight to color pairs, so unpacked rows are printed without going through palette indexes.
+ * @param packed The S4C_Packed_Plane to map.
+ * @param lut Lookup table to fill, -1 for codes that are not drawn.
+ */
+static void s4c_packed_pair_lut(const S4C_Packed_Plane* packed, short lut[S4C_PACKED_MAX_CODES])
+{
+    for (int c = 0; c < S4C_PACKED_MAX_CODES; c++) {
+        lut[c] = (c < packed->num_indexes ? s4c_index_pair_lut[packed->indexes[c]] : -1);
+    }
+}
+
+/**
+ * Takes a S4C_Packed_Plane and prints one of its frames in the passed WINDOW at the passed coordinates.
+ * Contrary to other of these functions, this one does not touch cursor settings.
+ * Rows are unpacked with s4c_unpack_row() into a scratch buffer, then printed as in s4c_display_frame_view_at_coords().
+ * @param packed The S4C_Packed_Plane to print.
+ * @param frame_index Index of the frame.
+ * @param transform The S4C_Transform to apply.
+ * @param w The window to print into.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @see s4c_packed_plane_from_index_plane()
+ * @see S4C_ERR_RANGE
+ * @return 1 if any cell was printed, 0 if the frame was not visible, a negative value for errors.
+ */
+int s4c_display_packed_frame_at_coords(const S4C_Packed_Plane* packed, int frame_index, S4C_Transform transform, WINDOW* w, int startX, int startY)
+{
+    if (packed == NULL || packed->data == NULL || frame_index < 0 || frame_index >= packed->frame_count) {
+        return S4C_ERR_RANGE;
+    }
+    uint8_t scratch[S4C_PACKED_SCRATCH_SIZE];
+    short lut[S4C_PACKED_MAX_CODES];
+    s4c_packed_pair_lut(packed, lut);
+    s4c_packed_plane_unpack_frame(packed, frame_index, scratch);
+    S4C_Frame_View view = s4c_make_view(scratch, packed->framewidth, packed->frameheight, packed->framewidth, transform, S4C_PIXELS_INDEXES);
+    bool is_visible = s4c_print_view_lut(w, &view, lut, startX, startY, NULL);
+    box(w,0,0);
+    wrefresh(w);
+    return (is_visible ? 1 : 0);
+}
+
+/**
+ * Takes a WINDOW pointer to print into and a S4C_Packed_Plane, and cycles through all of its frames.
+ * Contrary to other of these functions, this one does not touch cursor settings.
+ * Each frame is unpacked with s4c_unpack_row() into a scratch buffer, and pixel codes are mapped straight to color pairs.
+ * @see s4c_pacer_next_frame()
+ * @param packed The S4C_Packed_Plane to animate.
+ * @param w The window to print into.
+ * @param transform The S4C_Transform to apply.
+ * @param repetitions The number of times the animation will be cycled through.
+ * @param frametime How many mseconds a frame is displayed, when the plane has no duration for it.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @see s4c_packed_plane_from_index_plane()
+ * @see S4C_ERR_RANGE
+ * @return 1 if successful, a negative value for errors.
+ */
+int s4c_animate_packed_plane_at_coords(const S4C_Packed_Plane* packed, WINDOW* w, S4C_Transform transform, int repetitions, int frametime, int startX, int startY)
+{
+    if (packed == NULL || packed->data == NULL) {
+        return S4C_ERR_RANGE;
+    }
+    // Frames are unpacked in turns to two buffers, so the previous one is kept to diff against
+    uint8_t scratch[2][S4C_PACKED_SCRATCH_SIZE];
+    short lut[S4C_PACKED_MAX_CODES];
+    s4c_packed_pair_lut(packed, lut);
+    S4C_Frame_View views[2];
+    for (int k = 0; k < 2; k++) {
+        views[k] = s4c_make_view(scratch[k], packed->framewidth, packed->frameheight, packed->framewidth, transform, S4C_PIXELS_INDEXES);
+    }
+    int cur = 0;
+    bool has_prev = false;
+    S4C_Pacer pacer;
+    s4c_pacer_start(&pacer);
+    for (int current_rep = 0; current_rep < repetitions; current_rep++) {
+        for (int i=0; i<packed->frame_count; ) {
+            s4c_packed_plane_unpack_frame(packed, i, scratch[cur]);
+            box(w,0,0);
+            // Print current frame, only the spans changed from the previous one
+            s4c_print_view_delta(w, (has_prev ? &views[1-cur] : NULL), &views[cur], lut, startX, startY);
+            has_prev = true;
+            cur = 1-cur;
+            wrefresh(w);
+            i = s4c_pacer_next_frame(&pacer, packed->durations, i, packed->frame_count - 1, frametime);
+        }
+    }
+    return 1;
+}
+
+/**
+ * Takes a WINDOW pointer to print into and an animation array, plus the index of requested frame to print and a S4C_Transform to apply to it.
+ * Frames are not copied: the transform is applied while printing, using a S4C_Frame_View.
+ * Only the cells inside the window and the clip rectangle are printed, as in s4c_display_sprite_at_coords_clipped().
+ * @param sprites The sprites array.
+ * @param sprite_index The index of requested sprite.
+ * @param transform The S4C_Transform to apply.
+ * @param w The window to print into.
+ * @param num_frames How many frames the animation will have.
+ * @param frameheight Height of the frame.
+ * @param framewidth Width of the frame.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @see s4c_frame_view()
+ * @see S4C_ERR_RANGE
+ * @return 1 if any cell was printed, 0 if the frame was not visible, a negative value for errors.
+ */
+int s4c_display_sprite_transformed_at_coords(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int sprite_index, S4C_Transform transform, WINDOW* w, int num_frames, int frameheight, int framewidth, int startX, int startY)
+{
+    //Validate requested range
+    if (sprite_index < 0 || sprite_index > num_frames ) {
+        return S4C_ERR_RANGE;
+    }
+    S4C_Frame_View view = s4c_frame_view(sprites[sprite_index], frameheight, framewidth, transform);
+    return s4c_display_frame_view_at_coords(&view, w, startX, startY);
+}
+
+/**
+ * Takes a WINDOW pointer to print into, and displays a range of the passed sprites with a S4C_Transform applied.
+ * Contrary to other of these functions, this one does not touch cursor settings.
+ * Frames are not copied: the transform is applied while printing, using a S4C_Frame_View.
+ * Only the cells inside the window and the clip rectangle are printed, as in s4c_animate_rangeof_sprites_at_coords_clipped().
+ * @see s4c_pacer_next_frame()
+ * @param sprites The sprites array.
+ * @param w The window to print into.
+ * @param fromFrame The first frame to display.
+ * @param toFrame The last frame to display, included.
+ * @param transform The S4C_Transform to apply.
+ * @param repetition The number of times the animation will be cycled through.
+ * @param frametime How many mseconds each frame is displayed.
+ * @param num_frames How many frames the animation will have.
+ * @param frameheight Height of the frame.
+ * @param framewidth Width of the frame.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @see s4c_frame_view()
+ * @see S4C_ERR_RANGE
+ * @return 1 if successful, a negative value for errors.
+ */
+int s4c_animate_rangeof_sprites_transformed_at_coords(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int fromFrame, int toFrame, S4C_Transform transform, int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY)
+{
+    //Validate requested range
+    if (fromFrame < 0 || toFrame < 0 || fromFrame > toFrame || toFrame > num_frames ) {
+        return S4C_ERR_RANGE;
+    }
+    const short* lut = s4c_pair_lut(S4C_PIXELS_CHARS);
+    S4C_Frame_View prev = {0};
+    bool has_prev = false;
+    S4C_Pacer pacer;
+    s4c_pacer_start(&pacer);
+    for (int current_rep = 0; current_rep < repetitions; current_rep++) {
+        //+1 to include toFrame index
+        for (int i=fromFrame; i<toFrame+1; ) {
+            S4C_Frame_View view = s4c_frame_view(sprites[i], frameheight, framewidth, transform);
+            box(w,0,0);
+            // Print current frame, only the spans changed from the previous one
+            s4c_print_view_delta(w, (has_prev ? &prev : NULL), &view, lut, startX, startY);
+            prev = view;
+            has_prev = true;
+            wrefresh(w);
+            i = s4c_pacer_next_frame(&pacer, NULL, i, toFrame, frametime);
+        }
+    }
+    return 1;
+}
+
+/**
+ * Initialises a S4C_Tilemap drawing to the passed WINDOW, with all tiles empty and the camera at 0,0.
+ * Tile ids index the passed sprites array, which must outlive the map.
+ * @param map The S4C_Tilemap to initialise.
+ * @param win The viewport window.
+ * @param tiles The sprites array holding the tile frames.
+ * @param num_tiles How many tile frames there are.
+ * @param tile_height Height of each tile frame.
+ * @param tile_width Width of each tile frame.
+ * @param map_rows Height of the map, in tiles.
+ * @param map_cols Width of the map, in tiles.
+ * @see s4c_tilemap_free()
+ * @see S4C_ERR_RANGE
+ * @see S4C_ERR_ALLOC
+ * @return 0 if successful, a negative value otherwise.
+ */
+int s4c_tilemap_init(S4C_Tilemap* map, WINDOW* win, char tiles[][S4C_MAXROWS][S4C_MAXCOLS], int num_tiles, int tile_height, int tile_width, int map_rows, int map_cols)
+{
+    if (map == NULL || win == NULL || tiles == NULL || num_tiles <= 0 || num_tiles > SHRT_MAX) {
+        return S4C_ERR_RANGE;
+    }
+    if (tile_height <= 0 || tile_height > S4C_MAXROWS || tile_width <= 0 || tile_width > S4C_MAXCOLS || map_rows <= 0 || map_cols <= 0) {
+        return S4C_ERR_RANGE;
+    }
+    S4C_Tilemap res = {0};
+    res.win = win;
+    res.tiles = tiles;
+    res.num_tiles = num_tiles;
+    res.tile_height = tile_height;
+    res.tile_width = tile_width;
+    res.map_rows = map_rows;
+    res.map_cols = map_cols;
+    res.ids = s4c_mem_malloc(S4C_MEM_PLAYBACK, (size_t) map_rows * map_cols * sizeof(short));
+    if (res.ids == NULL) {
+        return S4C_ERR_ALLOC;
+    }
+    for (size_t i = 0; i < (size_t) map_rows * map_cols; i++) {
+        res.ids[i] = -1;
+    }
+    *map = res;
+    return 0;
+}
+
+/**
+ * Sets the tile id at the passed map coordinates. Only the cells showing the tile are redrawn on next s4c_tilemap_draw(),
+ * unless more than S4C_TILEMAP_MAX_DIRTY tiles changed since the last draw.
+ * @param map The S4C_Tilemap to change.
+ * @param row Map row, in tiles.
+ * @param col Map column, in tiles.
+ * @param tile_id The new tile id. Negative for an empty tile.
+ * @see S4C_ERR_RANGE
+ * @return 0 if successful, a negative value otherwise.
+ */
+int s4c_tilemap_set(S4C_Tilemap* map, int row, int col, short tile_id)
+{
+    if (map == NULL || row < 0 || row >= map->map_rows || col < 0 || col >= map->map_cols || tile_id >= map->num_tiles) {
+        return S4C_ERR_RANGE;
+    }
+    map->ids[(size_t) row * map->map_cols + col] = tile_id;
+    if (!map->drawn) {
+        return 0;
+    }
+    if (map->dirty_count == S4C_TILEMAP_MAX_DIRTY) {
+        map->drawn = false;
+        return 0;
+    }
+    map->dirty[map->dirty_count++] = row * map->map_cols + col;
+    return 0;
+}
+
+/**
+ * Returns the tile id at the passed map coordinates.
+ * @param map The S4C_Tilemap to query.
+ * @param row Map row, in tiles.
+ * @param col Map column, in tiles.
+ * @return The tile id, or -1 for empty tiles and out of range coordinates.
+ */
+short s4c_tilemap_get(const S4C_Tilemap* map, int row, int col)
+{
+    if (map == NULL || row < 0 || row >= map->map_rows || col < 0 || col >= map->map_cols) {
+        return -1;
+    }
+    return map->ids[(size_t) row * map->map_cols + col];
+}
+
+/**
+ * Sets the map cell shown at the upper left corner of the viewport. Takes effect on next s4c_tilemap_draw().
+ * Cells are terminal cells, so a tile spans tile_width columns and s4c_render_rows(tile_height) rows.
+ * @param map The S4C_Tilemap to change.
+ * @param x X coord of the map cell.
+ * @param y Y coord of the map cell.
+ */
+void s4c_tilemap_set_camera(S4C_Tilemap* map, int x, int y)
+{
+    if (map == NULL) {
+        return;
+    }
+    map->camera_x = x;
+    map->camera_y = y;
+}
+
+/**
+ * Moves the camera of a S4C_Tilemap by the passed offsets. Takes effect on next s4c_tilemap_draw().
+ * @param map The S4C_Tilemap to change.
+ * @param dx Offset for the camera X coord.
+ * @param dy Offset for the camera Y coord.
+ * @see s4c_tilemap_set_camera()
+ */
+void s4c_tilemap_move_camera(S4C_Tilemap* map, int dx, int dy)
+{
+    if (map == NULL) {
+        return;
+    }
+    map->camera_x += dx;
+    map->camera_y += dy;
+}
+
+/**
+ * Forgets what the viewport of a S4C_Tilemap shows, so that the next s4c_tilemap_draw() redraws it whole.
+ * Should be called after the viewport window was cleared or written to by anything else.
+ * @param map The S4C_Tilemap to invalidate.
+ */
+void s4c_tilemap_invalidate(S4C_Tilemap* map)
+{
+    if (map == NULL) {
+        return;
+    }
+    map->drawn = false;
+}
+
+/**
+ * Frees the memory held by a S4C_Tilemap. Does not free the viewport window or the tiles.
+ * @param map The S4C_Tilemap to free.
+ */
+void s4c_tilemap_free(S4C_Tilemap* map)
+{
+    if (map == NULL) {
+        return;
+    }
+    s4c_mem_free(map->ids);
+    map->ids = NULL;
+    if (map->scratch != NULL) {
+        delwin(map->scratch);
+        map->scratch = NULL;
+    }
+    map->drawn = false;
+}
+
+/**
+ * Checks the arguments for an animation and sets up its playback state, with the first frame due at 0.
+ * Frames are drawn clipped to the window and the clip rectangle, so the window only needs to show part of them.
+ * @see s4c_scheduler_add()
+ * @see s4c_player_init()
+ * @return 0 if successful, S4C_ERR_RANGE, or S4C_ERR_SMALL_WIN if no cell of the frame is inside the window.
+ */
+static int s4c_animation_init(S4C_Scheduled_Animation* anim, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY)
+{
+    if (sprites == NULL || w == NULL || repetitions < 0) {
+        return S4C_ERR_RANGE;
+    }
+    if (fromFrame < 0 || toFrame < 0 || fromFrame > toFrame || toFrame > num_frames ) {
+        return S4C_ERR_RANGE;
+    }
+    if (frameheight < 1 || frameheight > S4C_MAXROWS || framewidth < 1 || framewidth >= S4C_MAXCOLS) {
+        return S4C_ERR_RANGE;
+    }
+    int win_rows, win_cols;
+    getmaxyx(w, win_rows, win_cols);
+    // Frames are printed one cell in from startX and startY, inside the box
+    if (startX + 1 >= win_cols || startY + 1 >= win_rows || startX + 1 + framewidth <= 0 || startY + 1 + s4c_render_rows(frameheight) <= 0) {
+        return S4C_ERR_SMALL_WIN;
+    }
+    *anim = (S4C_Scheduled_Animation) {
+        .win = w,
+        .sprites = sprites,
+        .durations = NULL,
+        .store = NULL,
+        .fromFrame = fromFrame,
+        .toFrame = toFrame,
+        .repetitions = repetitions,
+        .frametime = (frametime > 0 ? frametime : 1),
+        .frameheight = frameheight,
+        .framewidth = framewidth,
+        .startX = startX,
+        .startY = startY,
+        .current_frame = fromFrame,
+        .prev_frame = -1,
+        .current_rep = 0,
+        .deadline_ns = 0,
+        .heap_pos = -1,
+    };
+    return 0;
+}
+
+/**
+ * Checks if an animation completed its repetitions.
+ */
+static inline bool s4c_animation_finished(const S4C_Scheduled_Animation* anim)
+{
+    return (anim->repetitions > 0 && anim->current_rep >= anim->repetitions);
+}
+
+/**
+ * Checks if an animation is showing the last frame of its last repetition.
+ */
+static inline bool s4c_animation_at_last_frame(const S4C_Scheduled_Animation* anim)
+{
+    return (anim->repetitions > 0 && anim->current_rep == anim->repetitions - 1 && anim->current_frame == anim->toFrame);
+}
+
+/**
+ * Returns the duration of a frame of an animation, in nanoseconds.
+ */
+static inline uint64_t s4c_animation_frame_ns(const S4C_Scheduled_Animation* anim, int frame_index)
+{
+    return (uint64_t) s4c_frame_duration(anim->durations, frame_index, anim->frametime) * 1000000ULL;
+}
+
+/**
+ * Moves an animation to its next frame, and its deadline forward by the duration of the current one.
+ * @param anim The animation to advance.
+ */
+static void s4c_animation_advance(S4C_Scheduled_Animation* anim)
+{
+    anim->deadline_ns += s4c_animation_frame_ns(anim, anim->current_frame);
+    anim->current_frame++;
+    if (anim->current_frame > anim->toFrame) {
+        // We finished a whole cycle
+        anim->current_frame = anim->fromFrame;
+        anim->current_rep++;
+    }
+}
+
+/**
+ * Skips the frames of an animation which should have already ended at the passed time, so that it stays on time
+ * instead of slowing down. The last frame of the last repetition is never skipped.
+ * If the animation is late by more than a whole cycle, it is resynced to the passed time instead.
+ * @param anim The animation to catch up.
+ * @param now_ns Current time, in nanoseconds from s4c_now_ns().
+ * @return How many frames were skipped.
+ */
+static unsigned long s4c_animation_catch_up(S4C_Scheduled_Animation* anim, uint64_t now_ns)
+{
+    unsigned long skipped = 0;
+    unsigned long range = anim->toFrame - anim->fromFrame + 1;
+    while (anim->deadline_ns + s4c_animation_frame_ns(anim, anim->current_frame) <= now_ns && !s4c_animation_at_last_frame(anim)) {
+        if (skipped >= range) {
+            anim->deadline_ns = now_ns;
+            break;
+        }
+        s4c_animation_advance(anim);
+        skipped++;
+    }
+    anim->skipped += skipped;
+    return skipped;
+}
+
+/**
+ * Draws the current frame of an animation with wnoutrefresh(), only printing the spans changed from the previous one,
+ * then advances it.
+ * @param anim The animation to draw.
+ * @see s4c_animation_advance()
+ */
+static void s4c_animation_draw(S4C_Scheduled_Animation* anim)
+{
+    box(anim->win,0,0);
+    s4c_print_frame_delta(anim->win, (anim->prev_frame >= 0 ? anim->sprites[anim->prev_frame] : NULL), anim->sprites[anim->current_frame], anim->frameheight, anim->framewidth, anim->startX, anim->startY);
+    wnoutrefresh(anim->win);
+    anim->prev_frame = anim->current_frame;
+    anim->frames_drawn++;
+    s4c_animation_advance(anim);
+}
+
+/**
+ * Compares the deadlines of two heap positions of a S4C_Scheduler. Ties go to the lower slot, so order is stable.
+ * @param sched The S4C_Scheduler to use.
+ * @param a First heap position.
+ * @param b Second heap position.
+ * @return True if the animation at a is due before the one at b.
+ */
+static inline bool s4c_sched_before(const S4C_Scheduler* sched, int a, int b)
+{
+    const S4C_Scheduled_Animation* x = &sched->slots[sched->heap[a]];
+    const S4C_Scheduled_Animation* y = &sched->slots[sched->heap[b]];
+    if (x->deadline_ns != y->deadline_ns) {
+        return x->deadline_ns < y->deadline_ns;
+    }
+    return sched->heap[a] < sched->heap[b];
+}
+
+/**
+ * Compares two due animations of a S4C_Scheduler for drawing order: higher priority first, then the least recently drawn.
+ * @param sched The S4C_Scheduler to use.
+ * @param a First slot.
+ * @param b Second slot.
+ * @return True if the animation at a should be drawn before the one at b.
+ */
+static inline bool s4c_sched_draws_before(const S4C_Scheduler* sched, int a, int b)
+{
+    const S4C_Scheduled_Animation* x = &sched->slots[a];
+    const S4C_Scheduled_Animation* y = &sched->slots[b];
+    if (x->priority != y->priority) {
+        return x->priority > y->priority;
+    }
+    if (x->draw_seq != y->draw_seq) {
+        return x->draw_seq < y->draw_seq;
+    }
+    return a < b;
+}
+
+/**
+ * Swaps two heap positions of a S4C_Scheduler, keeping heap_pos of their slots in sync.
+ * @param sched The S4C_Scheduler to use.
+ * @param a First heap position.
+ * @param b Second heap position.
+ */
+static inline void s4c_sched_swap(S4C_Scheduler* sched, int a, int b)
+{
+    int tmp = sched->heap[a];
+    sched->heap[a] = sched->heap[b];
+    sched->heap[b] = tmp;
+    sched->slots[sched->heap[a]].heap_pos = a;
+    sched->slots[sched->heap[b]].heap_pos = b;
+}
+
+/**
+ * Restores the heap order of a S4C_Scheduler around the passed position, after its deadline changed.
+ * @param sched The S4C_Scheduler to use.
+ * @param pos The heap position to fix.
+ */
+static void s4c_sched_fix(S4C_Scheduler* sched, int pos)
+{
+    while (pos > 0 && s4c_sched_before(sched, pos, (pos - 1) / 2)) {
+        s4c_sched_swap(sched, pos, (pos - 1) / 2);
+        pos = (pos - 1) / 2;
+    }
+    for (;;) {
+        int left = 2 * pos + 1;
+        int right = left + 1;
+        int min = pos;
+        if (left < sched->count && s4c_sched_before(sched, left, min)) {
+            min = left;
+        }
+        if (right < sched->count && s4c_sched_before(sched, right, min)) {
+            min = right;
+        }
+        if (min == pos) {
+            return;
+        }
+        s4c_sched_swap(sched, pos, min);
+        pos = min;
+    }
+}
+
+/**
+ * Takes the animation at the passed slot out of the heap of a S4C_Scheduler, and frees the slot.
+ * @param sched The S4C_Scheduler to use.
+ * @param slot The slot to free.
+ */
+static void s4c_sched_unlink(S4C_Scheduler* sched, int slot)
+{
+    int pos = sched->slots[slot].heap_pos;
+    sched->count--;
+    if (pos != sched->count) {
+        s4c_sched_swap(sched, pos, sched->count);
+        s4c_sched_fix(sched, pos);
+    }
+    s4c_frame_store_release(sched->slots[slot].store);
+    sched->slots[slot].store = NULL;
+    sched->slots[slot].win = NULL;
+    sched->slots[slot].heap_pos = -1;
+}
+
+/**
+ * Arms the timer of a S4C_Scheduler, if it has one, at its earliest deadline. Disarms it when no animation is scheduled.
+ * @param sched The S4C_Scheduler to use.
+ * @return 0 if successful, S4C_ERR_TIMER if timerfd_settime() failed.
+ */
+static int s4c_sched_arm(S4C_Scheduler* sched)
+{
+#ifdef S4C_HAS_TIMERFD
+    if (sched->timer_fd < 0) {
+        return 0;
+    }
+    uint64_t deadline = s4c_scheduler_next_deadline(sched);
+    struct itimerspec spec = {0};
+    spec.it_value.tv_sec = (time_t) (deadline / 1000000000ULL);
+    spec.it_value.tv_nsec = (long) (deadline % 1000000000ULL);
+    if (timerfd_settime(sched->timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) != 0) {
+        return S4C_ERR_TIMER;
+    }
+#else
+    (void) sched;
+#endif // S4C_HAS_TIMERFD
+    return 0;
+}
+
+/**
+ * Initialises a S4C_Scheduler with room for the passed number of animations.
+ * More slots are allocated by s4c_scheduler_add() when needed.
+ * @param sched The S4C_Scheduler to initialise.
+ * @param capacity How many animations to allocate slots for.
+ * @see s4c_scheduler_free()
+ * @return 0 if successful, S4C_ERR_RANGE for invalid arguments, S4C_ERR_ALLOC for failed allocations.
+ */
+int s4c_scheduler_init(S4C_Scheduler* sched, int capacity)
+{
+    if (sched == NULL || capacity <= 0) {
+        return S4C_ERR_RANGE;
+    }
+    S4C_Scheduler res = {0};
+    res.slots = s4c_mem_calloc(S4C_MEM_PLAYBACK, capacity, sizeof(S4C_Scheduled_Animation));
+    res.heap = s4c_mem_malloc(S4C_MEM_PLAYBACK, capacity * sizeof(int));
+    if (res.slots == NULL || res.heap == NULL) {
+        s4c_mem_free(res.slots);
+        s4c_mem_free(res.heap);
+        return S4C_ERR_ALLOC;
+    }
+    for (int i = 0; i < capacity; i++) {
+        res.slots[i].heap_pos = -1;
+    }
+    res.capacity = capacity;
+    res.timer_fd = -1;
+    *sched = res;
+    return 0;
+}
+
+/**
+ * Adds an animation of a range of sprites to a S4C_Scheduler. Its first frame is due immediately.
+ * Frames are drawn by s4c_scheduler_step(), only printing the spans changed from the previous frame.
+ * Frames partially outside of the window are drawn clipped, as by s4c_animate_rangeof_sprites_at_coords_clipped().
+ * The sprites array must stay valid while the animation is scheduled.
+ * When the animation completes its repetitions, it is removed and its id can be reused by later calls.
+ * @param sched The S4C_Scheduler to add to.
+ * @param sprites The sprites array.
+ * @param w The window to print into.
+ * @param fromFrame First frame of the range.
+ * @param toFrame Last frame of the range, included.
+ * @param repetitions The number of times the range will be cycled through. 0 loops until removed.
+ * @param frametime How many mseconds each frame is displayed.
+ * @param num_frames Index of the last frame of the animation.
+ * @param frameheight Height of the frame.
+ * @param framewidth Width of the frame.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @see S4C_ERR_RANGE
+ * @see S4C_ERR_SMALL_WIN
+ * @see S4C_ERR_ALLOC
+ * @see S4C_ERR_TIMER
+ * @return The id of the animation, or a negative value for errors. S4C_ERR_TIMER if the timer could not be armed, the animation is not added.
+ */
+int s4c_scheduler_add(S4C_Scheduler* sched, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY)
+{
+    if (sched == NULL) {
+        return S4C_ERR_RANGE;
+    }
+    S4C_Scheduled_Animation anim;
+    int res = s4c_animation_init(&anim, sprites, w, fromFrame, toFrame, repetitions, frametime, num_frames, frameheight, framewidth, startX, startY);
+    if (res != 0) {
+        return res;
+    }
+    if (sched->count == sched->capacity) {
+        int capacity = sched->capacity * 2;
+        S4C_Scheduled_Animation* slots = s4c_mem_realloc(S4C_MEM_PLAYBACK, sched->slots, capacity * sizeof(S4C_Scheduled_Animation));
+        if (slots == NULL) {
+            return S4C_ERR_ALLOC;
+        }
+        sched->slots = slots;
+        int* heap = s4c_mem_realloc(S4C_MEM_PLAYBACK, sched->heap, capacity * sizeof(int));
+        if (heap == NULL) {
+            return S4C_ERR_ALLOC;
+        }
+        sched->heap = heap;
+        for (int i = sched->capacity; i < capacity; i++) {
+            sched->slots[i] = (S4C_Scheduled_Animation) {
+                .win = NULL, .heap_pos = -1,
+            };
+        }
+        sched->capacity = capacity;
+    }
+    int slot = 0;
+    while (sched->slots[slot].win != NULL) {
+        slot++;
+    }
+    anim.deadline_ns = s4c_now_ns();
+    anim.heap_pos = sched->count;
+    sched->slots[slot] = anim;
+    sched->heap[sched->count] = slot;
+    sched->count++;
+    s4c_sched_fix(sched, sched->count - 1);
+    if (s4c_sched_arm(sched) != 0) {
+        // Nobody would be woken up for it
+        s4c_sched_unlink(sched, slot);
+        return S4C_ERR_TIMER;
+    }
+    return slot;
+}
+
+/**
+ * Adds an animation of the frames in a shared S4C_Frame_Store to a S4C_Scheduler, using the durations held by the store.
+ * The scheduler takes a reference to the store, and releases it when the animation is removed or completes.
+ * @param sched The S4C_Scheduler to add to.
+ * @param store The S4C_Frame_Store to animate.
+ * @param w The window to print into.
+ * @param fromFrame First frame of the range.
+ * @param toFrame Last frame of the range, included.
+ * @param repetitions The number of times the range will be cycled through. 0 loops until removed.
+ * @param frametime How many mseconds each frame without a duration is displayed.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @see s4c_scheduler_add()
+ * @return The id of the animation, or a negative value for errors.
+ */
+int s4c_scheduler_add_shared(S4C_Scheduler* sched, S4C_Frame_Store* store, WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int startX, int startY)
+{
+    if (store == NULL) {
+        return S4C_ERR_RANGE;
+    }
+    int id = s4c_scheduler_add(sched, store->sprites, w, fromFrame, toFrame, repetitions, frametime, store->frame_count - 1, store->frameheight, store->framewidth, startX, startY);
+    if (id >= 0) {
+        sched->slots[id].store = s4c_frame_store_retain(store);
+        sched->slots[id].durations = store->durations;
+    }
+    return id;
+}
+
+/**
+ * Sets the display duration of each frame of an animation in a S4C_Scheduler. Takes effect from the next drawn frame.
+ * The durations array must stay valid while the animation is scheduled.
+ * @param sched The S4C_Scheduler to use.
+ * @param id The id returned by s4c_scheduler_add().
+ * @param durations Display duration of each frame in mseconds, 0 for frames using frametime. NULL to always use frametime.
+ * @see s4c_frame_duration()
+ * @return 1 if successful, S4C_ERR_RANGE if id is not scheduled.
+ */
+int s4c_scheduler_set_durations(S4C_Scheduler* sched, int id, const int durations[])
+{
+    if (!s4c_scheduler_is_active(sched, id)) {
+        return S4C_ERR_RANGE;
+    }
+    sched->slots[id].durations = durations;
+    return 1;
+}
+
+/**
+ * Sets the priority of an animation in a S4C_Scheduler. When output falls behind, lower priorities skip frames first.
+ * @param sched The S4C_Scheduler to use.
+ * @param id The id returned by s4c_scheduler_add().
+ * @param priority The priority. Animations start at 0.
+ * @see s4c_scheduler_step()
+ * @return 1 if successful, S4C_ERR_RANGE if id is not scheduled.
+ */
+int s4c_scheduler_set_priority(S4C_Scheduler* sched, int id, int priority)
+{
+    if (!s4c_scheduler_is_active(sched, id)) {
+        return S4C_ERR_RANGE;
+    }
+    sched->slots[id].priority = priority;
+    return 1;
+}
+
+/**
+ * Removes an animation from a S4C_Scheduler. Its last drawn frame is left on screen.
+ * @param sched The S4C_Scheduler to remove from.
+ * @param id The id returned by s4c_scheduler_add().
+ * @return 1 if successful, S4C_ERR_RANGE if id is not scheduled, S4C_ERR_TIMER if the timer could not be armed after removing it.
+ */
+int s4c_scheduler_remove(S4C_Scheduler* sched, int id)
+{
+    if (!s4c_scheduler_is_active(sched, id)) {
+        return S4C_ERR_RANGE;
+    }
+    s4c_sched_unlink(sched, id);
+    if (s4c_sched_arm(sched) != 0) {
+        return S4C_ERR_TIMER;
+    }
+    return 1;
+}
+
+/**
+ * Checks if the passed id is scheduled in a S4C_Scheduler.
+ * @param sched The S4C_Scheduler to check.
+ * @param id The id returned by s4c_scheduler_add().
+ * @return True if the animation has not completed nor been removed.
+ */
+bool s4c_scheduler_is_active(const S4C_Scheduler* sched, int id)
+{
+    return (sched != NULL && id >= 0 && id < sched->capacity && sched->slots[id].win != NULL);
+}
+
+/**
+ * Returns the earliest deadline among the animations of a S4C_Scheduler.
+ * @param sched The S4C_Scheduler to check.
+ * @return The deadline in nanoseconds from s4c_now_ns(), or 0 if no animation is scheduled.
+ */
+uint64_t s4c_scheduler_next_deadline(const S4C_Scheduler* sched)
+{
+    if (sched == NULL || sched->count == 0) {
+        return 0;
+    }
+    return sched->slots[sched->heap[0]].deadline_ns;
+}
+
+/**
+ * Draws the frame of every animation of a S4C_Scheduler due at the passed time, then flushes them with one doupdate().
+ * Does not sleep: use s4c_scheduler_next_deadline() to know when to call it again, or s4c_scheduler_run().
+ * Each due animation draws at most one frame. Animations running late skip the frames that should have already ended,
+ * so they stay on time instead of slowing down.
+ * The time to output a frame is measured on each step. When drawing all due frames would take longer than
+ * the shortest of their durations, frames are drawn by priority, then least recently drawn first,
+ * and the remaining ones are skipped.
+ * Animations that completed their repetitions are removed when their last frame expires.
+ * @param sched The S4C_Scheduler to step.
+ * @param now_ns Current time, in nanoseconds from s4c_now_ns().
+ * @see s4c_scheduler_set_priority()
+ * @see S4C_ERR_TIMER
+ * @return How many frames were drawn, or S4C_ERR_TIMER if the timer could not be armed for the next deadline.
+ */
+int s4c_scheduler_step(S4C_Scheduler* sched, uint64_t now_ns)
+{
+    if (sched == NULL) {
+        return 0;
+    }
+    // Pop the due animations, moving them past the end of the heap
+    int end = sched->count;
+    while (sched->count > 0 && sched->slots[sched->heap[0]].deadline_ns <= now_ns) {
+        sched->count--;
+        if (sched->count > 0) {
+            s4c_sched_swap(sched, 0, sched->count);
+            s4c_sched_fix(sched, 0);
+        }
+    }
+    int first = sched->count;
+    // Skip the frames that should have already ended, and find how long until one of the due animations needs its next frame
+    uint64_t budget = UINT64_MAX;
+    for (int k = first; k < end; k++) {
+        S4C_Scheduled_Animation* a = &sched->slots[sched->heap[k]];
+        if (s4c_animation_finished(a)) {
+            continue;
+        }
+        sched->skipped += s4c_animation_catch_up(a, now_ns);
+        uint64_t next = a->deadline_ns + s4c_animation_frame_ns(a, a->current_frame);
+        if (next > now_ns && next - now_ns < budget) {
+            budget = next - now_ns;
+        }
+    }
+    for (int k = first + 1; k < end; k++) {
+        int slot = sched->heap[k];
+        int m = k;
+        while (m > first && s4c_sched_draws_before(sched, slot, sched->heap[m-1])) {
+            sched->heap[m] = sched->heap[m-1];
+            m--;
+        }
+        sched->heap[m] = slot;
+    }
+    uint64_t start = s4c_now_ns();
+    int drawn = 0;
+    for (int k = first; k < end; k++) {
+        int slot = sched->heap[k];
+        S4C_Scheduled_Animation* a = &sched->slots[slot];
+        if (s4c_animation_finished(a)) {
+            s4c_frame_store_release(a->store);
+            a->store = NULL;
+            a->win = NULL;
+            a->heap_pos = -1;
+            continue;
+        }
+        if (drawn > 0 && sched->frame_cost_ns * (drawn + 1) > budget && !s4c_animation_at_last_frame(a)) {
+            // Output is falling behind, lower priorities skip this frame
+            s4c_animation_advance(a);
+            a->skipped++;
+            sched->skipped++;
+        } else {
+            s4c_animation_draw(a);
+            drawn++;
+            a->draw_seq = sched->frames_drawn + drawn;
+        }
+        // Push it back in the heap, count never passes k
+        sched->heap[sched->count] = slot;
+        a->heap_pos = sched->count;
+        sched->count++;
+        s4c_sched_fix(sched, sched->count - 1);
+    }
+    if (drawn > 0) {
+        doupdate();
+        uint64_t cost = (s4c_now_ns() - start) / drawn;
+        sched->frame_cost_ns = (sched->frame_cost_ns == 0 ? cost : (7 * sched->frame_cost_ns + cost) / 8);
+        sched->frames_drawn += drawn;
+    }
+    if (s4c_sched_arm(sched) != 0) {
+        return S4C_ERR_TIMER;
+    }
+    return drawn;
+}
+
+/**
+ * Runs the animations of a S4C_Scheduler, sleeping until each next deadline with s4c_sleep_until_ns().
+ * Wakeup delays are recorded in the stats returned by s4c_get_pacing_stats().
+ * Makes the cursor invisible while running.
+ * @param sched The S4C_Scheduler to run.
+ * @param duration How many mseconds to run for. If not positive, runs until all animations complete.
+ * @see s4c_scheduler_step()
+ * @see S4C_ERR_CURSOR
+ * @return 1 if successful, a negative value for errors, including the ones returned by s4c_scheduler_step().
+ */
+int s4c_scheduler_run(S4C_Scheduler* sched, int duration)
+{
+    if (sched == NULL) {
+        return S4C_ERR_RANGE;
+    }
+    int cursorCheck = curs_set(0); // We make the cursor invisible or return early with the error
+
+    if (cursorCheck == ERR) {
+        return S4C_ERR_CURSOR;
+    }
+    uint64_t end = (duration > 0 ? s4c_now_ns() + (uint64_t) duration * 1000000ULL : UINT64_MAX);
+    while (sched->count > 0) {
+        uint64_t deadline = s4c_scheduler_next_deadline(sched);
+        if (deadline >= end) {
+            s4c_sleep_until_ns(end);
+            break;
+        }
+        s4c_sleep_until_ns(deadline);
+        uint64_t now = s4c_now_ns();
+        s4c_pacing_record((int64_t) (now - deadline), false);
+        int stepCheck = s4c_scheduler_step(sched, now);
+        if (stepCheck < 0) {
+            curs_set(1);
+            return stepCheck;
+        }
+    }
+    // We make the cursor normal again
+    curs_set(1);
+    return 1;
+}
+
+/**
+ * Makes the next frame of every animation of a S4C_Scheduler print whole, instead of only the changed spans.
+ * Call this after the windows were cleared or overwritten.
+ * @param sched The S4C_Scheduler to invalidate.
+ */
+void s4c_scheduler_invalidate(S4C_Scheduler* sched)
+{
+    if (sched == NULL) {
+        return;
+    }
+    for (int i = 0; i < sched->capacity; i++) {
+        sched->slots[i].prev_frame = -1;
+    }
+}
+
+/**
+ * Returns a file descriptor that becomes readable when an animation of a S4C_Scheduler is due, to use with poll() or epoll().
+ * The descriptor is a non-blocking timerfd on CLOCK_MONOTONIC, created on the first call and kept armed at the earliest deadline
+ * by s4c_scheduler_add(), s4c_scheduler_remove() and s4c_scheduler_step(). It is closed by s4c_scheduler_free().
+ * When it is readable, call s4c_scheduler_dispatch().
+ * Only available on Linux: elsewhere, poll with a timeout from s4c_deadline_timeout_ms() and s4c_scheduler_next_deadline().
+ * @param sched The S4C_Scheduler to use.
+ * @see S4C_ERR_TIMER
+ * @return The file descriptor, or a negative value for errors.
+ */
+int s4c_scheduler_timer_fd(S4C_Scheduler* sched)
+{
+    if (sched == NULL) {
+        return S4C_ERR_RANGE;
+    }
+#ifdef S4C_HAS_TIMERFD
+    if (sched->timer_fd < 0) {
+        sched->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (sched->timer_fd < 0) {
+            return S4C_ERR_TIMER;
+        }
+        if (s4c_sched_arm(sched) != 0) {
+            close(sched->timer_fd);
+            sched->timer_fd = -1;
+            return S4C_ERR_TIMER;
+        }
+    }
+    return sched->timer_fd;
+#else
+    return S4C_ERR_TIMER;
+#endif // S4C_HAS_TIMERFD
+}
+
+/**
+ * Consumes the expirations of the timer of a S4C_Scheduler, then draws the animations due with s4c_scheduler_step().
+ * Call this when the descriptor from s4c_scheduler_timer_fd() is readable. Never blocks.
+ * @param sched The S4C_Scheduler to use.
+ * @see S4C_ERR_TIMER
+ * @return How many frames were drawn, or S4C_ERR_TIMER if the timer could not be armed for the next deadline.
+ */
+int s4c_scheduler_dispatch(S4C_Scheduler* sched)
+{
+    if (sched == NULL) {
+        return 0;
+    }
+    if (sched->timer_fd >= 0) {
+        uint64_t expirations;
+        while (read(sched->timer_fd, &expirations, sizeof(expirations)) < 0 && errno == EINTR) {
+            continue;
+        }
+    }
+    return s4c_scheduler_step(sched, s4c_now_ns());
+}
+
+/**
+ * Frees the memory held by a S4C_Scheduler. Drawn frames are left on screen.
+ * @param sched The S4C_Scheduler to free.
+ */
+void s4c_scheduler_free(S4C_Scheduler* sched)
+{
+    if (sched == NULL) {
+        return;
+    }
+    for (int i = 0; i < sched->count; i++) {
+        s4c_frame_store_release(sched->slots[sched->heap[i]].store);
+    }
+    s4c_mem_free(sched->slots);
+    s4c_mem_free(sched->heap);
+    if (sched->timer_fd >= 0) {
+        close(sched->timer_fd);
+    }
+    *sched = (S4C_Scheduler) {
+        0
+    };
+    sched->timer_fd = -1;
+}
+
+/**
+ * Initialises a S4C_Player to play a range of sprites with s4c_player_tick(). Nothing is drawn until the first tick.
+ * Frames are clipped to the window as in s4c_scheduler_add().
+ * The sprites array must stay valid while the player is used. A player holds no allocations, unlike the ones from s4c_player_init_shared().
+ * @param player The S4C_Player to initialise.
+ * @param sprites The sprites array.
+ * @param w The window to print into.
+ * @param fromFrame First frame of the range.
+ * @param toFrame Last frame of the range, included.
+ * @param repetitions The number of times the range will be cycled through. 0 loops forever.
+ * @param frametime How many mseconds each frame is displayed.
+ * @param num_frames Index of the last frame of the animation.
+ * @param frameheight Height of the frame.
+ * @param framewidth Width of the frame.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @see S4C_ERR_RANGE
+ * @see S4C_ERR_SMALL_WIN
+ * @return 0 if successful, a negative value for errors.
+ */
+int s4c_player_init(S4C_Player* player, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY)
+{
+    if (player == NULL) {
+        return S4C_ERR_RANGE;
+    }
+    S4C_Player res = {0};
+    int check = s4c_animation_init(&res.anim, sprites, w, fromFrame, toFrame, repetitions, frametime, num_frames, frameheight, framewidth, startX, startY);
+    if (check != 0) {
+        return check;
+    }
+    *player = res;
+    return 0;
+}
+
+/**
+ * Initialises a S4C_Player for the frames in a shared S4C_Frame_Store, using the durations held by the store.
+ * The player takes a reference to the store, released by s4c_player_free().
+ * @param player The S4C_Player to initialise.
+ * @param store The S4C_Frame_Store to animate.
+ * @param w The window to print into.
+ * @param fromFrame First frame of the range.
+ * @param toFrame Last frame of the range, included.
+ * @param repetitions The number of times the range will be cycled through. 0 loops forever.
+ * @param frametime How many mseconds each frame without a duration is displayed.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @see s4c_player_init()
+ * @return 0 if successful, a negative value for errors.
+ */
+int s4c_player_init_shared(S4C_Player* player, S4C_Frame_Store* store, WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int startX, int startY)
+{
+    if (store == NULL) {
+        return S4C_ERR_RANGE;
+    }
+    int res = s4c_player_init(player, store->sprites, w, fromFrame, toFrame, repetitions, frametime, store->frame_count - 1, store->frameheight, store->framewidth, startX, startY);
+    if (res == 0) {
+        player->anim.store = s4c_frame_store_retain(store);
+        player->anim.durations = store->durations;
+    }
+    return res;
+}
+
+/**
+ * Sets the display duration of each frame of a S4C_Player. Takes effect from the next drawn frame.
+ * The durations array must stay valid while the player is used.
+ * @param player The S4C_Player to use.
+ * @param durations Display duration of each frame in mseconds, 0 for frames using frametime. NULL to always use frametime.
+ * @see s4c_frame_duration()
+ */
+void s4c_player_set_durations(S4C_Player* player, const int durations[])
+{
+    if (player == NULL) {
+        return;
+    }
+    player->anim.durations = durations;
+}
+
+/**
+ * Draws the frame of a S4C_Player due at the passed time, if any, and returns when the next one is due. Never sleeps.
+ * Meant to be called from the caller's own event loop, between input handling: see s4c_deadline_timeout_ms().
+ * The first tick draws the first frame and starts the player's clock at now_ns.
+ * At most one frame is drawn per tick. When ticks come late, the frames that should have already ended are skipped,
+ * so the animation stays on time instead of slowing down. They are counted in anim.skipped.
+ * Does not touch cursor settings.
+ * @param player The S4C_Player to tick.
+ * @param now_ns Current time, in nanoseconds from s4c_now_ns().
+ * @return The deadline of the next frame in nanoseconds from s4c_now_ns(), or 0 if the player completed its repetitions, is NULL or was freed.
+ */
+uint64_t s4c_player_tick(S4C_Player* player, uint64_t now_ns)
+{
+    if (player == NULL || player->anim.win == NULL || player->anim.sprites == NULL) {
+        return 0;
+    }
+    S4C_Scheduled_Animation* anim = &player->anim;
+    if (s4c_animation_finished(anim)) {
+        return 0;
+    }
+    if (anim->deadline_ns == 0) {
+        anim->deadline_ns = now_ns;
+    }
+    if (anim->deadline_ns > now_ns) {
+        return anim->deadline_ns;
+    }
+    s4c_animation_catch_up(anim, now_ns);
+    s4c_animation_draw(anim);
+    doupdate();
+    // The last frame stays on screen for its whole duration before the player is done
+    return anim->deadline_ns;
+}
+
+/**
+ * Checks if a S4C_Player completed its repetitions, and its last frame expired.
+ * @param player The S4C_Player to check.
+ * @param now_ns Current time, in nanoseconds from s4c_now_ns().
+ * @return True if the player is done, or NULL.
+ */
+bool s4c_player_done(const S4C_Player* player, uint64_t now_ns)
+{
+    if (player == NULL) {
+        return true;
+    }
+    return (s4c_animation_finished(&player->anim) && player->anim.deadline_ns <= now_ns);
+}
+
+/**
+ * Makes the next frame of a S4C_Player print whole, instead of only the changed spans.
+ * Call this after its window was cleared or overwritten.
+ * @param player The S4C_Player to invalidate.
+ */
+void s4c_player_invalidate(S4C_Player* player)
+{
+    if (player == NULL) {
+        return;
+    }
+    player->anim.prev_frame = -1;
+}
+
+/**
+ * Releases the S4C_Frame_Store referenced by a S4C_Player, if any. The player must be initialised again before use.
+ * @param player The S4C_Player to free.
+ * @see s4c_player_init_shared()
+ */
+void s4c_player_free(S4C_Player* player)
+{
+    if (player == NULL) {
+        return;
+    }
+    s4c_frame_store_release(player->anim.store);
+    player->anim.store = NULL;
+    player->anim.win = NULL;
+}
 
-    if (win_rows < rows + startY || win_cols < cols + startX) {
-        return S4C_ERR_SMALL_WIN;
+/**
+ * Converts a deadline to a timeout in mseconds, rounded up, as expected by wtimeout() or poll().
+ * @param deadline_ns The deadline, in nanoseconds from s4c_now_ns(). 0 means no deadline.
+ * @param now_ns Current time, in nanoseconds from s4c_now_ns().
+ * @return How many mseconds until the deadline, 0 if it passed, or -1 if there is no deadline.
+ */
+int s4c_deadline_timeout_ms(uint64_t deadline_ns, uint64_t now_ns)
+{
+    if (deadline_ns == 0) {
+        return -1;
+    }
+    if (deadline_ns <= now_ns) {
+        return 0;
+    }
+    uint64_t ms = (deadline_ns - now_ns + 999999ULL) / 1000000ULL;
+    return (ms > INT_MAX ? INT_MAX : (int) ms);
+}
+
+/**
+ * Holds an animation played on its own thread by s4c_animation_start().
+ * The playback state is only touched by the thread holding lock. Requests are published with atomics
+ * and the thread is woken with cond, so they don't wait for the current frame to end.
+ */
+struct S4C_Animation_Handle {
+    S4C_Scheduled_Animation anim; /**< The animation and its playback state.*/
+    pthread_t thread; /**< The thread playing the animation.*/
+    pthread_mutex_t lock; /**< Protects anim, held by the thread while it draws.*/
+    pthread_cond_t cond; /**< Signaled on each request, waited on by the thread between frames.*/
+    atomic_int state; /**< A S4C_Animation_State value.*/
+    atomic_int seek_frame; /**< Frame requested by s4c_animation_seek(), or -1.*/
+    atomic_int current_frame; /**< Index of the frame on screen.*/
+    S4C_Render_Queue* queue; /**< Queue frames are submitted to instead of being drawn, or NULL.*/
+};
+
+/**
+ * Waits on a condition variable until signaled or until the passed deadline on the monotonic clock.
+ * Where condition variables can't use CLOCK_MONOTONIC, the deadline is converted to CLOCK_REALTIME.
+ * @param cond The condition variable, initialised by s4c_animation_start().
+ * @param lock The locked mutex.
+ * @param deadline_ns The deadline, in nanoseconds from s4c_now_ns().
+ */
+static void s4c_cond_wait_until(pthread_cond_t* cond, pthread_mutex_t* lock, uint64_t deadline_ns)
+{
+#if defined(__APPLE__) || defined(_WIN32)
+    uint64_t now = s4c_now_ns();
+    struct timespec real;
+    clock_gettime(CLOCK_REALTIME, &real);
+    deadline_ns = (uint64_t) real.tv_sec * 1000000000ULL + (uint64_t) real.tv_nsec + (deadline_ns > now ? deadline_ns - now : 0);
+#endif
+    struct timespec ts = {
+        .tv_sec = (time_t) (deadline_ns / 1000000000ULL),
+        .tv_nsec = (long) (deadline_ns % 1000000000ULL),
+    };
+    pthread_cond_timedwait(cond, lock, &ts);
+}
+
+/**
+ * Draws the current frame of the animation of a S4C_Animation_Handle, and flushes it with doupdate().
+ * Must be called holding its lock.
+ * @param handle The S4C_Animation_Handle to draw.
+ */
+static void s4c_animation_show(S4C_Animation_Handle* handle)
+{
+    S4C_Scheduled_Animation* anim = &handle->anim;
+    atomic_store(&handle->current_frame, anim->current_frame);
+    if (handle->queue == NULL) {
+        s4c_animation_draw(anim);
+        doupdate();
+        return;
+    }
+    S4C_Render_Command cmd = {
+        .type = S4C_RENDER_FRAME,
+        .win = anim->win,
+        .sprites = anim->sprites,
+        .store = anim->store,
+        .frame_index = anim->current_frame,
+        .prev_frame = anim->prev_frame,
+        .frameheight = anim->frameheight,
+        .framewidth = anim->framewidth,
+        .startX = anim->startX,
+        .startY = anim->startY,
+        .boxed = true,
+    };
+    if (s4c_render_queue_submit(handle->queue, &cmd) == 0) {
+        anim->prev_frame = anim->current_frame;
+        anim->frames_drawn++;
+    } else {
+        // The render thread is behind, the frame is dropped and the next one is drawn from the last frame submitted
+        anim->skipped++;
+    }
+    s4c_animation_advance(anim);
+}
+
+/**
+ * Plays the animation of a S4C_Animation_Handle until it completes or is stopped.
+ * Sleeps on the handle's condition variable until the next deadline, so requests wake it immediately.
+ * @param arg The S4C_Animation_Handle.
+ * @return NULL.
+ */
+static void* s4c_animation_worker(void* arg)
+{
+    S4C_Animation_Handle* handle = arg;
+    S4C_Scheduled_Animation* anim = &handle->anim;
+    pthread_mutex_lock(&handle->lock);
+    anim->deadline_ns = s4c_now_ns();
+    for (;;) {
+        int state = atomic_load(&handle->state);
+        if (state == S4C_ANIMATION_STOPPED) {
+            break;
+        }
+        int seek = atomic_exchange(&handle->seek_frame, -1);
+        if (seek >= 0) {
+            // Show the requested frame right away, also when paused
+            anim->current_frame = seek;
+            anim->deadline_ns = s4c_now_ns();
+            s4c_animation_show(handle);
+            continue;
+        }
+        if (state == S4C_ANIMATION_PAUSED) {
+            uint64_t paused_at = s4c_now_ns();
+            pthread_cond_wait(&handle->cond, &handle->lock);
+            // Time spent paused does not count towards the frame duration
+            anim->deadline_ns += s4c_now_ns() - paused_at;
+            continue;
+        }
+        uint64_t now = s4c_now_ns();
+        if (anim->deadline_ns > now) {
+            s4c_cond_wait_until(&handle->cond, &handle->lock, anim->deadline_ns);
+            continue;
+        }
+        if (s4c_animation_finished(anim)) {
+            atomic_store(&handle->state, S4C_ANIMATION_DONE);
+            pthread_cond_broadcast(&handle->cond);
+            break;
+        }
+        s4c_animation_catch_up(anim, now);
+        s4c_animation_show(handle);
+    }
+    pthread_mutex_unlock(&handle->lock);
+    return NULL;
+}
+
+/**
+ * Allocates a S4C_Animation_Handle for an initialised animation and starts its thread.
+ * @see s4c_animation_start()
+ * @return 0 if successful, S4C_ERR_ALLOC if allocation or thread creation failed.
+ */
+static int s4c_animation_spawn(S4C_Animation_Handle** handle, const S4C_Scheduled_Animation* anim, S4C_Render_Queue* queue)
+{
+    S4C_Animation_Handle* res = s4c_mem_calloc(S4C_MEM_THREADS, 1, sizeof(S4C_Animation_Handle));
+    if (res == NULL) {
+        return S4C_ERR_ALLOC;
+    }
+    res->anim = *anim;
+    res->queue = queue;
+    pthread_mutex_init(&res->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+#if !defined(__APPLE__) && !defined(_WIN32)
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+    pthread_cond_init(&res->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    atomic_init(&res->state, S4C_ANIMATION_RUNNING);
+    atomic_init(&res->seek_frame, -1);
+    atomic_init(&res->current_frame, anim->fromFrame);
+    if (pthread_create(&res->thread, NULL, s4c_animation_worker, res) != 0) {
+        pthread_cond_destroy(&res->cond);
+        pthread_mutex_destroy(&res->lock);
+        s4c_mem_free(res);
+        return S4C_ERR_ALLOC;
+    }
+    *handle = res;
+    return 0;
+}
+
+/**
+ * Starts playing a range of sprites on a new thread, and sets the passed pointer to a handle to control it.
+ * Frames are drawn at absolute deadlines, only printing the spans changed from the previous one, and clipped to the window.
+ * The thread does not touch cursor settings nor color pairs, and the sprites array must stay valid until s4c_animation_stop().
+ * Since ncurses is not thread-safe, other threads should not draw while the animation is running.
+ * @param handle Pointer to set to the new S4C_Animation_Handle.
+ * @param sprites The sprites array.
+ * @param w The window to print into.
+ * @param fromFrame First frame of the range.
+ * @param toFrame Last frame of the range, included.
+ * @param repetitions The number of times the range will be cycled through. 0 loops until stopped.
+ * @param frametime How many mseconds each frame is displayed.
+ * @param num_frames Index of the last frame of the animation.
+ * @param frameheight Height of the frame.
+ * @param framewidth Width of the frame.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @see s4c_animation_stop()
+ * @see S4C_ERR_RANGE
+ * @see S4C_ERR_SMALL_WIN
+ * @return 0 if successful, a negative value for errors.
+ */
+int s4c_animation_start(S4C_Animation_Handle** handle, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY)
+{
+    if (handle == NULL) {
+        return S4C_ERR_RANGE;
+    }
+    S4C_Scheduled_Animation anim;
+    int check = s4c_animation_init(&anim, sprites, w, fromFrame, toFrame, repetitions, frametime, num_frames, frameheight, framewidth, startX, startY);
+    if (check != 0) {
+        return check;
+    }
+    return s4c_animation_spawn(handle, &anim, NULL);
+}
+
+/**
+ * Starts playing a range of the frames in a shared S4C_Frame_Store on a new thread, using the durations held by the store.
+ * The handle takes a reference to the store, released by s4c_animation_stop(), so many threads can play the same frames
+ * without copying them.
+ * @param handle Pointer to set to the new S4C_Animation_Handle.
+ * @param store The S4C_Frame_Store to animate.
+ * @param w The window to print into.
+ * @param fromFrame First frame of the range.
+ * @param toFrame Last frame of the range, included.
+ * @param repetitions The number of times the range will be cycled through. 0 loops until stopped.
+ * @param frametime How many mseconds each frame without a duration is displayed.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @see s4c_animation_start()
+ * @return 0 if successful, a negative value for errors.
+ */
+int s4c_animation_start_shared(S4C_Animation_Handle** handle, S4C_Frame_Store* store, WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int startX, int startY)
+{
+    return s4c_animation_start_queued(handle, NULL, store, w, fromFrame, toFrame, repetitions, frametime, startX, startY);
+}
+
+/**
+ * Starts playing a range of the frames in a shared S4C_Frame_Store on a new thread, like s4c_animation_start_shared(),
+ * but the thread submits its frames to the render thread of a S4C_Render_Queue instead of drawing them itself.
+ * Frames that can't be submitted because the queue is full are skipped.
+ * The queue must not be stopped before the handle.
+ * @param handle Pointer to set to the new S4C_Animation_Handle.
+ * @param queue The S4C_Render_Queue to submit to, or NULL to draw from the animation thread.
+ * @param store The S4C_Frame_Store to animate.
+ * @param w The window to print into.
+ * @param fromFrame First frame of the range.
+ * @param toFrame Last frame of the range, included.
+ * @param repetitions The number of times the range will be cycled through. 0 loops until stopped.
+ * @param frametime How many mseconds each frame without a duration is displayed.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @see s4c_render_queue_start()
+ * @return 0 if successful, a negative value for errors.
+ */
+int s4c_animation_start_queued(S4C_Animation_Handle** handle, S4C_Render_Queue* queue, S4C_Frame_Store* store, WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int startX, int startY)
+{
+    if (handle == NULL || store == NULL) {
+        return S4C_ERR_RANGE;
+    }
+    S4C_Scheduled_Animation anim;
+    int check = s4c_animation_init(&anim, store->sprites, w, fromFrame, toFrame, repetitions, frametime, store->frame_count - 1, store->frameheight, store->framewidth, startX, startY);
+    if (check != 0) {
+        return check;
+    }
+    anim.store = s4c_frame_store_retain(store);
+    anim.durations = store->durations;
+    check = s4c_animation_spawn(handle, &anim, queue);
+    if (check != 0) {
+        s4c_frame_store_release(store);
+    }
+    return check;
+}
+
+/**
+ * Sets the display duration of each frame of the animation of a S4C_Animation_Handle. Takes effect from the next drawn frame.
+ * The durations array must stay valid until s4c_animation_stop().
+ * @param handle The S4C_Animation_Handle to use.
+ * @param durations Display duration of each frame in mseconds, 0 for frames using frametime. NULL to always use frametime.
+ * @see s4c_frame_duration()
+ */
+void s4c_animation_set_durations(S4C_Animation_Handle* handle, const int durations[])
+{
+    if (handle == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&handle->lock);
+    handle->anim.durations = durations;
+    pthread_mutex_unlock(&handle->lock);
+}
+
+/**
+ * Moves the animation of a S4C_Animation_Handle from a state to another one, and wakes its thread.
+ * @return 1 if the animation is in the target state, S4C_ERR_RANGE if it was neither in it or in the expected one.
+ */
+static int s4c_animation_transition(S4C_Animation_Handle* handle, S4C_Animation_State from, S4C_Animation_State to)
+{
+    if (handle == NULL) {
+        return S4C_ERR_RANGE;
+    }
+    pthread_mutex_lock(&handle->lock);
+    int expected = from;
+    bool res = (atomic_compare_exchange_strong(&handle->state, &expected, to) || expected == (int) to);
+    pthread_cond_broadcast(&handle->cond);
+    pthread_mutex_unlock(&handle->lock);
+    return (res ? 1 : S4C_ERR_RANGE);
+}
+
+/**
+ * Pauses the animation of a S4C_Animation_Handle, leaving the current frame on screen.
+ * The thread is woken and sleeps until resumed, the time spent paused is not counted towards the frame duration.
+ * @param handle The S4C_Animation_Handle to pause.
+ * @see s4c_animation_resume()
+ * @return 1 if the animation is paused, S4C_ERR_RANGE if it is done or stopped.
+ */
+int s4c_animation_pause(S4C_Animation_Handle* handle)
+{
+    return s4c_animation_transition(handle, S4C_ANIMATION_RUNNING, S4C_ANIMATION_PAUSED);
+}
+
+/**
+ * Resumes the animation of a S4C_Animation_Handle paused with s4c_animation_pause().
+ * @param handle The S4C_Animation_Handle to resume.
+ * @return 1 if the animation is running, S4C_ERR_RANGE if it is done or stopped.
+ */
+int s4c_animation_resume(S4C_Animation_Handle* handle)
+{
+    return s4c_animation_transition(handle, S4C_ANIMATION_PAUSED, S4C_ANIMATION_RUNNING);
+}
+
+/**
+ * Makes the animation of a S4C_Animation_Handle show the passed frame right away, also when paused.
+ * Playback goes on from it, with the same repetitions left.
+ * @param handle The S4C_Animation_Handle to seek.
+ * @param frame_index The frame to show, in the range passed to s4c_animation_start().
+ * @return 1 if successful, S4C_ERR_RANGE if the frame is out of range or the animation is done or stopped.
+ */
+int s4c_animation_seek(S4C_Animation_Handle* handle, int frame_index)
+{
+    if (handle == NULL || frame_index < handle->anim.fromFrame || frame_index > handle->anim.toFrame) {
+        return S4C_ERR_RANGE;
+    }
+    pthread_mutex_lock(&handle->lock);
+    int state = atomic_load(&handle->state);
+    if (state == S4C_ANIMATION_RUNNING || state == S4C_ANIMATION_PAUSED) {
+        atomic_store(&handle->seek_frame, frame_index);
+        pthread_cond_broadcast(&handle->cond);
+    }
+    pthread_mutex_unlock(&handle->lock);
+    return ((state == S4C_ANIMATION_RUNNING || state == S4C_ANIMATION_PAUSED) ? 1 : S4C_ERR_RANGE);
+}
+
+/**
+ * Returns the state of the animation of a S4C_Animation_Handle, without locking.
+ * @param handle The S4C_Animation_Handle to check.
+ * @return The S4C_Animation_State, S4C_ANIMATION_STOPPED if handle is NULL.
+ */
+S4C_Animation_State s4c_animation_get_state(S4C_Animation_Handle* handle)
+{
+    if (handle == NULL) {
+        return S4C_ANIMATION_STOPPED;
+    }
+    return (S4C_Animation_State) atomic_load(&handle->state);
+}
+
+/**
+ * Returns the index of the frame on screen for a S4C_Animation_Handle, without locking.
+ * @param handle The S4C_Animation_Handle to check.
+ * @return The frame index, S4C_ERR_RANGE if handle is NULL.
+ */
+int s4c_animation_get_frame(S4C_Animation_Handle* handle)
+{
+    if (handle == NULL) {
+        return S4C_ERR_RANGE;
+    }
+    return atomic_load(&handle->current_frame);
+}
+
+/**
+ * Blocks until the animation of a S4C_Animation_Handle completes its repetitions or is stopped.
+ * Never returns for animations looping until stopped, unless another thread stops them.
+ * @param handle The S4C_Animation_Handle to wait for.
+ */
+void s4c_animation_wait(S4C_Animation_Handle* handle)
+{
+    if (handle == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&handle->lock);
+    while (atomic_load(&handle->state) < S4C_ANIMATION_DONE) {
+        pthread_cond_wait(&handle->cond, &handle->lock);
+    }
+    pthread_mutex_unlock(&handle->lock);
+}
+
+/**
+ * Stops the animation of a S4C_Animation_Handle, waits for its thread to exit and frees the handle.
+ * The thread is woken right away, so this returns within the time to draw at most one frame.
+ * The last drawn frame is left on screen.
+ * @param handle The S4C_Animation_Handle to stop. Can't be used after this call.
+ */
+void s4c_animation_stop(S4C_Animation_Handle* handle)
+{
+    if (handle == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&handle->lock);
+    atomic_store(&handle->state, S4C_ANIMATION_STOPPED);
+    pthread_cond_broadcast(&handle->cond);
+    pthread_mutex_unlock(&handle->lock);
+    pthread_join(handle->thread, NULL);
+    pthread_cond_destroy(&handle->cond);
+    pthread_mutex_destroy(&handle->lock);
+    s4c_frame_store_release(handle->anim.store);
+    s4c_mem_free(handle);
+}
+
+/**
+ * Holds a S4C_Render_Command in the ring of a S4C_Render_Queue.
+ * seq is the position the slot can be claimed at by producers, or that position plus one once the command is published.
+ */
+typedef struct S4C_Render_Slot {
+    atomic_size_t seq; /**< Sequence number of the slot.*/
+    S4C_Render_Command cmd; /**< The command.*/
+} S4C_Render_Slot;
+
+/**
+ * Holds the ring and the render thread of a S4C_Render_Queue.
+ * Producers claim positions with a compare-and-swap on head, only the render thread moves tail.
+ */
+struct S4C_Render_Queue {
+    S4C_Render_Slot* slots; /**< The ring.*/
+    size_t mask; /**< Ring capacity minus one, the capacity being a power of two.*/
+    atomic_size_t head; /**< Next position claimed by producers.*/
+    size_t tail; /**< Next position read by the render thread.*/
+    pthread_t thread; /**< The render thread.*/
+    pthread_mutex_t lock; /**< Protects sleeping waits and done.*/
+    pthread_cond_t wake; /**< Signaled to wake the render thread.*/
+    pthread_cond_t drained; /**< Broadcast when the render thread completes a batch.*/
+    atomic_bool sleeping; /**< Set while the render thread waits for commands.*/
+    atomic_bool stopping; /**< Set by s4c_render_queue_stop().*/
+    size_t done; /**< Position up to which commands were executed.*/
+    atomic_ulong submitted; /**< How many commands were accepted.*/
+    atomic_ulong executed; /**< How many commands were executed.*/
+    atomic_ulong batches; /**< How many batches were flushed.*/
+    atomic_ulong full; /**< How many commands were rejected.*/
+};
+
+/**
+ * Checks if the command at the tail of a S4C_Render_Queue was published. Only called by the render thread.
+ */
+static bool s4c_render_queue_ready(S4C_Render_Queue* queue)
+{
+    return atomic_load(&queue->slots[queue->tail & queue->mask].seq) == queue->tail + 1;
+}
+
+/**
+ * Executes a S4C_Render_Command on the render thread, and releases its store.
+ */
+static void s4c_render_execute(const S4C_Render_Command* cmd)
+{
+    switch (cmd->type) {
+    case S4C_RENDER_FRAME: {
+        char (*sprites)[S4C_MAXROWS][S4C_MAXCOLS] = (cmd->sprites != NULL ? cmd->sprites : cmd->store->sprites);
+        if (cmd->boxed) {
+            box(cmd->win,0,0);
+        }
+        s4c_print_frame_delta(cmd->win, (cmd->prev_frame >= 0 ? sprites[cmd->prev_frame] : NULL), sprites[cmd->frame_index], cmd->frameheight, cmd->framewidth, cmd->startX, cmd->startY);
+    }
+    break;
+    case S4C_RENDER_CLEAR: {
+        werase(cmd->win);
+    }
+    break;
+    case S4C_RENDER_CALL: {
+        cmd->call(cmd->win, cmd->arg);
+    }
+    break;
+    }
+    if (cmd->win != NULL) {
+        wnoutrefresh(cmd->win);
+    }
+    s4c_frame_store_release(cmd->store);
+}
+
+/**
+ * Body of the render thread of a S4C_Render_Queue: executes all published commands, flushes them with one doupdate(),
+ * then sleeps until more are submitted.
+ */
+static void* s4c_render_queue_worker(void* arg)
+{
+    S4C_Render_Queue* queue = arg;
+    for (;;) {
+        unsigned long executed = 0;
+        while (s4c_render_queue_ready(queue)) {
+            S4C_Render_Slot* slot = &queue->slots[queue->tail & queue->mask];
+            S4C_Render_Command cmd = slot->cmd;
+            // Hand the slot back to producers for the next lap of the ring
+            atomic_store_explicit(&slot->seq, queue->tail + queue->mask + 1, memory_order_release);
+            queue->tail++;
+            s4c_render_execute(&cmd);
+            executed++;
+        }
+        if (executed > 0) {
+            doupdate();
+            atomic_fetch_add(&queue->executed, executed);
+            atomic_fetch_add(&queue->batches, 1);
+        }
+        pthread_mutex_lock(&queue->lock);
+        queue->done = queue->tail;
+        pthread_cond_broadcast(&queue->drained);
+        if (executed == 0) {
+            if (atomic_load(&queue->stopping)) {
+                pthread_mutex_unlock(&queue->lock);
+                break;
+            }
+            // Producers check sleeping after publishing, so either they see it set or the ready check sees their command
+            atomic_store(&queue->sleeping, true);
+            if (!s4c_render_queue_ready(queue) && !atomic_load(&queue->stopping)) {
+                pthread_cond_wait(&queue->wake, &queue->lock);
+            }
+            atomic_store(&queue->sleeping, false);
+        }
+        pthread_mutex_unlock(&queue->lock);
+    }
+    return NULL;
+}
+
+/**
+ * Starts a render thread, and sets the passed pointer to a S4C_Render_Queue to submit commands to it.
+ * Since ncurses is not thread-safe, once the thread is started all output should go through the queue,
+ * using S4C_RENDER_CALL for anything other than frames.
+ * @param queue Pointer to set to the new S4C_Render_Queue.
+ * @param capacity How many commands can be pending, rounded up to a power of two.
+ * @see s4c_render_queue_submit()
+ * @see s4c_render_queue_stop()
+ * @return 0 if successful, S4C_ERR_RANGE if the arguments are invalid, S4C_ERR_ALLOC if allocation or thread creation failed.
+ */
+int s4c_render_queue_start(S4C_Render_Queue** queue, int capacity)
+{
+    if (queue == NULL || capacity < 1 || capacity > (INT_MAX / 2)) {
+        return S4C_ERR_RANGE;
+    }
+    size_t size = 1;
+    while (size < (size_t) capacity) {
+        size *= 2;
+    }
+    S4C_Render_Queue* res = s4c_mem_calloc(S4C_MEM_THREADS, 1, sizeof(S4C_Render_Queue));
+    if (res == NULL) {
+        return S4C_ERR_ALLOC;
+    }
+    res->slots = s4c_mem_calloc(S4C_MEM_THREADS, size, sizeof(S4C_Render_Slot));
+    if (res->slots == NULL) {
+        s4c_mem_free(res);
+        return S4C_ERR_ALLOC;
+    }
+    for (size_t i = 0; i < size; i++) {
+        atomic_init(&res->slots[i].seq, i);
+    }
+    res->mask = size - 1;
+    atomic_init(&res->head, 0);
+    atomic_init(&res->sleeping, false);
+    atomic_init(&res->stopping, false);
+    atomic_init(&res->submitted, 0);
+    atomic_init(&res->executed, 0);
+    atomic_init(&res->batches, 0);
+    atomic_init(&res->full, 0);
+    pthread_mutex_init(&res->lock, NULL);
+    pthread_cond_init(&res->wake, NULL);
+    pthread_cond_init(&res->drained, NULL);
+    if (pthread_create(&res->thread, NULL, s4c_render_queue_worker, res) != 0) {
+        pthread_cond_destroy(&res->drained);
+        pthread_cond_destroy(&res->wake);
+        pthread_mutex_destroy(&res->lock);
+        s4c_mem_free(res->slots);
+        s4c_mem_free(res);
+        return S4C_ERR_ALLOC;
+    }
+    *queue = res;
+    return 0;
+}
+
+/**
+ * Submits a copy of a S4C_Render_Command to the render thread of a S4C_Render_Queue. Never blocks, safe to call from any thread.
+ * When the command has a store, a reference to it is held until the command is executed.
+ * The sprites array of the command must stay valid until then.
+ * @param queue The S4C_Render_Queue to submit to.
+ * @param cmd The command to submit.
+ * @see S4C_ERR_QUEUE_FULL
+ * @return 0 if successful, S4C_ERR_QUEUE_FULL if the queue is full, S4C_ERR_RANGE if the command is invalid.
+ */
+int s4c_render_queue_submit(S4C_Render_Queue* queue, const S4C_Render_Command* cmd)
+{
+    if (queue == NULL || cmd == NULL) {
+        return S4C_ERR_RANGE;
+    }
+    switch (cmd->type) {
+    case S4C_RENDER_FRAME: {
+        if (cmd->win == NULL || (cmd->sprites == NULL && cmd->store == NULL) || cmd->frame_index < 0) {
+            return S4C_ERR_RANGE;
+        }
+    }
+    break;
+    case S4C_RENDER_CLEAR: {
+        if (cmd->win == NULL) {
+            return S4C_ERR_RANGE;
+        }
+    }
+    break;
+    case S4C_RENDER_CALL: {
+        if (cmd->call == NULL) {
+            return S4C_ERR_RANGE;
+        }
+    }
+    break;
+    default: {
+        return S4C_ERR_RANGE;
+    }
+    break;
+    }
+    S4C_Render_Slot* slot = NULL;
+    size_t pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    for (;;) {
+        slot = &queue->slots[pos & queue->mask];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        ptrdiff_t dif = (ptrdiff_t) (seq - pos);
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (dif < 0) {
+            // The slot still holds a command from the previous lap
+            atomic_fetch_add(&queue->full, 1);
+            return S4C_ERR_QUEUE_FULL;
+        } else {
+            pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+        }
+    }
+    slot->cmd = *cmd;
+    s4c_frame_store_retain(cmd->store);
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    atomic_fetch_add(&queue->submitted, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&queue->sleeping)) {
+        pthread_mutex_lock(&queue->lock);
+        pthread_cond_signal(&queue->wake);
+        pthread_mutex_unlock(&queue->lock);
     }
     return 0;
 }
 
 /**
- * Demoes color pairs defined in s4c to the passed window.
- * Since it uses indexes defined by default from animate.h, it should work only when your currently initialised palette has color pairs for the expected index range.
- * @param win The Window pointer to print to.
- * @param colors_per_row How many colors to print in each row.
+ * Submits a frame to the render thread of a S4C_Render_Queue, only printing the spans changed from prev_frame.
+ * @param queue The S4C_Render_Queue to submit to.
+ * @param sprites The sprites array, which must stay valid until the frame is drawn.
+ * @param w The window to print into.
+ * @param frame_index The frame to draw.
+ * @param prev_frame The frame on screen at the same coords, or -1 to draw the whole frame.
+ * @param frameheight Height of the frame.
+ * @param framewidth Width of the frame.
+ * @param startX X coord of the window to start printing to.
+ * @param startY Y coord of the window to start printing to.
+ * @see s4c_render_queue_submit()
+ * @return 0 if successful, S4C_ERR_QUEUE_FULL if the queue is full, S4C_ERR_RANGE if the arguments are invalid.
+ */
+int s4c_render_queue_submit_frame(S4C_Render_Queue* queue, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int frame_index, int prev_frame, int frameheight, int framewidth, int startX, int startY)
+{
+    S4C_Render_Command cmd = {
+        .type = S4C_RENDER_FRAME,
+        .win = w,
+        .sprites = sprites,
+        .frame_index = frame_index,
+        .prev_frame = prev_frame,
+        .frameheight = frameheight,
+        .framewidth = framewidth,
+        .startX = startX,
+        .startY = startY,
+    };
+    return s4c_render_queue_submit(queue, &cmd);
+}
+
+/**
+ * Waits until the commands submitted before the call were executed and flushed to the terminal.
+ * Must not be called from the render thread.
+ * @param queue The S4C_Render_Queue to wait on.
+ */
+void s4c_render_queue_flush(S4C_Render_Queue* queue)
+{
+    if (queue == NULL) {
+        return;
+    }
+    size_t target = atomic_load(&queue->head);
+    pthread_mutex_lock(&queue->lock);
+    while ((ptrdiff_t) (queue->done - target) < 0) {
+        pthread_cond_wait(&queue->drained, &queue->lock);
+    }
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * Reads the counters of a S4C_Render_Queue.
+ * @param queue The S4C_Render_Queue to read.
+ * @param stats Where the counters are copied. Set to zero if queue is NULL.
+ */
+void s4c_render_queue_stats(S4C_Render_Queue* queue, S4C_Render_Queue_Stats* stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    if (queue == NULL) {
+        *stats = (S4C_Render_Queue_Stats) {
+            0
+        };
+        return;
+    }
+    *stats = (S4C_Render_Queue_Stats) {
+        .submitted = atomic_load(&queue->submitted),
+        .executed = atomic_load(&queue->executed),
+        .batches = atomic_load(&queue->batches),
+        .full = atomic_load(&queue->full),
+    };
+}
+
+/**
+ * Executes the pending commands of a S4C_Render_Queue, joins its render thread and frees the queue.
+ * No other thread may submit to the queue during or after the call.
+ * @param queue The S4C_Render_Queue to stop.
+ */
+void s4c_render_queue_stop(S4C_Render_Queue* queue)
+{
+    if (queue == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&queue->lock);
+    atomic_store(&queue->stopping, true);
+    pthread_cond_signal(&queue->wake);
+    pthread_mutex_unlock(&queue->lock);
+    pthread_join(queue->thread, NULL);
+    pthread_cond_destroy(&queue->drained);
+    pthread_cond_destroy(&queue->wake);
+    pthread_mutex_destroy(&queue->lock);
+    s4c_mem_free(queue->slots);
+    s4c_mem_free(queue);
+}
+
+/**
+ * Divides rounding towards negative infinity, since camera coords can be negative.
+ */
+static inline int s4c_floor_div(int a, int b)
+{
+    return (a >= 0 ? a / b : -((-a + b - 1) / b));
+}
+
+/**
+ * Blanks and draws the tiles of a S4C_Tilemap intersecting a region of its viewport.
+ * @param map The S4C_Tilemap to draw.
+ * @param region The S4C_Rect to draw, in viewport coordinates.
+ * @return How many tiles were drawn.
  */
-void slideshow_s4c_color_pairs(WINDOW* win)
+static int s4c_tilemap_draw_region(S4C_Tilemap* map, const S4C_Rect* region)
 {
-    if (win == NULL) {
-        fprintf(stderr,"[%s]:  Passed Window was NULL.",__func__);
-        abort();
+    if (region->width <= 0 || region->height <= 0) {
+        return 0;
     }
-    int cursorCheck = curs_set(0); // We try making the cursor invisible
-
-    if (cursorCheck == ERR) {
-        //TODO
-        //Log this
-        //fprintf(stderr,"animate => Terminal does not support cursor visibility state.\n");
+    for (int y = region->y; y < region->y + region->height; y++) {
+        mvwhline(map->win, y, region->x, ' ', region->width);
+    }
+    int cell_rows = s4c_render_rows(map->tile_height);
+    int cell_cols = map->tile_width;
+    int map_x = map->camera_x + region->x;
+    int map_y = map->camera_y + region->y;
+    int first_col = s4c_floor_div(map_x, cell_cols);
+    int first_row = s4c_floor_div(map_y, cell_rows);
+    int last_col = s4c_floor_div(map_x + region->width - 1, cell_cols);
+    int last_row = s4c_floor_div(map_y + region->height - 1, cell_rows);
+    first_col = (first_col < 0 ? 0 : first_col);
+    first_row = (first_row < 0 ? 0 : first_row);
+    last_col = (last_col >= map->map_cols ? map->map_cols - 1 : last_col);
+    last_row = (last_row >= map->map_rows ? map->map_rows - 1 : last_row);
+    int drawn = 0;
+    for (int row = first_row; row <= last_row; row++) {
+        const short* ids = &map->ids[(size_t) row * map->map_cols];
+        for (int col = first_col; col <= last_col; col++) {
+            short id = ids[col];
+            if (id < 0 || id >= map->num_tiles) {
+                continue;
+            }
+            S4C_Frame_View view = s4c_frame_view(map->tiles[id], map->tile_height, map->tile_width, S4C_TRANSFORM_NONE);
+            // -1 since s4c_print_view() leaves room for a box
+            if (s4c_print_view(map->win, &view, col * cell_cols - map->camera_x - 1, row * cell_rows - map->camera_y - 1, region)) {
+                drawn++;
+            }
+        }
     }
+    return drawn;
+}
 
-    // Get window max size
+/**
+ * Draws a S4C_Tilemap to its viewport window, then refreshes it.
+ * Only tiles intersecting the viewport are drawn. If the camera moved since last draw by less than the viewport size,
+ * drawn cells are shifted with wscrl() (vertical moves) or copywin() (other moves), and only the exposed strips are drawn.
+ * Changing the render mode or the viewport size causes a full redraw.
+ * @param map The S4C_Tilemap to draw.
+ * @see S4C_ERR_RANGE
+ * @return How many tiles were drawn, or a negative value for errors.
+ */
+int s4c_tilemap_draw(S4C_Tilemap* map)
+{
+    if (map == NULL || map->ids == NULL) {
+        return S4C_ERR_RANGE;
+    }
     int win_rows, win_cols;
-    getmaxyx(win, win_rows, win_cols);
-
-    int picked = 0;
-    int quit = 0;
-    int c = -1;
-    wrefresh(win);
-    refresh();
-
-    int color_index = S4C_MIN_COLOR_INDEX;
-
-    do {
-        if (color_index >= 0) {
-            wattron(win,COLOR_PAIR(color_index));
-            for (int i=0; i<win_rows; i++) {
-                for (int j=0; j<win_cols; j++) {
-                    mvwaddch(win, i, j, ' ' | A_REVERSE);
-                }
+    getmaxyx(map->win, win_rows, win_cols);
+    int dx = map->camera_x - map->drawn_x;
+    int dy = map->camera_y - map->drawn_y;
+    bool reuse = (map->drawn && map->drawn_rows == win_rows && map->drawn_cols == win_cols && map->drawn_mode == s4c_render_mode
+                  && abs(dx) < win_cols && abs(dy) < win_rows);
+    int drawn = 0;
+    if (reuse && (dx != 0 || dy != 0)) {
+        if (dx == 0) {
+            scrollok(map->win, TRUE);
+            wscrl(map->win, dy);
+            scrollok(map->win, FALSE);
+        } else {
+            if (map->scratch == NULL) {
+                map->scratch = newwin(win_rows, win_cols, 0, 0);
             }
-            wattroff(win,COLOR_PAIR(color_index));
-            if (win_cols > S4C_MAX_COLOR_NAME_LEN+9) {
-                mvwprintw(win, 2, 1, "[%i] [%s]", color_index, s4c_color_name(color_index));
-            } else if (win_cols > 5) {
-                mvwprintw(win, 1, 1, "[%i]", color_index);
+            if (map->scratch == NULL) {
+                reuse = false;
+            } else {
+                // Window coordinates: overwrite() would match screen coordinates, and the scratch is at 0,0
+                copywin(map->win, map->scratch, 0, 0, 0, 0, win_rows - 1, win_cols - 1, FALSE);
+                copywin(map->scratch, map->win, (dy > 0 ? dy : 0), (dx > 0 ? dx : 0), (dy < 0 ? -dy : 0), (dx < 0 ? -dx : 0),
+                        win_rows - 1 - (dy > 0 ? dy : 0), win_cols - 1 - (dx > 0 ? dx : 0), FALSE);
             }
-            box(win,0,0);
-            wrefresh(win);
-            refresh();
         }
-        c = wgetch(win);
-        switch(c) {
-        case 'q': { /*Enter*/
-            quit = 1;
-
-        };
-        case 10: { /*Enter*/
-            picked = 1;
-        };
-        break;
-        case KEY_RIGHT: {
-            color_index = (color_index == S4C_MAX_COLOR_INDEX ? color_index : color_index+1);
-
-        };
-        break;
-        case KEY_LEFT: {
-            color_index = (color_index == S4C_MIN_COLOR_INDEX ? color_index : color_index-1);
-
-        };
-        break;
-        default: {
-            //fprintf(stderr,"[%s]:  Unexpected int [%i].\n",__func__,c);
+        if (reuse) {
+            // Exposed rows span the whole width, exposed columns only the rows left
+            S4C_Rect rows_strip = {0, (dy > 0 ? win_rows - dy : 0), win_cols, abs(dy)};
+            S4C_Rect cols_strip = {(dx > 0 ? win_cols - dx : 0), (dy < 0 ? -dy : 0), abs(dx), win_rows - abs(dy)};
+            drawn += s4c_tilemap_draw_region(map, &rows_strip);
+            drawn += s4c_tilemap_draw_region(map, &cols_strip);
         }
-        break;
+    }
+    if (!reuse) {
+        if (map->scratch != NULL && (map->drawn_rows != win_rows || map->drawn_cols != win_cols)) {
+            delwin(map->scratch);
+            map->scratch = NULL;
         }
-    } while(!quit && !picked);
+        S4C_Rect all = {0, 0, win_cols, win_rows};
+        drawn = s4c_tilemap_draw_region(map, &all);
+    }
+    if (reuse) {
+        // Changed tiles are redrawn where the camera shows them now, after any shift
+        int cell_rows = s4c_render_rows(map->tile_height);
+        int cell_cols = map->tile_width;
+        for (int i = 0; i < map->dirty_count; i++) {
+            int row = map->dirty[i] / map->map_cols;
+            int col = map->dirty[i] % map->map_cols;
+            S4C_Rect tile = {col * cell_cols - map->camera_x, row * cell_rows - map->camera_y, cell_cols, cell_rows};
+            int min_x = 0, min_y = 0, max_x = win_cols, max_y = win_rows;
+            s4c_intersect_bounds(&min_x, &min_y, &max_x, &max_y, &tile);
+            S4C_Rect region = {min_x, min_y, max_x - min_x, max_y - min_y};
+            drawn += s4c_tilemap_draw_region(map, &region);
+        }
+    }
+    map->dirty_count = 0;
+    map->drawn = true;
+    map->drawn_x = map->camera_x;
+    map->drawn_y = map->camera_y;
+    map->drawn_rows = win_rows;
+    map->drawn_cols = win_cols;
+    map->drawn_mode = s4c_render_mode;
+    map->tiles_drawn += drawn;
+    wrefresh(map->win);
+    return drawn;
 }
 
 /**
- * Takes a string and a int and prints it in curses sdtscr at the y value passed as line_num.
- * @param line The string to print
- * @param line_num The y value to print at in win
- * @param line_len The length of line to print
- * @param startX X coord of the win to start printing to.
+ * Returns a S4C_Target drawing to the passed WINDOW.
+ * @param win The window to draw to.
+ * @return The S4C_Target.
  */
-void s4c_print_spriteline(WINDOW* win, char* line, int curr_line_num, int line_length, int startX)
+S4C_Target s4c_target_ncurses(WINDOW* win)
 {
-    for (int i = 0; i < line_length; i++) {
-        char c = line[i];
-        int color_index = c - '0' + 8;
-        if (color_index >= 0 && color_index < S4C_MAX_COLORS) {
-            wattron(win, COLOR_PAIR(color_index));
-            mvwaddch(win, curr_line_num, startX + 1 + i, ' ' | A_REVERSE);
-            wattroff(win, COLOR_PAIR(color_index));
-        }
-
-    }
+    S4C_Target res = {0};
+    res.kind = S4C_TARGET_NCURSES;
+    res.win = win;
+    return res;
 }
 
 /**
- * Calls s4c_animate_sprites_at_coords() with 0,0 as starting coordinates.
- * Not interrupt-safe. Receiving SIGINT while actively waiting on a frame with napms() will crash the program.
- * @see s4c_animate_sprites_at_coords()
- * @param sprites The sprites array.
- * @param w The window to print into.
- * @param repetition The number of times the animation will be cycled through.
- * @param frametime How many mseconds each frame is displayed.
- * @param num_frames How many frames the animation will have.
- * @param frameheight Height of the frame.
- * @param framewidth Width of the frame.
- * @see S4C_ERR_CURSOR
+ * Defines the worst case size of an encoded cell: a full SGR sequence with both 24-bit colors, plus the half block glyph.
+ */
+#define S4C_ANSI_MAX_CELL_LEN 40
+
+/**
+ * Defines the worst case size of a cursor move sequence.
+ */
+#define S4C_ANSI_MAX_MOVE_LEN 16
+
+/**
+ * Initialises a S4C_TARGET_ANSI target, writing frames to the passed file descriptor.
+ * The output buffer is preallocated for the worst case frame, so encoding never allocates.
+ * Sprite chars are mapped to palette entries as in s4rl_draw_spriteline(), so that '1' is the first color.
+ * Does not need ncurses to be initialised.
+ * @param target The S4C_Target to initialise.
+ * @param fd The file descriptor to write to, usually STDOUT_FILENO.
+ * @param origin_x Terminal column (0-based) of the upper-left corner of the target.
+ * @param origin_y Terminal row (0-based) of the upper-left corner of the target.
+ * @param rows Height of the target, in terminal rows.
+ * @param cols Width of the target, in terminal columns.
+ * @param palette The S4C_Color array used to map sprite chars to colors.
+ * @param palette_size The size of the palette.
+ * @see S4C_ERR_RANGE
  * @see S4C_ERR_SMALL_WIN
- * @return 1 if successful, a negative value for errors.
+ * @see S4C_ERR_ALLOC
+ * @return 0 if successful, a negative value otherwise.
  */
-int s4c_animate_sprites(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int repetitions, int frametime, int num_frames, int frameheight, int framewidth)
+int s4c_target_ansi_init(S4C_Target* target, int fd, int origin_x, int origin_y, int rows, int cols, S4C_Color* palette, int palette_size)
 {
-    return s4c_animate_sprites_at_coords(sprites, w,repetitions, frametime, num_frames, frameheight, framewidth, 0, 0);
+    if (target == NULL || palette == NULL || palette_size <= 0 || palette_size > S4C_MAX_COLORS) {
+        return S4C_ERR_RANGE;
+    }
+    if (rows <= 0 || cols <= 0 || origin_x < 0 || origin_y < 0) {
+        return S4C_ERR_SMALL_WIN;
+    }
+    S4C_Target res = {0};
+    res.kind = S4C_TARGET_ANSI;
+    res.ansi.fd = fd;
+    res.ansi.origin_x = origin_x;
+    res.ansi.origin_y = origin_y;
+    res.ansi.rows = rows;
+    res.ansi.cols = cols;
+    res.ansi.palette = palette;
+    res.ansi.palette_size = palette_size;
+    res.ansi.buffer_size = (size_t) rows * ((size_t) cols * (S4C_ANSI_MAX_CELL_LEN + S4C_ANSI_MAX_MOVE_LEN)) + S4C_ANSI_MAX_MOVE_LEN;
+    res.ansi.buffer = s4c_mem_malloc(S4C_MEM_TARGETS, res.ansi.buffer_size);
+    res.ansi.shadow = s4c_mem_malloc(S4C_MEM_TARGETS, (size_t) rows * cols * sizeof(int));
+    if (res.ansi.buffer == NULL || res.ansi.shadow == NULL) {
+        s4c_mem_free(res.ansi.buffer);
+        s4c_mem_free(res.ansi.shadow);
+        return S4C_ERR_ALLOC;
+    }
+    *target = res;
+    s4c_target_invalidate(target);
+    return 0;
 }
 
 /**
- * Takes a WINDOW pointer to print into and a string for the file passed.
- * Takes a pre-initialised array of sprites, valid format output by sprites.py or sheet_converter.py.
- * Color-character map is define in s4c_print_spriteline().
- * Sets all the frames to the passed array.
- * Not interrupt-safe. Receiving SIGINT while actively waiting on a frame with napms() will crash the program.
- * @see s4c_print_spriteline()
- * @param sprites The sprites array.
- * @param w The window to print into.
- * @param repetition The number of times the animation will be cycled through.
- * @param frametime How many mseconds each frame is displayed.
- * @param num_frames How many frames the animation will have.
- * @param frameheight Height of the frame.
- * @param framewidth Width of the frame.
- * @param startY Y coord of the window to start printing to.
- * @param startY X coord of the window to start printing to.
- * @see S4C_ERR_CURSOR
+ * Initialises a S4C_TARGET_HEADLESS target, drawing to an in-memory grid of S4C_Cell.
+ * Does not need ncurses to be initialised, and never sleeps for a frametime of 0.
+ * Useful to test and benchmark drawing without a terminal.
+ * @param target The S4C_Target to initialise.
+ * @param rows Height of the grid.
+ * @param cols Width of the grid.
+ * @see s4c_target_cell_at()
+ * @see S4C_ERR_RANGE
  * @see S4C_ERR_SMALL_WIN
- * @return 1 if successful, a negative value for errors.
+ * @see S4C_ERR_ALLOC
+ * @return 0 if successful, a negative value otherwise.
  */
-int s4c_animate_sprites_at_coords(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY)
+int s4c_target_headless_init(S4C_Target* target, int rows, int cols)
 {
-    int cursorCheck = curs_set(0); // We make the cursor invisible or return early with the error
-
-    if (cursorCheck == ERR) {
-        return S4C_ERR_CURSOR; //fprintf(stderr,"animate => Terminal does not support cursor visibility state.\n");
+    if (target == NULL) {
+        return S4C_ERR_RANGE;
     }
-
-    int rows = frameheight;
-    int cols = framewidth;
-
-    // Check if window is big enough
-    int win_rows, win_cols;
-    getmaxyx(w, win_rows, win_cols);
-    if (win_rows < rows + startY || win_cols < cols + startX) {
-        return S4C_ERR_SMALL_WIN; //fprintf(stderr, "animate => Window is too small to display the sprite.\n");
+    if (rows <= 0 || cols <= 0) {
+        return S4C_ERR_SMALL_WIN;
     }
+    S4C_Target res = {0};
+    res.kind = S4C_TARGET_HEADLESS;
+    res.headless.rows = rows;
+    res.headless.cols = cols;
+    res.headless.cells = s4c_mem_calloc(S4C_MEM_TARGETS, (size_t) rows * cols, sizeof(S4C_Cell));
+    if (res.headless.cells == NULL) {
+        return S4C_ERR_ALLOC;
+    }
+    *target = res;
+    return 0;
+}
 
+/**
+ * Returns the cell at the passed coordinates of a S4C_TARGET_HEADLESS target.
+ * @param target The S4C_Target to query.
+ * @param y Row of the cell.
+ * @param x Column of the cell.
+ * @return A pointer to the cell, or NULL if the coordinates are out of the grid.
+ */
+const S4C_Cell* s4c_target_cell_at(const S4C_Target* target, int y, int x)
+{
+    if (target == NULL || target->kind != S4C_TARGET_HEADLESS) {
+        return NULL;
+    }
+    if (y < 0 || y >= target->headless.rows || x < 0 || x >= target->headless.cols) {
+        return NULL;
+    }
+    return &target->headless.cells[y * target->headless.cols + x];
+}
 
-    int current_rep = 0;
-    // Run the animation loop
-    while ( current_rep < repetitions ) {
-        for (int i=0; i<num_frames+1; i++) {
-            box(w,0,0);
-            for (int j=0; j<rows; j++) {
-                // Print current frame
-                s4c_print_spriteline(w,sprites[i][j], j+startY+1, cols, startX);
-            }
-            wrefresh(w);
-            // Refresh the screen
-            napms(frametime);
-            clear();
-        };
-        // We finished a whole cycle
-        current_rep++;
+/**
+ * Forgets what the target believes is currently on screen, so that the next frame is drawn whole.
+ * Should be called after the terminal was cleared or written to by anything else.
+ * For S4C_TARGET_HEADLESS, blanks all cells.
+ * @param target The S4C_Target to invalidate.
+ */
+void s4c_target_invalidate(S4C_Target* target)
+{
+    if (target == NULL) {
+        return;
     }
-    // We make the cursor normal again
-    curs_set(1);
+    if (target->kind == S4C_TARGET_HEADLESS) {
+        memset(target->headless.cells, 0, (size_t) target->headless.rows * target->headless.cols * sizeof(S4C_Cell));
+        return;
+    }
+    if (target->kind != S4C_TARGET_ANSI) {
+        return;
+    }
+    for (int i = 0; i < target->ansi.rows * target->ansi.cols; i++) {
+        target->ansi.shadow[i] = -1;
+    }
+    target->ansi.shadow_stale = false;
+    target->ansi.screen_epoch++;
+}
 
-    return 1;
+/**
+ * Frees the memory held by the passed S4C_Target. Does not touch the WINDOW of a S4C_TARGET_NCURSES target.
+ * @param target The S4C_Target to free.
+ */
+void s4c_target_free(S4C_Target* target)
+{
+    if (target == NULL) {
+        return;
+    }
+    if (target->kind == S4C_TARGET_ANSI) {
+        s4c_mem_free(target->ansi.buffer);
+        s4c_mem_free(target->ansi.shadow);
+        target->ansi.buffer = NULL;
+        target->ansi.shadow = NULL;
+        target->ansi.buffer_size = 0;
+        target->ansi.buffer_len = 0;
+    } else if (target->kind == S4C_TARGET_HEADLESS) {
+        s4c_mem_free(target->headless.cells);
+        target->headless.cells = NULL;
+    }
 }
 
 /**
- * Takes a void pointer, to be cast to animate_args*, containing parameters to animate a sprite in a WINDOW, using a separate thread.
- * Not interrupt-safe. Receiving SIGINT while actively waiting on a frame with napms() will crash the program.
- * @param args_ptr Pointer to be cast to animate_args*.
- * @see animate_args
+ * Appends a decimal integer in [0, 99999] to the passed buffer.
+ * @return The number of chars written.
  */
-void *s4c_animate_sprites_thread_at(void *args_ptr)
+static int s4c_ansi_put_int(char* buf, int value)
 {
+    char digits[8];
+    int len = 0;
+    do {
+        digits[len++] = '0' + (value % 10);
+        value /= 10;
+    } while (value > 0 && len < 5);
+    for (int i = 0; i < len; i++) {
+        buf[i] = digits[len - 1 - i];
+    }
+    return len;
+}
 
-    animate_args* args = (animate_args *)args_ptr;
-    WINDOW* w = args->win;
-    int frametime = args->frametime;
-    int num_frames = args->num_frames;
-    int frameheight = args->frameheight;
-    int framewidth = args->framewidth;
-    int startX = args->startX;
-    int startY = args->startY;
+/**
+ * Appends a ";2;R;G;B" 24-bit color parameter for the passed S4C_Color to the passed buffer.
+ * @return The number of chars written.
+ */
+static int s4c_ansi_put_rgb(char* buf, const S4C_Color* color)
+{
+    int len = 0;
+    buf[len++] = ';';
+    buf[len++] = '2';
+    buf[len++] = ';';
+    len += s4c_ansi_put_int(buf + len, color->red & 0xFF);
+    buf[len++] = ';';
+    len += s4c_ansi_put_int(buf + len, color->green & 0xFF);
+    buf[len++] = ';';
+    len += s4c_ansi_put_int(buf + len, color->blue & 0xFF);
+    return len;
+}
 
-    int cursorCheck = curs_set(0); // We make the cursor invisible or return early with the error
+/**
+ * Returns the palette index for the passed sprite char, or -1 if it is not in the palette.
+ */
+static inline int s4c_ansi_color_index(const S4C_Ansi_Target* t, char c)
+{
+    int color_index = s4c_char_palette_lut[(unsigned char) c];
+    return (color_index >= t->palette_size ? -1 : color_index);
+}
 
-    if (cursorCheck == ERR) {
-        //return S4C_ERR_CURSOR; //fprintf(stderr,"animate => Terminal does not support cursor visibility state.\n");
-        return NULL; // FIXME: should maybe return a meaningful constant pointer denoting the specific error?
+/**
+ * Encodes a frame into the target buffer, using current render mode.
+ * Only cells whose colors changed since the last flushed frame are encoded, and cursor moves are emitted only when the next cell is not adjacent to the previous one.
+ * Cells outside the target are skipped.
+ * @param t The S4C_Ansi_Target to encode into.
+ * @param frame The frame to encode.
+ * @param rows Height of the frame.
+ * @param cols Width of the frame.
+ * @param startX X coord of the target to start printing to.
+ * @param startY Y coord of the target to start printing to.
+ */
+static void s4c_ansi_encode_frame(S4C_Ansi_Target* t, char frame[][S4C_MAXCOLS], int rows, int cols, int startX, int startY)
+{
+    bool halfblock = (s4c_render_mode == S4C_RENDER_HALFBLOCK);
+    int term_rows = (halfblock ? (rows + 1) / 2 : rows);
+    int cursor_y = -1, cursor_x = -1;
+    int sgr_fg = -2, sgr_bg = -2;
+    char* out = t->buffer + t->buffer_len;
+
+    if (t->shadow_stale) {
+        for (int i = 0; i < t->rows * t->cols; i++) {
+            t->shadow[i] = -1;
+        }
+        t->shadow_stale = false;
     }
 
-    int rows = frameheight;
-    int cols = framewidth;
-
-    // Check if window is big enough
-    int win_rows, win_cols;
-    getmaxyx(w, win_rows, win_cols);
-    if (win_rows < rows + startY || win_cols < cols + startX) {
-        fprintf(stderr, "[%s]  animate => Window is too small to display the sprite.\n",__func__);
-        pthread_exit(NULL);
-    }
-    // Open the palette file and read the color values and names
-    FILE* palette_file;
-    palette_file = fopen("palette.gpl", "r");
-    if (palette_file == NULL) {
-        fprintf(stderr, "[%s]  Error: could not open palette file.\n",__func__);
-        pthread_exit(NULL);
+    for (int j = 0; j < term_rows; j++) {
+        int y = startY + 1 + j;
+        if (y < 0 || y >= t->rows) {
+            continue;
+        }
+        char* upper = frame[halfblock ? 2*j : j];
+        char* lower = ((halfblock && 2*j+1 < rows) ? frame[2*j+1] : NULL);
+        for (int i = 0; i < cols; i++) {
+            int x = startX + 1 + i;
+            if (x < 0 || x >= t->cols) {
+                continue;
+            }
+            int fg = s4c_ansi_color_index(t, upper[i]);
+            int bg = -1;
+            int glyph = 0;
+            if (halfblock) {
+                glyph = s4c_halfblock_cell(fg, (lower != NULL ? s4c_ansi_color_index(t, lower[i]) : -1), &fg, &bg);
+                if (glyph == 0) {
+                    continue;
+                }
+            } else if (fg < 0) {
+                continue;
+            }
+            int key = (halfblock ? ((glyph == 0x2584) << 21) | (1 << 20) | ((bg + 1) << 10) | (fg + 1) : fg + 1);
+            int* shadow = &t->shadow[y * t->cols + x];
+            if (*shadow == key) {
+                continue;
+            }
+            *shadow = key;
+            if (y != cursor_y || x != cursor_x) {
+                // Move the cursor, 1-based
+                *out++ = '\033';
+                *out++ = '[';
+                out += s4c_ansi_put_int(out, t->origin_y + y + 1);
+                *out++ = ';';
+                out += s4c_ansi_put_int(out, t->origin_x + x + 1);
+                *out++ = 'H';
+            }
+            if (halfblock) {
+                if (fg != sgr_fg || bg != sgr_bg) {
+                    *out++ = '\033';
+                    *out++ = '[';
+                    *out++ = '3';
+                    *out++ = '8';
+                    out += s4c_ansi_put_rgb(out, &t->palette[fg]);
+                    *out++ = ';';
+                    if (bg < 0) {
+                        *out++ = '4';
+                        *out++ = '9';
+                    } else {
+                        *out++ = '4';
+                        *out++ = '8';
+                        out += s4c_ansi_put_rgb(out, &t->palette[bg]);
+                    }
+                    *out++ = 'm';
+                    sgr_fg = fg;
+                    sgr_bg = bg;
+                }
+                // Both glyphs are 3 bytes long
+                memcpy(out, s4c_halfblock_glyph(glyph), sizeof(S4C_HALFBLOCK_GLYPH) - 1);
+                out += sizeof(S4C_HALFBLOCK_GLYPH) - 1;
+            } else {
+                if (sgr_bg != fg || sgr_fg != -1) {
+                    *out++ = '\033';
+                    *out++ = '[';
+                    *out++ = '4';
+                    *out++ = '8';
+                    out += s4c_ansi_put_rgb(out, &t->palette[fg]);
+                    *out++ = 'm';
+                    sgr_fg = -1;
+                    sgr_bg = fg;
+                }
+                *out++ = ' ';
+            }
+            cursor_y = y;
+            cursor_x = x + 1;
+        }
     }
+    if (sgr_fg != -2) {
+        // Reset attributes so that anything printed afterwards is not colored
+        memcpy(out, "\033[0m", 4);
+        out += 4;
+    }
+    t->buffer_len = out - t->buffer;
+}
 
-    // Initialize all the colors and close palette file
-    init_s4c_color_pairs(palette_file);
-
-    // Run the animation thread loop
-    do {
-        for (int i=0; i<num_frames+1; i++) {
-            box(w,0,0);
-            if (args->stop_thread == 1) {
-                break;
+/**
+ * Writes the encoded buffer of the passed target to its file descriptor, usually with a single write().
+ * Retries on partial writes and EINTR.
+ * @param t The S4C_Ansi_Target to flush.
+ * @return 0 if successful, -1 on write errors.
+ */
+static int s4c_ansi_flush(S4C_Ansi_Target* t)
+{
+    size_t done = 0;
+    while (done < t->buffer_len) {
+        ssize_t res = write(t->fd, t->buffer + done, t->buffer_len - done);
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
             }
-            for (int j=0; j<rows; j++) {
-                if (args->stop_thread == 1) {
-                    break;
+            t->buffer_len = 0;
+            return -1;
+        }
+        done += res;
+    }
+    t->buffer_len = 0;
+    return 0;
+}
+
+/**
+ * Takes a frame and writes it to the grid of a S4C_TARGET_HEADLESS target, using current render mode.
+ * Cells get the same color pairs and attributes s4c_print_frame() would use. Cells outside the grid are skipped.
+ * @param h The S4C_Headless_Target to draw to.
+ * @param frame The frame to draw.
+ * @param rows Height of the frame.
+ * @param cols Width of the frame.
+ * @param startX X coord of the grid to start printing to.
+ * @param startY Y coord of the grid to start printing to.
+ */
+static void s4c_headless_print_frame(S4C_Headless_Target* h, char frame[][S4C_MAXCOLS], int rows, int cols, int startX, int startY)
+{
+    bool halfblock = (s4c_render_mode == S4C_RENDER_HALFBLOCK);
+    int first_row, first_col;
+    int vis_rows = s4c_clip_span(startY + 1, s4c_render_rows(rows), 0, h->rows, &first_row);
+    int vis_cols = s4c_clip_span(startX + 1, cols, 0, h->cols, &first_col);
+    for (int j = first_row; j < first_row + vis_rows; j++) {
+        char* upper = frame[halfblock ? 2*j : j];
+        char* lower = ((halfblock && 2*j+1 < rows) ? frame[2*j+1] : NULL);
+        S4C_Cell* row = &h->cells[(startY + 1 + j) * h->cols];
+        for (int i = first_col; i < first_col + vis_cols; i++) {
+            int color_index = s4c_char_pair_lut[(unsigned char) upper[i]];
+            int bg_index = -1;
+            int glyph = 0;
+            if (halfblock) {
+                glyph = s4c_halfblock_cell(color_index, (lower != NULL ? s4c_char_pair_lut[(unsigned char) lower[i]] : -1), &color_index, &bg_index);
+                if (glyph == 0) {
+                    continue;
                 }
-                // Print current line for current frame
-                s4c_print_spriteline(w,(args->sprites)[i][j], j+startY+1, cols, startX);
+            } else if (color_index < 0) {
+                continue;
             }
-            wrefresh(w);
-            // Refresh the screen
-            napms(frametime);
-        };
-    } while ( args->stop_thread != 1);
+            S4C_Cell* cell = &row[startX + 1 + i];
+            cell->pair = color_index;
+            if (halfblock) {
+                cell->ch = glyph;
+                cell->bg = bg_index;
+                cell->attrs = A_NORMAL;
+            } else {
+                cell->ch = ' ';
+                cell->bg = 0;
+                cell->attrs = A_REVERSE;
+            }
+            h->cells_drawn++;
+        }
+    }
+    h->frames_drawn++;
+}
 
-    // We make the cursor normal again
-    curs_set(1);
+/**
+ * Checks if a frame fits in a S4C_TARGET_ANSI or S4C_TARGET_HEADLESS target, using current render mode.
+ * @return 0 if it fits, S4C_ERR_SMALL_WIN otherwise.
+ */
+static int s4c_target_check_size(const S4C_Target* target, int frameheight, int framewidth, int startX, int startY)
+{
+    int rows = (target->kind == S4C_TARGET_ANSI ? target->ansi.rows : target->headless.rows);
+    int cols = (target->kind == S4C_TARGET_ANSI ? target->ansi.cols : target->headless.cols);
+    if (rows < s4c_render_rows(frameheight) + startY || cols < framewidth + startX) {
+        return S4C_ERR_SMALL_WIN;
+    }
+    return 0;
+}
 
-    pthread_exit(NULL);
-    //FIXME
-    //Is this a bug? Do we have to return NULL here?
-#ifdef _WIN32
-    return NULL;
-#endif
+/**
+ * Draws a frame to a S4C_TARGET_ANSI or S4C_TARGET_HEADLESS target.
+ * @return 0 if successful, a negative value otherwise.
+ */
+static int s4c_target_print_frame(S4C_Target* target, char frame[][S4C_MAXCOLS], int frameheight, int framewidth, int startX, int startY)
+{
+    if (target->kind == S4C_TARGET_HEADLESS) {
+        s4c_headless_print_frame(&target->headless, frame, frameheight, framewidth, startX, startY);
+        return 0;
+    }
+    s4c_ansi_encode_frame(&target->ansi, frame, frameheight, framewidth, startX, startY);
+    if (s4c_ansi_flush(&target->ansi) != 0) {
+        return S4C_ERR_IO;
+    }
+    return 0;
 }
 
 /**
- * Takes a WINDOW pointer to print into.
- * Contrary to other of these functions, this one does not touch cursor settings.
- * Uses the passed sprites and displays a range of them in the passed window if it is big enough.
- * Color-character map is define in s4c_print_spriteline().
- * Not interrupt-safe. Receiving SIGINT while actively waiting on a frame with napms() will crash the program.
- * @see s4c_print_spriteline()
+ * Takes a S4C_Target to print into and an animation array, plus the index of requested frame to print.
+ * For S4C_TARGET_NCURSES, calls s4c_display_sprite_at_coords().
+ * For S4C_TARGET_ANSI, encodes the frame and writes it with one write() call.
+ * For S4C_TARGET_HEADLESS, writes the frame to the grid.
+ * For targets other than S4C_TARGET_NCURSES, the target must be big enough for the frame.
+ * @param target The S4C_Target to print into.
  * @param sprites The sprites array.
- * @param w The window to print into.
- * @param repetition The number of times the animation will be cycled through.
- * @param frametime How many mseconds each frame is displayed.
+ * @param sprite_index The index of requested sprite.
  * @param num_frames How many frames the animation will have.
  * @param frameheight Height of the frame.
  * @param framewidth Width of the frame.
- * @param startY Y coord of the window to start printing to.
- * @param startY X coord of the window to start printing to.
+ * @param startX X coord of the target to start printing to.
+ * @param startY Y coord of the target to start printing to.
+ * @see s4c_display_sprite_at_coords()
  * @see S4C_ERR_SMALL_WIN
+ * @see S4C_ERR_RANGE
+ * @see S4C_ERR_IO
  * @return 1 if successful, a negative value for errors.
  */
-int s4c_animate_rangeof_sprites_at_coords(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY)
+int s4c_target_display_sprite_at_coords(S4C_Target* target, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int sprite_index, int num_frames, int frameheight, int framewidth, int startX, int startY)
 {
-    //Validate requested range
-    if (fromFrame < 0 || toFrame < 0 || fromFrame > toFrame || toFrame > num_frames ) {
+    if (target == NULL) {
         return S4C_ERR_RANGE;
     }
-
-    int cursorCheck = curs_set(0); // We make the cursor invisible or return early with the error
-
-    if (cursorCheck == ERR) {
-        return S4C_ERR_CURSOR; //fprintf(stderr,"animate => Terminal does not support cursor visibility state.\n");
+    if (target->kind == S4C_TARGET_NCURSES) {
+        return s4c_display_sprite_at_coords(sprites, sprite_index, target->win, num_frames, frameheight, framewidth, startX, startY);
     }
-
-    int rows = frameheight;
-    int cols = framewidth;
-
-    // Check if window is big enough
-    int win_rows, win_cols;
-    getmaxyx(w, win_rows, win_cols);
-    if (win_rows < rows + startY || win_cols < cols + startX) {
-        return S4C_ERR_SMALL_WIN; //fprintf(stderr, "animate => Window is too small to display the sprite.\n");
+    //Validate requested range
+    if (sprite_index < 0 || sprite_index > num_frames ) {
+        return S4C_ERR_RANGE;
     }
-
-
-    int current_rep = 0;
-    // Run the animation loop
-    while ( current_rep < repetitions ) {
-        //+1 to include toFrame index
-        for (int i=fromFrame; i<toFrame+1 ; i++) {
-            box(w,0,0);
-            for (int j=0; j<rows; j++) {
-                // Print current frame
-                s4c_print_spriteline(w,sprites[i][j], j+startY+1, cols, startX);
-            }
-            wrefresh(w);
-            // Refresh the screen
-            napms(frametime);
-            clear();
-        };
-        // We finished a whole cycle
-        current_rep++;
+    int res = s4c_target_check_size(target, frameheight, framewidth, startX, startY);
+    if (res != 0) {
+        return res;
     }
-
-    // We make the cursor normal again
-    curs_set(1);
-    return 1;
+    res = s4c_target_print_frame(target, sprites[sprite_index], frameheight, framewidth, startX, startY);
+    return (res != 0 ? res : 1);
 }
 
 /**
- * Takes a WINDOW pointer to print into and an animation array, plus the index of requested frame to print.
- * Contrary to other of these functions, this one does not touch cursor settings.
- * It checks if the passed WINDOW is big enough for the requested frame.
- * Color-character map is define in s4c_print_spriteline().
- * @see s4c_print_spriteline()
+ * Takes a S4C_Target to print into and an animation array, and cycles through a range of its frames.
+ * For S4C_TARGET_NCURSES, calls s4c_animate_rangeof_sprites_at_coords().
+ * For S4C_TARGET_ANSI, each frame is encoded and written with one write() call, and only changed cells are sent.
+ * For S4C_TARGET_HEADLESS, frames are written to the grid, with no sleep at all if frametime is 0.
+ * @see s4c_pacer_next_frame()
+ * @param target The S4C_Target to print into.
  * @param sprites The sprites array.
- * @param sprite_index The index of requested sprite.
- * @param w The window to print into.
+ * @param fromFrame The first frame to display.
+ * @param toFrame The last frame to display, included.
+ * @param repetitions The number of times the animation will be cycled through.
+ * @param frametime How many mseconds each frame is displayed.
  * @param num_frames How many frames the animation will have.
  * @param frameheight Height of the frame.
  * @param framewidth Width of the frame.
- * @param startY Y coord of the window to start printing to.
- * @param startY X coord of the window to start printing to.
+ * @param startX X coord of the target to start printing to.
+ * @param startY Y coord of the target to start printing to.
+ * @see s4c_animate_rangeof_sprites_at_coords()
  * @see S4C_ERR_SMALL_WIN
+ * @see S4C_ERR_RANGE
+ * @see S4C_ERR_IO
  * @return 1 if successful, a negative value for errors.
  */
-int s4c_display_sprite_at_coords_checked(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int sprite_index, WINDOW* w, int num_frames, int frameheight, int framewidth, int startX, int startY)
+int s4c_target_animate_rangeof_sprites_at_coords(S4C_Target* target, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int fromFrame, int toFrame, int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY)
 {
+    if (target == NULL) {
+        return S4C_ERR_RANGE;
+    }
+    if (target->kind == S4C_TARGET_NCURSES) {
+        return s4c_animate_rangeof_sprites_at_coords(sprites, target->win, fromFrame, toFrame, repetitions, frametime, num_frames, frameheight, framewidth, startX, startY);
+    }
     //Validate requested range
-    if (sprite_index < 0 || sprite_index > num_frames ) {
+    if (fromFrame < 0 || toFrame < 0 || fromFrame > toFrame || toFrame > num_frames ) {
         return S4C_ERR_RANGE;
     }
-
-    int rows = frameheight;
-    int cols = framewidth;
-
-    // Check if window is big enough
-    int win_rows, win_cols;
-    getmaxyx(w, win_rows, win_cols);
-    if (win_rows < rows + startY || win_cols < cols + startX) {
-        return S4C_ERR_SMALL_WIN; //fprintf(stderr, "animate => Window is too small to display the sprite.\n");
+    int res = s4c_target_check_size(target, frameheight, framewidth, startX, startY);
+    if (res != 0) {
+        return res;
     }
-    for (int j=0; j<rows; j++) {
-        // Print current frame
-        s4c_print_spriteline(w,sprites[sprite_index][j], j+startY+1, cols, startX);
+    S4C_Pacer pacer;
+    s4c_pacer_start(&pacer);
+    for (int current_rep = 0; current_rep < repetitions; current_rep++) {
+        //+1 to include toFrame index
+        for (int i=fromFrame; i<toFrame+1; ) {
+            res = s4c_target_print_frame(target, sprites[i], frameheight, framewidth, startX, startY);
+            if (res != 0) {
+                return res;
+            }
+            i = (frametime > 0 ? s4c_pacer_next_frame(&pacer, NULL, i, toFrame, frametime) : i + 1);
+        }
     }
-    box(w,0,0);
-    wrefresh(w);
     return 1;
 }
 
 /**
- * Takes a WINDOW pointer to print into and an animation array, plus the index of requested frame to print.
- * Contrary to other of these functions, this one does not touch cursor settings.
- * It does not check if the passed WINDOW is big enough for the requested frame.
- * Color-character map is define in s4c_print_spriteline().
- * @see s4c_print_spriteline()
+ * Takes a S4C_Target to print into and an animation array, and cycles through all of its frames.
+ * For S4C_TARGET_NCURSES, calls s4c_animate_sprites_at_coords().
+ * For other targets, calls s4c_target_animate_rangeof_sprites_at_coords() on the whole animation.
+ * @see s4c_pacer_next_frame()
+ * @param target The S4C_Target to print into.
  * @param sprites The sprites array.
- * @param sprite_index The index of requested sprite.
- * @param w The window to print into.
+ * @param repetitions The number of times the animation will be cycled through.
+ * @param frametime How many mseconds each frame is displayed.
  * @param num_frames How many frames the animation will have.
  * @param frameheight Height of the frame.
  * @param framewidth Width of the frame.
- * @param startY Y coord of the window to start printing to.
- * @param startY X coord of the window to start printing to.
+ * @param startX X coord of the target to start printing to.
+ * @param startY Y coord of the target to start printing to.
+ * @see s4c_animate_sprites_at_coords()
+ * @see S4C_ERR_SMALL_WIN
+ * @see S4C_ERR_IO
  * @return 1 if successful, a negative value for errors.
  */
-int s4c_display_sprite_at_coords_unchecked(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int sprite_index, WINDOW* w, int num_frames, int frameheight, int framewidth, int startX, int startY)
+int s4c_target_animate_sprites_at_coords(S4C_Target* target, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY)
 {
-    //Validate requested range
-    if (sprite_index < 0 || sprite_index > num_frames ) {
+    if (target == NULL) {
         return S4C_ERR_RANGE;
     }
+    if (target->kind == S4C_TARGET_NCURSES) {
+        return s4c_animate_sprites_at_coords(sprites, target->win, repetitions, frametime, num_frames, frameheight, framewidth, startX, startY);
+    }
+    return s4c_target_animate_rangeof_sprites_at_coords(target, sprites, 0, num_frames, repetitions, frametime, num_frames, frameheight, framewidth, startX, startY);
+}
 
-    for (int j=0; j<frameheight; j++) {
-        // Print current frame
-        s4c_print_spriteline(w,sprites[sprite_index][j], j+startY+1, framewidth, startX);
+/**
+ * Resizes a S4C_TARGET_ANSI target, reallocating its buffers.
+ * Invalidates the target and any S4C_Blob_Cache using it.
+ * Should be called when the terminal is resized.
+ * @param target The S4C_Target to resize.
+ * @param rows New height of the target, in terminal rows.
+ * @param cols New width of the target, in terminal columns.
+ * @see S4C_ERR_RANGE
+ * @see S4C_ERR_SMALL_WIN
+ * @see S4C_ERR_ALLOC
+ * @return 0 if successful, a negative value otherwise.
+ */
+int s4c_target_ansi_resize(S4C_Target* target, int rows, int cols)
+{
+    if (target == NULL || target->kind != S4C_TARGET_ANSI) {
+        return S4C_ERR_RANGE;
+    }
+    if (rows <= 0 || cols <= 0) {
+        return S4C_ERR_SMALL_WIN;
+    }
+    size_t buffer_size = (size_t) rows * ((size_t) cols * (S4C_ANSI_MAX_CELL_LEN + S4C_ANSI_MAX_MOVE_LEN)) + S4C_ANSI_MAX_MOVE_LEN;
+    char* buffer = s4c_mem_malloc(S4C_MEM_TARGETS, buffer_size);
+    int* shadow = s4c_mem_malloc(S4C_MEM_TARGETS, (size_t) rows * cols * sizeof(int));
+    if (buffer == NULL || shadow == NULL) {
+        s4c_mem_free(buffer);
+        s4c_mem_free(shadow);
+        return S4C_ERR_ALLOC;
+    }
+    s4c_mem_free(target->ansi.buffer);
+    s4c_mem_free(target->ansi.shadow);
+    target->ansi.buffer = buffer;
+    target->ansi.buffer_size = buffer_size;
+    target->ansi.buffer_len = 0;
+    target->ansi.shadow = shadow;
+    target->ansi.rows = rows;
+    target->ansi.cols = cols;
+    target->ansi.generation++;
+    s4c_target_invalidate(target);
+    return 0;
+}
+
+/**
+ * Sets the palette of a S4C_TARGET_ANSI target.
+ * Invalidates the target and any S4C_Blob_Cache using it.
+ * Should also be called after editing the colors of the current palette in place.
+ * @param target The S4C_Target to update.
+ * @param palette The S4C_Color array used to map sprite chars to colors.
+ * @param palette_size The size of the palette.
+ * @see S4C_ERR_RANGE
+ * @return 0 if successful, a negative value otherwise.
+ */
+int s4c_target_ansi_set_palette(S4C_Target* target, S4C_Color* palette, int palette_size)
+{
+    if (target == NULL || target->kind != S4C_TARGET_ANSI || palette == NULL || palette_size <= 0 || palette_size > S4C_MAX_COLORS) {
+        return S4C_ERR_RANGE;
+    }
+    target->ansi.palette = palette;
+    target->ansi.palette_size = palette_size;
+    target->ansi.generation++;
+    s4c_target_invalidate(target);
+    return 0;
+}
+
+#ifdef _WIN32
+struct iovec {
+    void* iov_base;
+    size_t iov_len;
+};
+#endif // _WIN32
+
+/**
+ * Defines how many blobs are passed to a single writev() call.
+ */
+#define S4C_IOV_BATCH 64
+
+/**
+ * Writes all the passed buffers to the passed file descriptor, with one writev() call per S4C_IOV_BATCH buffers.
+ * Retries on partial writes and EINTR. Modifies the passed iovec array.
+ * @return 0 if successful, -1 on write errors.
+ */
+static int s4c_writev_all(int fd, struct iovec* iov, int iovcnt)
+{
+    while (iovcnt > 0) {
+        int batch = (iovcnt > S4C_IOV_BATCH ? S4C_IOV_BATCH : iovcnt);
+#ifndef _WIN32
+        ssize_t res = writev(fd, iov, batch);
+#else
+        ssize_t res = write(fd, iov->iov_base, iov->iov_len);
+#endif // _WIN32
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        // Skip the buffers written whole, then adjust the partially written one
+        while (iovcnt > 0 && (size_t) res >= iov->iov_len) {
+            res -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char*) iov->iov_base + res;
+            iov->iov_len -= res;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Initialises a S4C_Blob_Cache for an animation played at a fixed position on a S4C_TARGET_ANSI target.
+ * No blob is encoded until a frame is played.
+ * @param cache The S4C_Blob_Cache to initialise.
+ * @param target The S4C_TARGET_ANSI target to write to.
+ * @param sprites The sprites array. It is not copied, so it must outlive the cache.
+ * @param num_frames Index of the last frame of the animation.
+ * @param frameheight Height of the frames.
+ * @param framewidth Width of the frames.
+ * @param startX X coord of the target to play the animation at.
+ * @param startY Y coord of the target to play the animation at.
+ * @param max_bytes Memory budget for the encoded blobs. Frames over budget are encoded at each play. 0 means no limit.
+ * @see S4C_ERR_RANGE
+ * @see S4C_ERR_SMALL_WIN
+ * @see S4C_ERR_ALLOC
+ * @return 0 if successful, a negative value otherwise.
+ */
+int s4c_blob_cache_init(S4C_Blob_Cache* cache, S4C_Target* target, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int num_frames, int frameheight, int framewidth, int startX, int startY, size_t max_bytes)
+{
+    if (cache == NULL || target == NULL || target->kind != S4C_TARGET_ANSI || sprites == NULL || num_frames < 0) {
+        return S4C_ERR_RANGE;
+    }
+    if (target->ansi.rows < s4c_render_rows(frameheight) + startY || target->ansi.cols < framewidth + startX) {
+        return S4C_ERR_SMALL_WIN;
+    }
+    S4C_Blob_Cache res = {0};
+    res.target = target;
+    res.sprites = sprites;
+    res.num_frames = num_frames;
+    res.frameheight = frameheight;
+    res.framewidth = framewidth;
+    res.startX = startX;
+    res.startY = startY;
+    res.max_bytes = max_bytes;
+    res.render_mode = s4c_render_mode;
+    res.generation = target->ansi.generation;
+    res.screen_epoch = target->ansi.screen_epoch;
+    res.last_frame = -1;
+    res.full = s4c_mem_calloc(S4C_MEM_BLOB_CACHES, num_frames + 1, sizeof(char*));
+    res.delta = s4c_mem_calloc(S4C_MEM_BLOB_CACHES, num_frames + 1, sizeof(char*));
+    res.full_len = s4c_mem_calloc(S4C_MEM_BLOB_CACHES, num_frames + 1, sizeof(size_t));
+    res.delta_len = s4c_mem_calloc(S4C_MEM_BLOB_CACHES, num_frames + 1, sizeof(size_t));
+    if (res.full == NULL || res.delta == NULL || res.full_len == NULL || res.delta_len == NULL) {
+        s4c_mem_free(res.full);
+        s4c_mem_free(res.delta);
+        s4c_mem_free(res.full_len);
+        s4c_mem_free(res.delta_len);
+        return S4C_ERR_ALLOC;
+    }
+    res.bytes = (num_frames + 1) * (2 * sizeof(char*) + 2 * sizeof(size_t));
+    *cache = res;
+    return 0;
+}
+
+/**
+ * Frees all the encoded blobs held by the passed S4C_Blob_Cache. They will be encoded again when played.
+ * Called automatically when the target is resized or its palette changes, or the render mode changes.
+ * @param cache The S4C_Blob_Cache to invalidate.
+ */
+void s4c_blob_cache_invalidate(S4C_Blob_Cache* cache)
+{
+    if (cache == NULL || cache->full == NULL) {
+        return;
+    }
+    for (int i = 0; i <= cache->num_frames; i++) {
+        cache->bytes -= cache->full_len[i] + cache->delta_len[i];
+        s4c_mem_free(cache->full[i]);
+        s4c_mem_free(cache->delta[i]);
+        cache->full[i] = NULL;
+        cache->delta[i] = NULL;
+        cache->full_len[i] = 0;
+        cache->delta_len[i] = 0;
+    }
+    cache->last_frame = -1;
+}
+
+/**
+ * Frees the memory held by the passed S4C_Blob_Cache. Does not free the target or the sprites.
+ * @param cache The S4C_Blob_Cache to free.
+ */
+void s4c_blob_cache_free(S4C_Blob_Cache* cache)
+{
+    if (cache == NULL) {
+        return;
+    }
+    s4c_blob_cache_invalidate(cache);
+    s4c_mem_free(cache->full);
+    s4c_mem_free(cache->delta);
+    s4c_mem_free(cache->full_len);
+    s4c_mem_free(cache->delta_len);
+    cache->full = NULL;
+    cache->delta = NULL;
+    cache->full_len = NULL;
+    cache->delta_len = NULL;
+    cache->bytes = 0;
+}
+
+/**
+ * Returns how many bytes of memory are held by the passed S4C_Blob_Cache, including its tables.
+ * @param cache The S4C_Blob_Cache to query.
+ * @return The number of bytes held.
+ */
+size_t s4c_blob_cache_bytes(const S4C_Blob_Cache* cache)
+{
+    return (cache == NULL ? 0 : cache->bytes);
+}
+
+/**
+ * Prepares the blob drawing the requested frame of the passed cache, encoding it if needed.
+ * If the blob is over the cache budget, it is left encoded in the target buffer and *cached is set to false.
+ * @return 0 if successful, a negative value otherwise.
+ */
+static int s4c_blob_cache_prepare(S4C_Blob_Cache* cache, int frame_index, const char** blob, size_t* len, bool* cached)
+{
+    S4C_Ansi_Target* t = &cache->target->ansi;
+    if (frame_index < 0 || frame_index > cache->num_frames) {
+        return S4C_ERR_RANGE;
+    }
+    if (cache->generation != t->generation || cache->render_mode != s4c_render_mode) {
+        s4c_blob_cache_invalidate(cache);
+        cache->generation = t->generation;
+        cache->render_mode = s4c_render_mode;
+    }
+    if (cache->screen_epoch != t->screen_epoch) {
+        cache->last_frame = -1;
+        cache->screen_epoch = t->screen_epoch;
+    }
+    int prev_frame = (frame_index == 0 ? cache->num_frames : frame_index - 1);
+    bool use_delta = (cache->last_frame >= 0 && cache->last_frame == prev_frame);
+    char** blobs = (use_delta ? cache->delta : cache->full);
+    size_t* lens = (use_delta ? cache->delta_len : cache->full_len);
+    cache->last_frame = frame_index;
+    *cached = true;
+    if (blobs[frame_index] != NULL) {
+        *blob = blobs[frame_index];
+        *len = lens[frame_index];
+        return 0;
+    }
+    // Encode from a blank shadow, so the blob does not depend on what the target drew before
+    for (int i = 0; i < t->rows * t->cols; i++) {
+        t->shadow[i] = -1;
+    }
+    t->shadow_stale = false;
+    t->buffer_len = 0;
+    if (use_delta) {
+        s4c_ansi_encode_frame(t, cache->sprites[prev_frame], cache->frameheight, cache->framewidth, cache->startX, cache->startY);
+        t->buffer_len = 0;
+    }
+    s4c_ansi_encode_frame(t, cache->sprites[frame_index], cache->frameheight, cache->framewidth, cache->startX, cache->startY);
+    // The screen will not match the shadow after replaying blobs
+    t->shadow_stale = true;
+    size_t encoded_len = t->buffer_len;
+    char* copy = NULL;
+    if (cache->max_bytes == 0 || cache->bytes + encoded_len <= cache->max_bytes) {
+        copy = s4c_mem_malloc(S4C_MEM_BLOB_CACHES, encoded_len > 0 ? encoded_len : 1);
+    }
+    if (copy == NULL) {
+        *blob = t->buffer;
+        *len = encoded_len;
+        *cached = false;
+        return 0;
+    }
+    memcpy(copy, t->buffer, encoded_len);
+    t->buffer_len = 0;
+    blobs[frame_index] = copy;
+    lens[frame_index] = encoded_len;
+    cache->bytes += encoded_len;
+    *blob = copy;
+    *len = encoded_len;
+    return 0;
+}
+
+/**
+ * Plays one frame for each of the passed caches, writing all the blobs with as few writev() calls as possible.
+ * When the previous frame of a cache is on screen, only its delta blob is written.
+ * Once all the blobs are encoded, no per-cell work is done.
+ * @param caches The array of S4C_Blob_Cache pointers to play.
+ * @param frame_indexes The frame index to play for each cache.
+ * @param count How many caches to play.
+ * @see S4C_ERR_RANGE
+ * @see S4C_ERR_IO
+ * @return 1 if successful, a negative value for errors.
+ */
+int s4c_blob_caches_play_frames(S4C_Blob_Cache* caches[], const int frame_indexes[], int count)
+{
+    struct iovec iov[S4C_IOV_BATCH];
+    int iovcnt = 0;
+    int fd = -1;
+    for (int i = 0; i < count; i++) {
+        S4C_Blob_Cache* cache = caches[i];
+        if (cache == NULL || cache->target == NULL || cache->full == NULL) {
+            return S4C_ERR_RANGE;
+        }
+        int cache_fd = cache->target->ansi.fd;
+        if (iovcnt > 0 && (cache_fd != fd || iovcnt == S4C_IOV_BATCH)) {
+            if (s4c_writev_all(fd, iov, iovcnt) != 0) {
+                return S4C_ERR_IO;
+            }
+            iovcnt = 0;
+        }
+        fd = cache_fd;
+        const char* blob = NULL;
+        size_t len = 0;
+        bool cached = true;
+        int res = s4c_blob_cache_prepare(cache, frame_indexes[i], &blob, &len, &cached);
+        if (res < 0) {
+            return res;
+        }
+        if (!cached) {
+            // Over budget: the blob lives in the target buffer, write it right away
+            if (iovcnt > 0 && s4c_writev_all(fd, iov, iovcnt) != 0) {
+                return S4C_ERR_IO;
+            }
+            iovcnt = 0;
+            if (s4c_ansi_flush(&cache->target->ansi) != 0) {
+                return S4C_ERR_IO;
+            }
+            continue;
+        }
+        if (len > 0) {
+            iov[iovcnt].iov_base = (void*) blob;
+            iov[iovcnt].iov_len = len;
+            iovcnt++;
+        }
+    }
+    if (iovcnt > 0 && s4c_writev_all(fd, iov, iovcnt) != 0) {
+        return S4C_ERR_IO;
     }
-    box(w,0,0);
-    wrefresh(w);
     return 1;
 }
 
 /**
- * Takes a WINDOW pointer to print into and an animation array, plus the index of requested frame to print.
- * Contrary to other of these functions, this one does not touch cursor settings.
- * Depending on if S4C_UNCHECKED is defined, it may or may not check if the passed WINDOW is big enough
- * for the requested frame.
- * Color-character map is define in s4c_print_spriteline().
- * @see s4c_print_spriteline()
- * @param sprites The sprites array.
- * @param sprite_index The index of requested sprite.
- * @param w The window to print into.
- * @param num_frames How many frames the animation will have.
- * @param frameheight Height of the frame.
- * @param framewidth Width of the frame.
- * @param startY Y coord of the window to start printing to.
- * @param startY X coord of the window to start printing to.
+ * Plays one frame of the passed cache.
+ * @param cache The S4C_Blob_Cache to play.
+ * @param frame_index The index of requested frame.
+ * @see s4c_blob_caches_play_frames()
+ * @return 1 if successful, a negative value for errors.
+ */
+int s4c_blob_cache_play_frame(S4C_Blob_Cache* cache, int frame_index)
+{
+    return s4c_blob_caches_play_frames(&cache, &frame_index, 1);
+}
+
+/**
+ * Cycles through all the frames of the passed cache.
+ * After the first cycle, each frame costs a single writev() of its delta blob.
+ * @see s4c_pacer_next_frame()
+ * @param cache The S4C_Blob_Cache to play.
+ * @param repetitions The number of times the animation will be cycled through.
+ * @param frametime How many mseconds each frame is displayed.
+ * @see S4C_ERR_IO
  * @return 1 if successful, a negative value for errors.
  */
-int s4c_display_sprite_at_coords(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int sprite_index, WINDOW* w, int num_frames, int frameheight, int framewidth, int startX, int startY)
+int s4c_blob_cache_animate(S4C_Blob_Cache* cache, int repetitions, int frametime)
 {
-#ifdef S4C_UNCHECKED
-    return s4c_display_sprite_at_coords_unchecked(sprites, sprite_index, w, num_frames, frameheight, framewidth, startX, startY);
-#else
-    return s4c_display_sprite_at_coords_checked(sprites, sprite_index, w, num_frames, frameheight, framewidth, startX, startY);
-#endif // S4C_UNCHECKED
+    if (cache == NULL) {
+        return S4C_ERR_RANGE;
+    }
+    S4C_Pacer pacer;
+    s4c_pacer_start(&pacer);
+    for (int current_rep = 0; current_rep < repetitions; current_rep++) {
+        for (int i = 0; i <= cache->num_frames; ) {
+            int res = s4c_blob_cache_play_frame(cache, i);
+            if (res < 0) {
+                return res;
+            }
+            i = s4c_pacer_next_frame(&pacer, NULL, i, cache->num_frames, frametime);
+        }
+    }
+    return 1;
 }
 
 #ifdef S4C_EXPERIMENTAL
@@ -967,9 +6591,9 @@ int s4c_display_sprite_at_coords(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int s
 int s4c_display_frame(S4C_Animation* src, int frame_index, WINDOW* w, int num_frames, int frameheight, int framewidth, int startX, int startY)
 {
 
-    char*** anim = *src;
+    S4C_Animation anim = *src;
     //Validate requested range
-    if (frame_index < 0 || frame_index > num_frames ) {
+    if (frame_index < 0 || frame_index > num_frames || frame_index >= s4c_animation_arena(anim)->frames) {
         return S4C_ERR_RANGE;
     }
 
@@ -979,12 +6603,17 @@ int s4c_display_frame(S4C_Animation* src, int frame_index, WINDOW* w, int num_fr
     // Check if window is big enough
     int win_rows, win_cols;
     getmaxyx(w, win_rows, win_cols);
-    if (win_rows < rows + startY || win_cols < cols + startX) {
+    if (win_rows < s4c_render_rows(rows) + startY || win_cols < cols + startX) {
         return S4C_ERR_SMALL_WIN; //fprintf(stderr, "animate => Window is too small to display the sprite.\n");
     }
     for (int j=0; j<rows; j++) {
         // Print current frame
-        s4c_print_spriteline(w,anim[frame_index][j], j+startY+1, cols, startX);
+        if (s4c_render_mode == S4C_RENDER_HALFBLOCK) {
+            s4c_print_spriteline_halfblock(w, s4c_animation_row(anim, frame_index, j), (j+1 < rows ? s4c_animation_row(anim, frame_index, j+1) : NULL), (j/2)+startY+1, cols, startX);
+            j++;
+        } else {
+            s4c_print_spriteline(w, s4c_animation_row(anim, frame_index, j), j+startY+1, cols, startX);
+        }
     }
     box(w,0,0);
     wrefresh(w);
@@ -994,7 +6623,9 @@ int s4c_display_frame(S4C_Animation* src, int frame_index, WINDOW* w, int num_fr
 /**
  * Takes a source animation vector matrix and a dinamyc array destination to copy to.
  * Takes ints to indicate how many frames, rows per frame and cols per row to copy.
- * Allocates the needed memory for the destination.
+ * Allocates the needed memory for the destination, in a single block: see S4C_Animation_Arena.
+ * The destination can still be indexed as dest[frame][row][col].
+ * Sets the destination to NULL if the allocation fails.
  * @param frames How many frames to copy.
  * @param rows How many rows to copy.
  * @param cols How many cols to copy.
@@ -1003,55 +6634,73 @@ int s4c_display_frame(S4C_Animation* src, int frame_index, WINDOW* w, int num_fr
  */
 void s4c_copy_animation_alloc(S4C_Animation* dest, char source[][S4C_MAXROWS][S4C_MAXCOLS], int frames, int rows, int cols)
 {
-    if (rows > MAXROWS) {
+    if (rows > S4C_MAXROWS) {
         fprintf(stderr,"{s4c} Error at [%s]: rows number was bigger than S4C_MAXROWS: [%i > %i]\n",__func__,rows,S4C_MAXROWS);
         exit(EXIT_FAILURE);
     }
-    if (cols > MAXCOLS) {
+    if (cols > S4C_MAXCOLS) {
         fprintf(stderr,"{s4c} Error at [%s]: cols number was bigger than S4C_MAXCOLS: [%i > %i]\n",__func__,cols,S4C_MAXCOLS);
         exit(EXIT_FAILURE);
     }
-    *dest = malloc(frames * sizeof(char**));
+    // Header, frame pointers, row pointers, then pixels
+    size_t row_ptrs = S4C_ANIMATION_ARENA_HEADER + frames * sizeof(char**);
+    size_t pixels = row_ptrs + (size_t) frames * rows * sizeof(char*);
+    char* block = s4c_mem_malloc(S4C_MEM_ANIMATIONS, pixels + (size_t) frames * rows * cols);
+    if (block == NULL) {
+        fprintf(stderr,"{s4c} Error at [%s]: failed allocating animation\n",__func__);
+        *dest = NULL;
+        return;
+    }
+    S4C_Animation_Arena* arena = (S4C_Animation_Arena*) block;
+    *arena = (S4C_Animation_Arena) {
+        .frames = frames,
+        .rows = rows,
+        .cols = cols,
+        .data = block + pixels,
+    };
+    S4C_Animation anim = (S4C_Animation) (block + S4C_ANIMATION_ARENA_HEADER);
+    char** rowp = (char**) (block + row_ptrs);
     for (int i = 0; i < frames; i++) {
-        (*dest)[i] = malloc(rows * sizeof(char*));
+        anim[i] = rowp + (size_t) i * rows;
         for (int j = 0; j < rows; j++) {
-            (*dest)[i][j] = malloc(cols * sizeof(char));
-            for (int k = 0; k < cols; k++) {
-                (*dest)[i][j][k] = source[i][j][k];
-            }
+            anim[i][j] = s4c_animation_row(anim, i, j);
+            memcpy(anim[i][j], source[i][j], cols);
         }
     }
+    *dest = anim;
 }
 
 /**
- * Takes an S4C_Animation pointer and frees it.
- * Takes ints to indicate how many frames, rows per frame to free.
+ * Takes an S4C_Animation pointer allocated by s4c_copy_animation_alloc() and frees it, with a single free through s4c_animate_inner_free.
  * @param animation The S4C_Animation pointer to free.
- * @param frames How many frames to free.
- * @param rows How many rows to free.
+ * @param frames Unused, since the whole animation is one allocation. Kept for compatibility.
+ * @param rows Unused, since the whole animation is one allocation. Kept for compatibility.
  */
 void s4c_free_animation(S4C_Animation* animation, int frames, int rows)
 {
+    (void) frames;
+    (void) rows;
     if (animation == NULL || *animation == NULL) {
         return; // Nothing to free if the pointer or animation is NULL
     }
 
-    char*** anim = *animation;
-
-    for (int i = 0; i < frames; i++) {
-        for (int j = 0; j < rows; j++) {
-            free(anim[i][j]);
-        }
-        free(anim[i]);
-    }
-
-    free(anim);
+    s4c_mem_free(s4c_animation_arena(*animation));
     *animation = NULL; // Set the pointer to NULL after freeing the memory
 }
 
 #endif //S4C_EXPERIMENTAL
 #endif
 
+/**
+ * Checks if a token split from a sprites file line by strtok() on '"' is a sprite row.
+ * @param token The token to check.
+ * @return True if the token is a sprite row.
+ */
+static bool s4c_is_sprite_token(const char* token)
+{
+    return (token[0] != ',' && token[0] != '{' && token[0] != '}' && token[0] != '\t' && token[0] != '\n' && token[0] != '\"' && (token[0] != '}' && token[1] != ',' ));
+}
+
 /**
  * Takes an empty 3D char array (frame, height, width) and a file to read the sprites from.
  * Checks if the file version is compatible with the current reader version, otherwise returns a negative error value.
@@ -1066,15 +6715,66 @@ void s4c_free_animation(S4C_Animation* animation, int frames, int rows)
  * @see S4C_ERR_FILEVERSION
  * @see S4C_ERR_LOADSPRITES
  * @see S4C_FILEFORMAT_VERSION
+ * @see s4c_load_sprites_timed()
  * @return A negative error value if loading fails or the number of sprites read.
  */
 int s4c_load_sprites(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], FILE* f, int frames, int rows, int columns)
+{
+    return s4c_load_sprites_timed(sprites, NULL, f, frames, rows, columns);
+}
+
+/**
+ * Returns the frame duration declared by a sprites file comment line, ending with "@" and a number of mseconds.
+ * For example, "//Frame 3 @120ms" declares 120 mseconds for frame 3. The "ms" suffix is optional.
+ * @param comment The comment line.
+ * @return The declared duration, or 0 if there is none.
+ */
+static int s4c_comment_duration(const char* comment)
+{
+    const char* at = strrchr(comment, '@');
+    if (at == NULL || !isdigit((unsigned char) at[1])) {
+        return 0;
+    }
+    char* end;
+    long ms = strtol(at + 1, &end, 10);
+    if (strncmp(end, "ms", 2) == 0) {
+        end += 2;
+    }
+    if (end[strspn(end, " \t\r\n")] != '\0' || ms > INT_MAX) {
+        return 0;
+    }
+    return (int) ms;
+}
+
+/**
+ * Takes an empty 3D char array (frame, height, width), an array for frame durations and a file to read the sprites from.
+ * Works as s4c_load_sprites(), also reading the duration each frame declares in the comment line before it, like "//Frame 3 @120".
+ * Durations are ignored by s4c_load_sprites(), so files declaring them keep S4C_FILEFORMAT_VERSION.
+ * Closes file pointer before returning, also on errors.
+ * @param sprites The char array to fill with all the frames.
+ * @param durations The array to fill with the duration of each frame in mseconds, 0 for frames not declaring one. Must have room for frames entries. Can be NULL.
+ * @param f The file to read the sprites from.
+ * @param frames The number of frames to load.
+ * @param rows The number of rows in each sprite.
+ * @param columns The number of columns in each sprite.
+ * @see s4c_frame_duration()
+ * @see s4c_animate_rangeof_sprites_timed_at_coords()
+ * @see S4C_ERR_FILEVERSION
+ * @see S4C_ERR_LOADSPRITES
+ * @return A negative error value if loading fails or the number of sprites read.
+ */
+int s4c_load_sprites_timed(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int durations[], FILE* f, int frames, int rows, int columns)
 {
 
     if (frames == 0) {
+        fclose(f);
         return 0;
     }
 
+    if (durations != NULL && frames > 0) {
+        memset(durations, 0, frames * sizeof(int));
+    }
+
     char line[1024];
     char* file_version;
     char* token;
@@ -1090,6 +6790,7 @@ int s4c_load_sprites(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], FILE* f, int fram
 
         // Check if the file format has changed, abort and return the error
         if ((file_version == NULL) || ( (check = strcmp(file_version,READER_VERSION)) != 0) ) {
+            fclose(f);
             return S4C_ERR_FILEVERSION;
         };
     }
@@ -1106,8 +6807,12 @@ int s4c_load_sprites(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], FILE* f, int fram
             continue;
         }
 
-        // Skip comment lines
+        // Skip comment lines, reading the duration they can declare for the next frame
         if (line[strspn(line, " \t\r\n")] == '/') {
+            int duration = s4c_comment_duration(line);
+            if (durations != NULL && duration > 0 && frame >= 0 && frame < frames && row == 0) {
+                durations[frame] = duration;
+            }
             continue;
         }
 
@@ -1120,7 +6825,7 @@ int s4c_load_sprites(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], FILE* f, int fram
         // Parse the line
         token = strtok(line, "\"");
         while (token != NULL) {
-            if (token[0] != ',' && token[0] != '{' && token[0] != '}' && token[0] != '\t' && token[0] != '\n' && token[0] != '\"' && (token[0] != '}' && token[1] != ',' )) {
+            if (s4c_is_sprite_token(token)) {
                 strncpy(sprites[frame][row], token, columns);
                 sprites[frame][row][columns] = '\0'; // add null-terminator to end of string
                 row++;
@@ -1143,6 +6848,308 @@ int s4c_load_sprites(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], FILE* f, int fram
     return frame;
 }
 
+/**
+ * Calls s4c_load_sprites(), then computes dedup and delta stats on the loaded frames with s4c_sprites_diff_stats().
+ * @param sprites The char array to fill with all the frames.
+ * @param f The file to read the sprites from.
+ * @param frames The number of frames to load.
+ * @param rows The number of rows in each sprite.
+ * @param columns The number of columns in each sprite.
+ * @param stats Pointer to the S4C_Diff_Stats to set. Left untouched if loading fails.
+ * @see s4c_load_sprites()
+ * @see s4c_sprites_diff_stats()
+ * @return A negative error value if loading fails or the number of sprites read.
+ */
+int s4c_load_sprites_stats(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], FILE* f, int frames, int rows, int columns, S4C_Diff_Stats* stats)
+{
+    int res = s4c_load_sprites(sprites, f, frames, rows, columns);
+    if (res > 0 && stats != NULL) {
+        s4c_sprites_diff_stats(sprites, res - 1, rows, columns, stats);
+    }
+    return res;
+}
+
+/**
+ * Allocates a S4C_Frame_Store holding frame_count frames, with a single reference.
+ * @return The store, or NULL if the allocation failed.
+ */
+static S4C_Frame_Store* s4c_frame_store_alloc(int frame_count, int frameheight, int framewidth)
+{
+    S4C_Frame_Store* res = s4c_mem_calloc(S4C_MEM_ANIMATIONS, 1, sizeof(S4C_Frame_Store));
+    if (res == NULL) {
+        return NULL;
+    }
+    res->sprites = s4c_mem_calloc(S4C_MEM_ANIMATIONS, frame_count, sizeof(char[S4C_MAXROWS][S4C_MAXCOLS]));
+    res->durations = s4c_mem_calloc(S4C_MEM_ANIMATIONS, frame_count, sizeof(int));
+    if (res->sprites == NULL || res->durations == NULL) {
+        s4c_mem_free(res->sprites);
+        s4c_mem_free(res->durations);
+        s4c_mem_free(res);
+        return NULL;
+    }
+    res->frame_count = frame_count;
+    res->frameheight = frameheight;
+    res->framewidth = framewidth;
+    atomic_init(&res->refs, 1);
+    return res;
+}
+
+/**
+ * Takes a FILE pointer, loads the sprites and their durations in a newly allocated S4C_Frame_Store, with a single reference.
+ * Only the frames actually read are kept allocated.
+ * The file is closed, as in s4c_load_sprites().
+ * @param store Where the store is returned.
+ * @param file The FILE pointer to load the sprites from.
+ * @param frames The maximum number of frames to load.
+ * @param rows The number of rows in each frame.
+ * @param columns The number of columns in each row.
+ * @see s4c_load_sprites_timed()
+ * @see s4c_frame_store_release()
+ * @return The number of frames loaded, S4C_ERR_RANGE if the arguments are invalid, S4C_ERR_ALLOC if allocation failed, or the error returned by s4c_load_sprites_timed().
+ */
+int s4c_frame_store_load(S4C_Frame_Store** store, FILE* file, int frames, int rows, int columns)
+{
+    if (store == NULL || file == NULL || frames < 1 || frames > S4C_MAXFRAMES || rows < 1 || rows > S4C_MAXROWS || columns < 1 || columns >= S4C_MAXCOLS) {
+        if (file != NULL) {
+            fclose(file);
+        }
+        return S4C_ERR_RANGE;
+    }
+    S4C_Frame_Store* res = s4c_frame_store_alloc(frames, rows, columns);
+    if (res == NULL) {
+        fclose(file);
+        return S4C_ERR_ALLOC;
+    }
+    int loaded = s4c_load_sprites_timed(res->sprites, res->durations, file, frames, rows, columns);
+    if (loaded < 0) {
+        s4c_frame_store_release(res);
+        return loaded;
+    }
+    if (loaded < frames) {
+        char (*sprites)[S4C_MAXROWS][S4C_MAXCOLS] = s4c_mem_realloc(S4C_MEM_ANIMATIONS, res->sprites, loaded * sizeof(char[S4C_MAXROWS][S4C_MAXCOLS]));
+        if (sprites != NULL) {
+            res->sprites = sprites;
+        }
+        int* durations = s4c_mem_realloc(S4C_MEM_ANIMATIONS, res->durations, loaded * sizeof(int));
+        if (durations != NULL) {
+            res->durations = durations;
+        }
+    }
+    res->frame_count = loaded;
+    *store = res;
+    return loaded;
+}
+
+/**
+ * Copies frame_count frames, and their durations if not NULL, in a newly allocated S4C_Frame_Store, with a single reference.
+ * @param store Where the store is returned.
+ * @param sprites The frames to copy.
+ * @param durations How many mseconds each frame is displayed, or NULL.
+ * @param frame_count How many frames to copy.
+ * @param frameheight Height of the frames.
+ * @param framewidth Width of the frames.
+ * @see s4c_frame_store_release()
+ * @return 0 if successful, S4C_ERR_RANGE if the arguments are invalid, S4C_ERR_ALLOC if allocation failed.
+ */
+int s4c_frame_store_from_sprites(S4C_Frame_Store** store, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], const int durations[], int frame_count, int frameheight, int framewidth)
+{
+    if (store == NULL || sprites == NULL || frame_count < 1 || frame_count > S4C_MAXFRAMES) {
+        return S4C_ERR_RANGE;
+    }
+    S4C_Frame_Store* res = s4c_frame_store_alloc(frame_count, frameheight, framewidth);
+    if (res == NULL) {
+        return S4C_ERR_ALLOC;
+    }
+    memcpy(res->sprites, sprites, frame_count * sizeof(char[S4C_MAXROWS][S4C_MAXCOLS]));
+    if (durations != NULL) {
+        memcpy(res->durations, durations, frame_count * sizeof(int));
+    }
+    *store = res;
+    return 0;
+}
+
+/**
+ * Takes a reference to the passed S4C_Frame_Store. Safe to call from any thread.
+ * @param store The store to reference.
+ * @see s4c_frame_store_release()
+ * @return The passed store.
+ */
+S4C_Frame_Store* s4c_frame_store_retain(S4C_Frame_Store* store)
+{
+    if (store != NULL) {
+        atomic_fetch_add_explicit(&store->refs, 1, memory_order_relaxed);
+    }
+    return store;
+}
+
+/**
+ * Drops a reference to the passed S4C_Frame_Store, freeing it when it was the last one. Safe to call from any thread.
+ * @param store The store to release.
+ * @see s4c_frame_store_retain()
+ */
+void s4c_frame_store_release(S4C_Frame_Store* store)
+{
+    if (store == NULL) {
+        return;
+    }
+    if (atomic_fetch_sub_explicit(&store->refs, 1, memory_order_acq_rel) == 1) {
+        s4c_mem_free(store->sprites);
+        s4c_mem_free(store->durations);
+        s4c_mem_free(store);
+    }
+}
+
+/**
+ * Returns how many bytes of memory are held by the passed S4C_Frame_Store, however many references it has.
+ * @param store The S4C_Frame_Store to query.
+ * @see s4c_mem_stats()
+ * @return The number of bytes held.
+ */
+size_t s4c_frame_store_bytes(const S4C_Frame_Store* store)
+{
+    if (store == NULL) {
+        return 0;
+    }
+    return s4c_mem_size(store) + s4c_mem_size(store->sprites) + s4c_mem_size(store->durations);
+}
+
+/**
+ * Returns a S4C_Sprite_Ref to a frame of a S4C_Frame_Store, without copying it.
+ * @param anim The S4C_Frame_Store holding the frame. No reference is taken.
+ * @param frame_index The frame to refer to.
+ * @param palette The palette to draw with.
+ * @param palette_size The size of the palette.
+ * @return The S4C_Sprite_Ref.
+ */
+S4C_Sprite_Ref s4c_sprite_ref(const S4C_Frame_Store* anim, int frame_index, S4C_Color* palette, int palette_size)
+{
+    return (S4C_Sprite_Ref) {
+        .anim = anim,
+        .frame_index = frame_index,
+        .palette_size = palette_size,
+        .palette = palette,
+    };
+}
+
+/**
+ * Returns the value of a hex digit, or -1.
+ */
+static inline int s4c_hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * Takes an empty S4C_Index_Plane and a file to read the sprites from, and decodes them once to palette indexes.
+ * Accepts files with S4C_FILEFORMAT_VERSION, where each pixel is a sprite char decoded with s4c_char_to_index(),
+ * and files with S4C_FILEFORMAT_INDEXED_VERSION, where each pixel is a two-digit hex palette index and ".." is S4C_INDEX_TRANSPARENT.
+ * Indexed files can use all palette entries up to 255, instead of the ones reachable with sprite chars.
+ * Pixels missing from a row are set to S4C_INDEX_TRANSPARENT.
+ * Frame durations declared in comment lines are read as in s4c_load_sprites_timed().
+ * Closes file pointer before returning.
+ * @param plane The S4C_Index_Plane to initialise. Its frame_count is set to the number of frames read.
+ * @param f The file to read the sprites from.
+ * @param frames The number of frames to load.
+ * @param rows The number of rows in each sprite.
+ * @param columns The number of columns in each sprite.
+ * @see s4c_index_plane_free()
+ * @see S4C_ERR_FILEVERSION
+ * @see S4C_ERR_LOADSPRITES
+ * @return A negative error value if loading fails or the number of sprites read.
+ */
+int s4c_load_index_plane(S4C_Index_Plane* plane, FILE* f, int frames, int rows, int columns)
+{
+    if (plane == NULL || f == NULL || frames <= 0 || rows <= 0 || columns <= 0) {
+        if (f != NULL) {
+            fclose(f);
+        }
+        return S4C_ERR_RANGE;
+    }
+
+    char line[4096];
+    bool indexed = false;
+    int row = 0, frame = -1;
+
+    // Read the first line of the file to get the version number
+    char* file_version = (fgets(line, sizeof(line), f) ? strtok(line, " \t\r\n") : NULL);
+    if (file_version != NULL && strcmp(file_version, S4C_FILEFORMAT_INDEXED_VERSION) == 0) {
+        indexed = true;
+    } else if (file_version == NULL || strcmp(file_version, S4C_FILEFORMAT_VERSION) != 0) {
+        fclose(f);
+        return S4C_ERR_FILEVERSION;
+    }
+
+    int res = s4c_index_plane_init(plane, frames, rows, columns);
+    if (res != 0) {
+        fclose(f);
+        return res;
+    }
+
+    while (frame < frames && fgets(line, sizeof(line), f)) {
+        size_t skip = strspn(line, " \t\r\n");
+        // Skip empty and comment lines, reading the duration comments can declare for the next frame
+        int duration = (line[skip] == '/' ? s4c_comment_duration(line) : 0);
+        if (duration > 0 && frame >= 0 && row == 0) {
+            plane->durations[frame] = duration;
+        }
+        if (line[skip] == '\0' || line[skip] == '/') {
+            continue;
+        }
+        // Skip heading line with the declaration
+        if (frame == -1 && row == 0) {
+            frame++;
+            continue;
+        }
+        for (char* token = strtok(line, "\""); token != NULL && frame < frames; token = strtok(NULL, "\"")) {
+            if (!s4c_is_sprite_token(token)) {
+                continue;
+            }
+            uint8_t* dst = s4c_index_plane_frame(plane, frame) + (size_t) row * columns;
+            size_t len = strlen(token);
+            for (int i = 0; i < columns; i++) {
+                if (!indexed) {
+                    if ((size_t) i >= len) {
+                        break;
+                    }
+                    dst[i] = s4c_char_to_index(token[i]);
+                    continue;
+                }
+                if ((size_t) 2*i+1 >= len) {
+                    break;
+                }
+                int hi = s4c_hex_value(token[2*i]);
+                int lo = s4c_hex_value(token[2*i+1]);
+                dst[i] = ((hi < 0 || lo < 0) ? S4C_INDEX_TRANSPARENT : (uint8_t) (hi * 16 + lo));
+            }
+            row++;
+            if (row == rows) {
+                frame++;
+                row = 0;
+            }
+        }
+    }
+
+    //We close the file ourselves
+    fclose(f);
+
+    //Check if we have a strictly positive frame number or return the error
+    if (!(frame > 0)) {
+        s4c_index_plane_free(plane);
+        return S4C_ERR_LOADSPRITES;
+    }
+    plane->frame_count = frame;
+    return frame;
+}
+
 /**
  * Takes a source animation vector matrix and a destination to copy to.
  * Takes ints to indicate how many frames, rows per frame and cols per row to copy.
@@ -1229,24 +7236,29 @@ Color color_from_s4c_color(S4C_Color c)
 }
 
 /**
- * Takes a string, the Y coordinate to draw at, the lenght of the line, the starting X position, the pixel size (square side), the S4C_Color palette pointer and the palette size.
- * Calls DrawRectangle() passing the converted color, by calling color_from_s4c_color().
- * @param line The string to draw.
+ * Draws a line of pixels, read with the passed step, at the passed Y coordinate.
+ * Used by s4rl_draw_spriteline() with a step of 1, and by s4rl_draw_frame_view_at_coords() with the view column stride.
+ * @param line Pointer to the first pixel to draw.
+ * @param step Offset between consecutive pixels.
+ * @param encoding The S4C_Pixel_Encoding of the pixels. Invalid chars are drawn BLACK, S4C_INDEX_TRANSPARENT is not drawn.
  * @param coordY The Y coordinate to draw at.
- * @param line_length The length of the string to draw.
+ * @param line_length How many pixels to draw.
  * @param startX The starting X position to draw at.
  * @param pixelSize The size for each pixel's square.
  * @param palette The pointer to s4c color palette/array.
  * @param palette_size The size of s4c color palette/array.
- * @see color_from_s4c_color()
  */
-void s4rl_draw_spriteline(char* line, int coordY, int line_length, int startX, int pixelSize, S4C_Color* palette, int palette_size)
+static void s4rl_draw_strided_line(const unsigned char* line, ptrdiff_t step, S4C_Pixel_Encoding encoding, int coordY, int line_length, int startX, int pixelSize, S4C_Color* palette, int palette_size)
 {
+    const short* lut = (encoding == S4C_PIXELS_INDEXES ? s4c_index_palette_lut : s4c_char_palette_lut);
     for (int i = 0; i < line_length; i++) {
-        const char c = line[i];
-        int color_index = c - '1';
+        int color_index = lut[line[i * step]];
         Color color;
-        if (color_index < 0 || color_index > palette_size) {
+        if (color_index < 0 || color_index >= palette_size) {
+            if (encoding == S4C_PIXELS_INDEXES && color_index < 0) {
+                // S4C_INDEX_TRANSPARENT
+                continue;
+            }
             fprintf(stderr,"%s():    Can't print at [x: %i, y: %i], invalid color index -> {%i}. Palette size: {%i}. Using BLACK instead.\n", __func__, (startX + i), coordY, color_index, palette_size);
             color = BLACK;
         } else {
@@ -1256,6 +7268,23 @@ void s4rl_draw_spriteline(char* line, int coordY, int line_length, int startX, i
     }
 }
 
+/**
+ * Takes a string, the Y coordinate to draw at, the lenght of the line, the starting X position, the pixel size (square side), the S4C_Color palette pointer and the palette size.
+ * Calls DrawRectangle() passing the converted color, by calling color_from_s4c_color().
+ * @param line The string to draw.
+ * @param coordY The Y coordinate to draw at.
+ * @param line_length The length of the string to draw.
+ * @param startX The starting X position to draw at.
+ * @param pixelSize The size for each pixel's square.
+ * @param palette The pointer to s4c color palette/array.
+ * @param palette_size The size of s4c color palette/array.
+ * @see color_from_s4c_color()
+ */
+void s4rl_draw_spriteline(char* line, int coordY, int line_length, int startX, int pixelSize, S4C_Color* palette, int palette_size)
+{
+    s4rl_draw_strided_line((const unsigned char*) line, 1, S4C_PIXELS_CHARS, coordY, line_length, startX, pixelSize, palette, palette_size);
+}
+
 /**
  * Takes a char matrix (maximum line size is S4C_MAXCOLS), the height of each frame, the width of each frame, the X and Y coordinates to draw at, the pixel size (square side), the S4C_Color palette pointer and the palette size.
  * Calls s4rl_draw_spriteline on each line of the passed frame.
@@ -1288,6 +7317,44 @@ void s4rl_draw_sprite_at_coords(char sprite[][S4C_MAXCOLS], int frameheight, int
     }
 }
 
+/**
+ * Takes a S4C_Frame_View, the X and Y coordinates to draw at, the pixel size (square side), the S4C_Color palette pointer and the palette size.
+ * Draws the view line by line, reading pixels through its strides, so transformed frames are drawn without copies.
+ * @param view The S4C_Frame_View to draw.
+ * @param startX The X coordinate of upper-left corner of animation rectangle.
+ * @param startY The Y coordinate of upper-left corner of animation rectangle.
+ * @param pixelSize The size for each pixel's square.
+ * @param palette The pointer to s4c color palette/array.
+ * @param palette_size The size of s4c color palette/array.
+ * @see s4c_frame_view()
+ */
+void s4rl_draw_frame_view_at_coords(const S4C_Frame_View* view, int startX, int startY, int pixelSize, S4C_Color* palette, int palette_size)
+{
+    for (int j=0; j<view->rows; j++) {
+        s4rl_draw_strided_line(view->origin + j * view->row_stride, view->col_stride, view->encoding, (j*(pixelSize)) + (startY), view->cols, startX, pixelSize, palette, palette_size);
+    }
+}
+
+/**
+ * Takes a S4C_Packed_Plane, a frame index, a S4C_Transform, the X and Y coordinates to draw at, the pixel size (square side), the S4C_Color palette pointer and the palette size.
+ * Unpacks the frame with s4c_packed_plane_view() into a scratch buffer, and draws it with s4rl_draw_frame_view_at_coords().
+ * @param packed The S4C_Packed_Plane to draw.
+ * @param frame_index Index of the frame.
+ * @param transform The S4C_Transform to apply.
+ * @param startX The X coordinate of upper-left corner of animation rectangle.
+ * @param startY The Y coordinate of upper-left corner of animation rectangle.
+ * @param pixelSize The size for each pixel's square.
+ * @param palette The pointer to s4c color palette/array.
+ * @param palette_size The size of s4c color palette/array.
+ * @see s4c_packed_plane_from_index_plane()
+ */
+void s4rl_draw_packed_frame_at_coords(const S4C_Packed_Plane* packed, int frame_index, S4C_Transform transform, int startX, int startY, int pixelSize, S4C_Color* palette, int palette_size)
+{
+    uint8_t scratch[S4C_PACKED_SCRATCH_SIZE];
+    S4C_Frame_View view = s4c_packed_plane_view(packed, frame_index, transform, scratch);
+    s4rl_draw_frame_view_at_coords(&view, startX, startY, pixelSize, palette, palette_size);
+}
+
 /**
  * Takes a char matrix (maximum line size is S4C_MAXCOLS), the Rectangle to print into, the height of each frame, the width of each frame, the pixel size (square side), the S4C_Color palette pointer and the palette size.
  * Calls s4rl_draw_sprite_at_coords() and checks if the wanted Rectangle is big enough for the wanted animation.
@@ -1353,6 +7420,23 @@ int s4rl_draw_s4c_sprite_at_rect(S4C_Sprite sprite, Rectangle rect, int pixelSiz
 {
     return s4rl_draw_sprite_at_rect(sprite.data, rect, sprite.frame_height, sprite.frame_width, pixelSize, sprite.palette, sprite.palette_size);
 }
+
+/**
+ * Draws the frame a S4C_Sprite_Ref refers to, in the passed Rectangle. Nothing is copied.
+ * @param sprite The S4C_Sprite_Ref to draw.
+ * @param rect The Rectangle to draw into.
+ * @param pixelSize Size of a pixel.
+ * @see s4rl_draw_sprite_at_rect()
+ * @return 0 if successful, S4C_ERR_RANGE for an invalid frame, S4C_ERR_SMALL_WIN if the frame does not fit.
+ */
+int s4rl_draw_sprite_ref_at_rect(S4C_Sprite_Ref sprite, Rectangle rect, int pixelSize)
+{
+    const S4C_Frame_Store* anim = sprite.anim;
+    if (anim == NULL || sprite.frame_index < 0 || sprite.frame_index >= anim->frame_count) {
+        return S4C_ERR_RANGE;
+    }
+    return s4rl_draw_sprite_at_rect(anim->sprites[sprite.frame_index], rect, anim->frameheight, anim->framewidth, pixelSize, sprite.palette, sprite.palette_size);
+}
 #endif // S4C_RAYLIB_EXTENSION
 #endif // S4C_ANIMATE_H
 
@@ -59,6 +59,24 @@ void s4c_dbg_features(void);
 #include <stdlib.h>
 #include <math.h>
 #include <locale.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifndef S4C_NO_SIMD
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define S4C_DIFF_AVX2 /**< Defined when s4c_diff_row() uses AVX2.*/
+#define S4C_UNPACK_AVX2 /**< Defined when s4c_unpack_row() uses AVX2.*/
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define S4C_DIFF_SSE2 /**< Defined when s4c_diff_row() uses SSE2.*/
+#define S4C_UNPACK_SSE2 /**< Defined when s4c_unpack_row() uses SSE2.*/
+#endif
+#endif // S4C_NO_SIMD
 
 #ifndef S4C_RAYLIB_EXTENSION
 #ifndef _WIN32
@@ -66,9 +84,46 @@ void s4c_dbg_features(void);
 #else
 #include <ncursesw/ncurses.h>
 #endif // _WIN32
-#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif // _WIN32
+#ifdef __linux__
+#include <sys/timerfd.h>
+#define S4C_HAS_TIMERFD /**< Defined when s4c_scheduler_timer_fd() is backed by a timerfd.*/
+#endif // __linux__
 #endif // S4C_RAYLIB_EXTENSION
 
+/**
+ * Function name to use in place of malloc, for the animate module.
+ * @see s4c_set_allocator()
+ */
+#ifndef S4C_ANIMATE_MALLOC
+#define S4C_ANIMATE_MALLOC malloc
+#endif // S4C_ANIMATE_MALLOC
+
+/**
+ * Function name to use in place of calloc, for the animate module.
+ */
+#ifndef S4C_ANIMATE_CALLOC
+#define S4C_ANIMATE_CALLOC calloc
+#endif // S4C_ANIMATE_CALLOC
+
+/**
+ * Function name to use in place of realloc, for the animate module.
+ */
+#ifndef S4C_ANIMATE_REALLOC
+#define S4C_ANIMATE_REALLOC realloc
+#endif // S4C_ANIMATE_REALLOC
+
+/**
+ * Function name to use in place of free, for the animate module.
+ */
+#ifndef S4C_ANIMATE_FREE
+#define S4C_ANIMATE_FREE free
+#endif // S4C_ANIMATE_FREE
+
 
 #define S4C_ANIMATE_VERSION "0.5.0"
 #define S4C_ANIMATE_MAJOR_VERSION 0
@@ -87,6 +142,12 @@ static const int S4C_ANIMATE_API_VERSION_INT =
  */
 #define S4C_FILEFORMAT_VERSION "0.2.3"
 
+/**
+ * Defines current version for indexed s4c files, where each pixel is a two-digit hex palette index.
+ * @see s4c_load_index_plane()
+ */
+#define S4C_FILEFORMAT_INDEXED_VERSION "0.3.0"
+
 void s4c_animate_printVersionToFile(FILE* f);
 void s4c_animate_echoVersionToFile(FILE* f);
 
@@ -105,11 +166,127 @@ const char *string_s4c_animate_version(void);
 
 void s4c_animate_dbg_features(void);
 
+typedef void*(s4c_animate_malloc_func)(size_t size); /**< Used to select an allocation function for the animate module.*/
+typedef void*(s4c_animate_calloc_func)(size_t count, size_t size); /**< Used to select a counted allocation function for the animate module.*/
+typedef void*(s4c_animate_realloc_func)(void* obj, size_t size); /**< Used to select a reallocation function for the animate module.*/
+typedef void(s4c_animate_free_func)(void* obj); /**< Used to select a free function for the animate module.*/
+
+extern s4c_animate_malloc_func* s4c_animate_inner_malloc;
+extern s4c_animate_calloc_func* s4c_animate_inner_calloc;
+extern s4c_animate_realloc_func* s4c_animate_inner_realloc;
+extern s4c_animate_free_func* s4c_animate_inner_free;
+
+void s4c_set_allocator(s4c_animate_malloc_func* malloc_func, s4c_animate_calloc_func* calloc_func, s4c_animate_realloc_func* realloc_func, s4c_animate_free_func* free_func);
+
+/**
+ * Bump allocator over a caller-provided buffer: allocations are aligned to max_align_t, free is a no-op and
+ * the whole arena is given back at once with s4c_arena_reset(). Safe to use from many threads.
+ * @see s4c_arena_init()
+ * @see s4c_arena_use()
+ */
+typedef struct S4C_Arena {
+    char* base; /**< Start of the buffer.*/
+    size_t size; /**< Size of the buffer.*/
+    atomic_size_t used; /**< How many bytes are taken, including headers and padding.*/
+    atomic_size_t failures; /**< How many allocations did not fit.*/
+} S4C_Arena;
+
+int s4c_arena_init(S4C_Arena* arena, void* buffer, size_t size);
+void* s4c_arena_alloc(S4C_Arena* arena, size_t size);
+void* s4c_arena_realloc(S4C_Arena* arena, void* obj, size_t size);
+void s4c_arena_reset(S4C_Arena* arena);
+void s4c_arena_use(S4C_Arena* arena);
+
+/**
+ * Fixed-size block allocator over a caller-provided buffer: requests larger than block_size fail,
+ * freed blocks go back on a free list. Safe to use from many threads.
+ * @see s4c_block_pool_init()
+ * @see s4c_block_pool_use()
+ */
+typedef struct S4C_Block_Pool {
+    char* base; /**< Start of the first block.*/
+    size_t block_size; /**< Size of each block, rounded up to max_align_t.*/
+    size_t blocks; /**< How many blocks fit in the buffer.*/
+    size_t used; /**< How many blocks are taken.*/
+    size_t failures; /**< How many allocations were refused.*/
+    void* free_list; /**< First free block, each one holding a pointer to the next.*/
+    pthread_mutex_t lock; /**< Guards the free list and counters.*/
+} S4C_Block_Pool;
+
+int s4c_block_pool_init(S4C_Block_Pool* pool, void* buffer, size_t size, size_t block_size);
+void* s4c_block_pool_alloc(S4C_Block_Pool* pool, size_t size);
+void s4c_block_pool_free(S4C_Block_Pool* pool, void* obj);
+void s4c_block_pool_destroy(S4C_Block_Pool* pool);
+void s4c_block_pool_use(S4C_Block_Pool* pool);
+
+/**
+ * Defines the kinds of memory counted by s4c_mem_stats().
+ */
+typedef enum S4C_Mem_Kind {
+    S4C_MEM_ANIMATIONS = 0, /**< Frames held by S4C_Frame_Store, S4C_Index_Plane, S4C_Packed_Plane and S4C_Animation.*/
+    S4C_MEM_BLOB_CACHES, /**< Encoded blobs and their tables, held by S4C_Blob_Cache.*/
+    S4C_MEM_PALETTES, /**< Color pairs cache built by s4c_color_pair().*/
+    S4C_MEM_TARGETS, /**< Output buffers of S4C_Target.*/
+    S4C_MEM_PLAYBACK, /**< Memory held by S4C_Scheduler, S4C_Tilemap and S4C_State_Buffer.*/
+    S4C_MEM_THREADS, /**< Memory held by S4C_Render_Queue, S4C_Pool and S4C_Animation_Handle.*/
+    S4C_MEM_KINDS, /**< How many kinds there are.*/
+} S4C_Mem_Kind;
+
+/**
+ * Holds the memory held by the animate module, as counted when allocating through s4c_animate_inner_malloc and friends.
+ * Sizes are the requested ones, allocator overhead is not counted.
+ * @see s4c_mem_stats()
+ */
+typedef struct S4C_Mem_Stats {
+    size_t bytes[S4C_MEM_KINDS]; /**< Bytes currently held, for each S4C_Mem_Kind.*/
+    size_t total; /**< Bytes currently held, in total.*/
+    size_t peak; /**< Highest total since start, or since the last s4c_mem_reset_peak().*/
+    size_t allocations; /**< How many allocations are currently held.*/
+} S4C_Mem_Stats;
+
+void s4c_mem_stats(S4C_Mem_Stats* stats);
+void s4c_mem_reset_peak(void);
+const char* s4c_mem_kind_name(S4C_Mem_Kind kind);
+void s4c_mem_stats_print(FILE* f);
+
 #define S4C_MAX_COLORS 256
 #define S4C_PALETTEFILE_MAX_COLOR_NAME_LEN 256 /**< Defines max size for the name strings in palette.gpl.*/
 
 #ifdef S4C_EXPERIMENTAL
 typedef char*** S4C_Animation;
+
+/**
+ * Holds the sizes of a S4C_Animation allocated by s4c_copy_animation_alloc().
+ * Frames, the row pointers indexing them and all pixels live in a single allocation, starting with this header:
+ * rows are cols bytes apart and frames are rows*cols bytes apart, so a row is found without chasing pointers.
+ * @see s4c_animation_row()
+ */
+typedef struct S4C_Animation_Arena {
+    int frames; /**< How many frames are held.*/
+    int rows; /**< How many rows each frame has.*/
+    int cols; /**< How many cols each row has.*/
+    char* data; /**< First pixel of the first frame.*/
+} S4C_Animation_Arena;
+
+#define S4C_ANIMATION_ARENA_HEADER ((sizeof(S4C_Animation_Arena) + sizeof(max_align_t) - 1) / sizeof(max_align_t) * sizeof(max_align_t)) /**< Defines the space taken by the S4C_Animation_Arena before the frame pointers of a S4C_Animation.*/
+
+/**
+ * Returns the S4C_Animation_Arena of a S4C_Animation allocated by s4c_copy_animation_alloc().
+ */
+static inline S4C_Animation_Arena* s4c_animation_arena(S4C_Animation anim)
+{
+    return (S4C_Animation_Arena*) ((char*) anim - S4C_ANIMATION_ARENA_HEADER);
+}
+
+/**
+ * Returns a row of a S4C_Animation allocated by s4c_copy_animation_alloc(), computed from the strides.
+ * Same as anim[frame_index][row], without reading the frame and row pointers.
+ */
+static inline char* s4c_animation_row(S4C_Animation anim, int frame_index, int row)
+{
+    S4C_Animation_Arena* arena = s4c_animation_arena(anim);
+    return arena->data + ((size_t) frame_index * arena->rows + row) * arena->cols;
+}
 #endif
 
 /*
@@ -207,6 +384,11 @@ extern const char* s4c_color_strings[S4C_MAX_COLOR_INDEX+1];
 #define	S4C_ERR_TERMCHANGECOLOR -5 /**< Defines the error value for when the terminal doesn't support changing colors.*/
 #define	S4C_ERR_CURSOR -6 /**< Defines the error value for when the terminal doesn't support changing cursor visibility.*/
 #define	S4C_ERR_RANGE -7 /**< Defines the error value for invalid range requests for animate_rangeof_sprites_at_coords().*/
+#define	S4C_ERR_COLORPAIRS -8 /**< Defines the error value for when the terminal has no free color pairs left.*/
+#define	S4C_ERR_TIMER -9 /**< Defines the error value for when a pollable timer can't be created.*/
+#define	S4C_ERR_QUEUE_FULL -10 /**< Defines the error value for when a S4C_Render_Queue has no free slots left.*/
+#define	S4C_ERR_ALLOC -11 /**< Defines the error value for when memory, a thread or a lock can't be allocated.*/
+#define	S4C_ERR_IO -12 /**< Defines the error value for when writing to a file descriptor fails.*/
 
 typedef struct S4C_Sprite {
     char data[S4C_MAXROWS][S4C_MAXCOLS];
@@ -218,10 +400,267 @@ typedef struct S4C_Sprite {
 
 S4C_Sprite s4c_new_sprite(char data[][S4C_MAXCOLS], int frameheight, int framewidth, S4C_Color* palette, int palette_size);
 
+/**
+ * Defines the transforms a S4C_Frame_View can apply to a frame.
+ * @see s4c_frame_view()
+ */
+typedef enum S4C_Transform {
+    S4C_TRANSFORM_NONE = 0, /**< Frame as stored.*/
+    S4C_TRANSFORM_FLIP_H, /**< Mirrored horizontally, so that a left-facing sprite faces right.*/
+    S4C_TRANSFORM_FLIP_V, /**< Mirrored vertically.*/
+    S4C_TRANSFORM_ROT90, /**< Rotated 90 degrees clockwise. Swaps height and width.*/
+    S4C_TRANSFORM_ROT180, /**< Rotated 180 degrees.*/
+    S4C_TRANSFORM_ROT270, /**< Rotated 90 degrees counter-clockwise. Swaps height and width.*/
+} S4C_Transform;
+
+/**
+ * Defines how the pixels of a frame are encoded.
+ * Renderers map pixels to colors through a lookup table for each encoding.
+ */
+typedef enum S4C_Pixel_Encoding {
+    S4C_PIXELS_CHARS = 0, /**< Sprite chars, where '1' is the first palette entry.*/
+    S4C_PIXELS_INDEXES, /**< Palette indexes, where 0 is the first palette entry and S4C_INDEX_TRANSPARENT is not drawn.*/
+} S4C_Pixel_Encoding;
+
+/**
+ * Defines the palette index used for pixels that are not drawn.
+ */
+#define S4C_INDEX_TRANSPARENT 255
+
+/**
+ * Holds a read-only view of a frame, addressing its pixels through an origin and two strides.
+ * Pixel at view row j, column i is origin[j*row_stride + i*col_stride].
+ * No pixel is copied: transforms only change the origin and the strides.
+ * @see s4c_frame_view()
+ * @see s4c_index_plane_view()
+ * @see s4c_frame_view_at()
+ */
+typedef struct S4C_Frame_View {
+    const unsigned char* origin; /**< Pointer to the pixel shown at view row 0, column 0.*/
+    ptrdiff_t row_stride; /**< Offset between a pixel and the one below it in the view.*/
+    ptrdiff_t col_stride; /**< Offset between a pixel and the one right of it in the view.*/
+    int rows; /**< Height of the view.*/
+    int cols; /**< Width of the view.*/
+    S4C_Pixel_Encoding encoding; /**< Encoding of the viewed pixels.*/
+} S4C_Frame_View;
+
+S4C_Frame_View s4c_frame_view(char frame[][S4C_MAXCOLS], int frameheight, int framewidth, S4C_Transform transform);
+
+/**
+ * Returns the pixel of a S4C_Frame_View at the passed view coordinates. Does no bounds check.
+ * @param view The S4C_Frame_View to read.
+ * @param row View row of the pixel.
+ * @param col View column of the pixel.
+ * @return The pixel, encoded as view->encoding.
+ */
+static inline unsigned char s4c_frame_view_at(const S4C_Frame_View* view, int row, int col)
+{
+    return view->origin[row * view->row_stride + col * view->col_stride];
+}
+
+/**
+ * Holds the frames of an animation decoded to palette indexes, in one contiguous allocation.
+ * Frames are stored one after the other, each one row-major with framewidth pixels per row.
+ * @see s4c_load_index_plane()
+ * @see s4c_index_plane_from_sprites()
+ */
+typedef struct S4C_Index_Plane {
+    uint8_t* data; /**< Palette indexes for all the frames.*/
+    int frame_count; /**< How many frames the plane has.*/
+    int frameheight; /**< Height of each frame.*/
+    int framewidth; /**< Width of each frame.*/
+    int* durations; /**< How many mseconds each frame is displayed, 0 to use the frametime passed to playback.*/
+} S4C_Index_Plane;
+
+uint8_t s4c_char_to_index(char c);
+int s4c_index_plane_init(S4C_Index_Plane* plane, int frame_count, int frameheight, int framewidth);
+int s4c_index_plane_from_sprites(S4C_Index_Plane* plane, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int frame_count, int frameheight, int framewidth);
+int s4c_load_index_plane(S4C_Index_Plane* plane, FILE* f, int frames, int rows, int columns);
+size_t s4c_index_plane_bytes(const S4C_Index_Plane* plane);
+S4C_Frame_View s4c_index_plane_view(const S4C_Index_Plane* plane, int frame_index, S4C_Transform transform);
+void s4c_index_plane_free(S4C_Index_Plane* plane);
+
+/**
+ * Returns a pointer to the first pixel of a frame in a S4C_Index_Plane. Does no bounds check.
+ * @param plane The S4C_Index_Plane to read.
+ * @param frame_index Index of the frame.
+ * @return Pointer to the first palette index of the frame.
+ */
+static inline uint8_t* s4c_index_plane_frame(const S4C_Index_Plane* plane, int frame_index)
+{
+    return plane->data + (size_t) frame_index * plane->frameheight * plane->framewidth;
+}
+
+#define S4C_PACKED_MAX_CODES 32 /**< Defines how many distinct palette indexes a S4C_Packed_Plane can hold, at 5 bits per pixel.*/
+#define S4C_PACKED_SCRATCH_SIZE (S4C_MAXROWS * S4C_MAXCOLS) /**< Defines the size of the scratch buffer for s4c_packed_plane_view().*/
+
+/**
+ * Holds the frames of an animation as 4-bit or 5-bit pixel codes, each one mapped to a palette index by indexes.
+ * Each row starts on a byte boundary, and pixel i of a row takes bits [i*bits, (i+1)*bits), least significant first.
+ * Renderers unpack rows into a scratch buffer with s4c_unpack_row(), instead of reading a byte for each pixel.
+ * @see s4c_packed_plane_from_index_plane()
+ * @see s4c_unpack_row()
+ */
+typedef struct S4C_Packed_Plane {
+    uint8_t* data; /**< Packed pixel codes for all the frames.*/
+    int bits; /**< Bits for each pixel, 4 or 5.*/
+    size_t row_bytes; /**< Bytes taken by each packed row.*/
+    int frame_count; /**< How many frames the plane has.*/
+    int frameheight; /**< Height of each frame.*/
+    int framewidth; /**< Width of each frame.*/
+    int* durations; /**< How many mseconds each frame is displayed, 0 to use the frametime passed to playback.*/
+    int num_indexes; /**< How many pixel codes are used.*/
+    uint8_t indexes[S4C_PACKED_MAX_CODES]; /**< Palette index for each pixel code, S4C_INDEX_TRANSPARENT included.*/
+} S4C_Packed_Plane;
+
+const char* s4c_unpack_kernel_name(void);
+int s4c_unpack_row(const uint8_t* packed, int bits, int count, uint8_t* out);
+int s4c_packed_plane_from_index_plane(S4C_Packed_Plane* packed, const S4C_Index_Plane* plane, int bits);
+S4C_Frame_View s4c_packed_plane_view(const S4C_Packed_Plane* packed, int frame_index, S4C_Transform transform, uint8_t* scratch);
+void s4c_packed_plane_free(S4C_Packed_Plane* packed);
+size_t s4c_packed_plane_bytes(const S4C_Packed_Plane* packed);
+
+/**
+ * Returns a pointer to the first packed byte of a row in a S4C_Packed_Plane. Does no bounds check.
+ * @param packed The S4C_Packed_Plane to read.
+ * @param frame_index Index of the frame.
+ * @param row Row of the frame.
+ * @return Pointer to the packed row, packed->row_bytes long.
+ */
+static inline const uint8_t* s4c_packed_plane_row(const S4C_Packed_Plane* packed, int frame_index, int row)
+{
+    return packed->data + ((size_t) frame_index * packed->frameheight + row) * packed->row_bytes;
+}
+
+/**
+ * Holds a span of changed pixels in a frame row.
+ * @see s4c_frame_diff()
+ */
+typedef struct S4C_Span {
+    int row; /**< Frame row of the span.*/
+    int from; /**< First changed column.*/
+    int to; /**< Column past the last changed one.*/
+} S4C_Span;
+
+/**
+ * Holds dedup and delta stats for an animation.
+ * @see s4c_sprites_diff_stats()
+ */
+typedef struct S4C_Diff_Stats {
+    int frames; /**< How many frames were compared.*/
+    int duplicate_frames; /**< How many frames are equal to an earlier frame.*/
+    int unchanged_frames; /**< How many frames are equal to the previous one.*/
+    long changed_rows; /**< How many rows changed between consecutive frames, in total.*/
+    long changed_cells; /**< How many cells are in the changed spans between consecutive frames, in total.*/
+    long total_cells; /**< How many cells are in all the frames but the first.*/
+} S4C_Diff_Stats;
+
+const char* s4c_diff_kernel_name(void);
+int s4c_diff_row(const char* a, const char* b, int len, int* from, int* to);
+int s4c_frame_diff(char prev[][S4C_MAXCOLS], char next[][S4C_MAXCOLS], int frameheight, int framewidth, S4C_Span* spans);
+void s4c_sprites_diff_stats(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int num_frames, int frameheight, int framewidth, S4C_Diff_Stats* stats);
+
+int s4c_frame_duration(const int durations[], int frame_index, int frametime);
+int s4c_sprites_collapse_holds(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int durations[], int num_frames, int frameheight, int framewidth, int frametime);
+
+/**
+ * Holds read-only frames and their durations, shared by reference between players, schedulers and animation threads.
+ * Only frame_count frames are allocated, instead of S4C_MAXFRAMES. The store is freed when its last reference is released.
+ * @see s4c_frame_store_load()
+ * @see s4c_frame_store_retain()
+ * @see s4c_frame_store_release()
+ */
+typedef struct S4C_Frame_Store {
+    char (*sprites)[S4C_MAXROWS][S4C_MAXCOLS]; /**< The frames. Must not be changed while the store is shared.*/
+    int* durations; /**< How many mseconds each frame is displayed, 0 for frames without a duration.*/
+    int frame_count; /**< How many frames are held. Playback functions take frame_count - 1 as num_frames.*/
+    int frameheight; /**< Height of the frames.*/
+    int framewidth; /**< Width of the frames.*/
+    atomic_int refs; /**< How many references are held.*/
+} S4C_Frame_Store;
+
+int s4c_frame_store_load(S4C_Frame_Store** store, FILE* file, int frames, int rows, int columns);
+int s4c_frame_store_from_sprites(S4C_Frame_Store** store, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], const int durations[], int frame_count, int frameheight, int framewidth);
+S4C_Frame_Store* s4c_frame_store_retain(S4C_Frame_Store* store);
+void s4c_frame_store_release(S4C_Frame_Store* store);
+size_t s4c_frame_store_bytes(const S4C_Frame_Store* store);
+
+/**
+ * Lightweight reference to a frame of an animation, small enough to be passed by value: drawing it copies no pixels.
+ * Unlike S4C_Sprite, it holds no pixel data, so the store and the palette must outlive it.
+ * Moving to another frame only takes setting frame_index.
+ * @see s4c_sprite_ref()
+ */
+typedef struct S4C_Sprite_Ref {
+    const S4C_Frame_Store* anim; /**< The animation, not referenced by the sprite.*/
+    int frame_index; /**< The frame drawn.*/
+    int palette_size; /**< Size of the palette.*/
+    S4C_Color* palette; /**< Palette to draw with.*/
+} S4C_Sprite_Ref;
+
+S4C_Sprite_Ref s4c_sprite_ref(const S4C_Frame_Store* anim, int frame_index, S4C_Color* palette, int palette_size);
+
+/**
+ * Opaque handle to a pool of worker threads, used to preprocess frames in parallel.
+ * Work is split in chunks spread over a deque for each worker: workers take chunks from the back of their own deque,
+ * and steal from the front of the others when it's empty.
+ * @see s4c_pool_start()
+ * @see s4c_set_pool()
+ */
+typedef struct S4C_Pool S4C_Pool;
+
+int s4c_pool_start(S4C_Pool** pool, int threads);
+int s4c_pool_threads(const S4C_Pool* pool);
+unsigned long s4c_pool_steals(S4C_Pool* pool);
+void s4c_pool_parallel_for(S4C_Pool* pool, int count, int grain, void (*fn)(void* arg, int from, int to), void* arg);
+void s4c_pool_stop(S4C_Pool* pool);
+void s4c_set_pool(S4C_Pool* pool);
+S4C_Pool* s4c_get_pool(void);
+
+/**
+ * Holds the state of an instance of a sprite, as published by a simulation thread.
+ * @see S4C_State_Buffer
+ */
+typedef struct S4C_Instance_State {
+    int frame_index; /**< Frame shown by the instance.*/
+    int x; /**< X coord of the instance.*/
+    int y; /**< Y coord of the instance.*/
+    bool visible; /**< Whether the instance is drawn.*/
+} S4C_Instance_State;
+
+#define S4C_STATE_FRESH 4 /**< Set in S4C_State_Buffer.middle when it holds a snapshot published after the last read.*/
+
+/**
+ * Triple buffer of S4C_Instance_State, passing consistent snapshots from a writer thread to a reader thread without locks.
+ * The writer fills the back buffer and swaps it with the middle one, the reader swaps the middle one with the front buffer
+ * when it's fresh. Neither side ever waits, and the reader always gets the latest complete snapshot.
+ * @see s4c_state_buffer_init()
+ * @see s4c_state_buffer_write()
+ * @see s4c_state_buffer_publish()
+ * @see s4c_state_buffer_read()
+ */
+typedef struct S4C_State_Buffer {
+    S4C_Instance_State* states; /**< The three buffers, of capacity instances each.*/
+    int capacity; /**< How many instances a buffer holds.*/
+    int counts[3]; /**< How many instances are set in each buffer.*/
+    unsigned long seqs[3]; /**< Publish count of the snapshot in each buffer.*/
+    unsigned long published; /**< How many snapshots were published. Only used by the writer.*/
+    int back; /**< Buffer filled by the writer.*/
+    atomic_int middle; /**< Buffer last published or read, with S4C_STATE_FRESH set if it was not read yet.*/
+    int front; /**< Buffer held by the reader.*/
+} S4C_State_Buffer;
+
+int s4c_state_buffer_init(S4C_State_Buffer* buf, int capacity);
+S4C_Instance_State* s4c_state_buffer_write(S4C_State_Buffer* buf);
+void s4c_state_buffer_publish(S4C_State_Buffer* buf, int count);
+const S4C_Instance_State* s4c_state_buffer_read(S4C_State_Buffer* buf, int* count, unsigned long* seq);
+void s4c_state_buffer_free(S4C_State_Buffer* buf);
+
 #ifndef S4C_RAYLIB_EXTENSION
 /*
  * Holds arguments for a call to animate_sprites_thread_at().
  * WIP.
+ * @deprecated Use s4c_animation_start(), which returns a S4C_Animation_Handle that can be paused, seeked and stopped safely.
  */
 typedef struct animate_args {
     int stop_thread; /**< Stops the thread when false.*/
@@ -241,14 +680,96 @@ void init_s4c_color_pair_ex(S4C_Color* color, int color_index, int bg_color_inde
 void init_s4c_color_pair(S4C_Color* color, int color_index);
 void init_s4c_color_pair_default_bg(S4C_Color* color, int color_index);
 
+/**
+ * Defines the ways a sprite can be drawn to a WINDOW.
+ * @see s4c_set_render_mode()
+ */
+typedef enum S4C_Render_Mode {
+    S4C_RENDER_FULLBLOCK = 0, /**< Each pixel takes a terminal cell, drawn as ' ' | A_REVERSE.*/
+    S4C_RENDER_HALFBLOCK, /**< Two pixel rows share a terminal row, drawn as U+2580 with a (fg,bg) color pair. Needs ncursesw and a UTF-8 locale.*/
+} S4C_Render_Mode;
+
+/**
+ * Defines the UTF-8 encoding of U+2580, the upper half block used by S4C_RENDER_HALFBLOCK.
+ */
+#define S4C_HALFBLOCK_GLYPH "\xe2\x96\x80"
+
+/**
+ * Defines the UTF-8 encoding of U+2584, the lower half block used by S4C_RENDER_HALFBLOCK when only the lower pixel is drawn.
+ */
+#define S4C_LOWER_HALFBLOCK_GLYPH "\xe2\x96\x84"
+
+/**
+ * Defines the lowest color pair index handed out by s4c_color_pair().
+ * The actual first index is pushed past any pair initialised with init_s4c_color_pair_ex() or init_s4c_color_pairs().
+ */
+#define S4C_PAIRS_CACHE_BASE (S4C_MAX_COLOR_INDEX + 1)
+
+void s4c_set_render_mode(S4C_Render_Mode mode);
+S4C_Render_Mode s4c_get_render_mode(void);
+int s4c_render_rows(int frameheight);
+
+int s4c_color_pair(int fg_color_index, int bg_color_index);
+void s4c_reset_color_pairs_cache(void);
+
+/**
+ * Holds the next absolute deadline of a paced loop, on the monotonic clock.
+ * Each wait advances the deadline by the frametime instead of sleeping for it,
+ * so that time spent drawing does not accumulate as drift.
+ * @see s4c_pacer_start()
+ * @see s4c_pacer_wait()
+ */
+typedef struct S4C_Pacer {
+    uint64_t deadline_ns; /**< Next deadline, in nanoseconds from s4c_now_ns().*/
+} S4C_Pacer;
+
+/**
+ * Holds stats about how late paced loops woke up from their deadlines.
+ * @see s4c_get_pacing_stats()
+ */
+typedef struct S4C_Pacing_Stats {
+    unsigned long frames; /**< How many deadlines were waited for.*/
+    unsigned long missed; /**< How many deadlines had already passed by more than a frame, causing a resync.*/
+    unsigned long skipped; /**< How many frames were skipped by s4c_pacer_next_frame() to stay on time.*/
+    int64_t max_late_ns; /**< Highest wakeup delay past a deadline.*/
+    int64_t total_late_ns; /**< Sum of wakeup delays past deadlines.*/
+    double total_late_sq; /**< Sum of squared wakeup delays, in squared milliseconds.*/
+} S4C_Pacing_Stats;
+
+uint64_t s4c_now_ns(void);
+int s4c_sleep_until_ns(uint64_t deadline_ns);
+void s4c_pacer_start(S4C_Pacer* pacer);
+void s4c_pacer_wait(S4C_Pacer* pacer, int frametime);
+int s4c_pacer_next_frame(S4C_Pacer* pacer, const int durations[], int frame_index, int last_frame, int frametime);
+void s4c_get_pacing_stats(S4C_Pacing_Stats* stats);
+void s4c_reset_pacing_stats(void);
+double s4c_pacing_jitter_ms(const S4C_Pacing_Stats* stats);
+
 void test_s4c_color_pairs(WINDOW* win);
 
+/**
+ * Defines a rectangle of cells.
+ * @see s4c_set_clip_rect()
+ * @see s4c_visible_rect()
+ */
+typedef struct S4C_Rect {
+    int x; /**< X coord of the upper left corner.*/
+    int y; /**< Y coord of the upper left corner.*/
+    int width; /**< Width of the rectangle.*/
+    int height; /**< Height of the rectangle.*/
+} S4C_Rect;
+
+void s4c_set_clip_rect(const S4C_Rect* clip);
+bool s4c_get_clip_rect(S4C_Rect* clip);
+bool s4c_visible_rect(WINDOW* win, int rows, int cols, int startX, int startY, S4C_Rect* visible);
+
 int s4c_check_term(void);
 int s4c_check_win(WINDOW* win, int rows, int cols, int startX, int startY);
 
 void slideshow_s4c_color_pairs(WINDOW* win);
 
 void s4c_print_spriteline(WINDOW* win, char* line, int curr_line_num, int line_length, int startX);
+void s4c_print_spriteline_halfblock(WINDOW* win, char* upper_line, char* lower_line, int curr_line_num, int line_length, int startX);
 
 int s4c_animate_sprites(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int repetitions, int frametime, int num_frames, int frameheight, int framewidth);
 
@@ -258,9 +779,346 @@ int s4c_animate_sprites_at_coords(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WIND
 
 int s4c_animate_rangeof_sprites_at_coords(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY);
 
+int s4c_animate_rangeof_sprites_timed_at_coords(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], const int durations[], WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY);
+
 int s4c_display_sprite_at_coords_checked(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int sprite_index, WINDOW* w, int num_frames, int frameheight, int framewidth, int startX, int startY);
 int s4c_display_sprite_at_coords_unchecked(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int sprite_index, WINDOW* w, int num_frames, int frameheight, int framewidth, int startX, int startY);
 int s4c_display_sprite_at_coords(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int sprite_index, WINDOW* w, int num_frames, int frameheight, int framewidth, int startX, int startY);
+int s4c_display_sprite_at_coords_clipped(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int sprite_index, WINDOW* w, int num_frames, int frameheight, int framewidth, int startX, int startY);
+int s4c_display_instances(WINDOW* w, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int num_frames, const S4C_Instance_State* states, int count, int frameheight, int framewidth);
+int s4c_animate_rangeof_sprites_at_coords_clipped(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY);
+
+int s4c_display_frame_view_at_coords(const S4C_Frame_View* view, WINDOW* w, int startX, int startY);
+int s4c_animate_index_plane_at_coords(const S4C_Index_Plane* plane, WINDOW* w, S4C_Transform transform, int repetitions, int frametime, int startX, int startY);
+int s4c_display_packed_frame_at_coords(const S4C_Packed_Plane* packed, int frame_index, S4C_Transform transform, WINDOW* w, int startX, int startY);
+int s4c_animate_packed_plane_at_coords(const S4C_Packed_Plane* packed, WINDOW* w, S4C_Transform transform, int repetitions, int frametime, int startX, int startY);
+int s4c_display_sprite_transformed_at_coords(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int sprite_index, S4C_Transform transform, WINDOW* w, int num_frames, int frameheight, int framewidth, int startX, int startY);
+int s4c_animate_rangeof_sprites_transformed_at_coords(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int fromFrame, int toFrame, S4C_Transform transform, int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY);
+
+/**
+ * Defines how many changed tiles a S4C_Tilemap redraws on their own. Past that, the next draw redraws the whole viewport.
+ */
+#define S4C_TILEMAP_MAX_DIRTY 64
+
+/**
+ * Holds a grid of tile ids, each referencing a frame of a sprites array, and the camera used to draw it.
+ * Only tiles intersecting the viewport window are drawn. When the camera moves by less than the viewport,
+ * already drawn cells are shifted with wscrl() or copywin() and only the exposed strips are redrawn.
+ * @see s4c_tilemap_init()
+ * @see s4c_tilemap_draw()
+ */
+typedef struct S4C_Tilemap {
+    WINDOW* win; /**< Viewport window. The whole window is used, no box is drawn.*/
+    WINDOW* scratch; /**< Offscreen window used by copywin() to shift drawn cells.*/
+    char (*tiles)[S4C_MAXROWS][S4C_MAXCOLS]; /**< Sprites array holding the tile frames.*/
+    int num_tiles; /**< How many tile frames there are.*/
+    int tile_height; /**< Height of each tile frame.*/
+    int tile_width; /**< Width of each tile frame.*/
+    int map_rows; /**< Height of the map, in tiles.*/
+    int map_cols; /**< Width of the map, in tiles.*/
+    short* ids; /**< Tile ids, row-major. Negative ids are empty tiles.*/
+    int camera_x; /**< X coord of the map cell shown at the left of the viewport.*/
+    int camera_y; /**< Y coord of the map cell shown at the top of the viewport.*/
+    bool drawn; /**< True if the viewport holds the cells at drawn_x, drawn_y.*/
+    int drawn_x; /**< Camera X coord of the last draw.*/
+    int drawn_y; /**< Camera Y coord of the last draw.*/
+    int drawn_rows; /**< Viewport height at the last draw.*/
+    int drawn_cols; /**< Viewport width at the last draw.*/
+    S4C_Render_Mode drawn_mode; /**< Render mode of the last draw.*/
+    unsigned long tiles_drawn; /**< How many tiles were drawn, in total.*/
+    int dirty_count; /**< How many tiles are listed in dirty.*/
+    int dirty[S4C_TILEMAP_MAX_DIRTY]; /**< Map indexes of the tiles changed since the last draw.*/
+} S4C_Tilemap;
+
+int s4c_tilemap_init(S4C_Tilemap* map, WINDOW* win, char tiles[][S4C_MAXROWS][S4C_MAXCOLS], int num_tiles, int tile_height, int tile_width, int map_rows, int map_cols);
+int s4c_tilemap_set(S4C_Tilemap* map, int row, int col, short tile_id);
+short s4c_tilemap_get(const S4C_Tilemap* map, int row, int col);
+void s4c_tilemap_set_camera(S4C_Tilemap* map, int x, int y);
+void s4c_tilemap_move_camera(S4C_Tilemap* map, int dx, int dy);
+void s4c_tilemap_invalidate(S4C_Tilemap* map);
+int s4c_tilemap_draw(S4C_Tilemap* map);
+void s4c_tilemap_free(S4C_Tilemap* map);
+
+/**
+ * Holds an animation driven by a S4C_Scheduler or a S4C_Player, and its playback state.
+ * @see s4c_scheduler_add()
+ */
+typedef struct S4C_Scheduled_Animation {
+    WINDOW* win; /**< WINDOW to animate to. NULL for a free slot.*/
+    char (*sprites)[S4C_MAXROWS][S4C_MAXCOLS]; /**< Array for the animation.*/
+    const int* durations; /**< How many mseconds each frame is displayed, or NULL to always use frametime.*/
+    S4C_Frame_Store* store; /**< Shared store holding the frames, released with the animation, or NULL.*/
+    int fromFrame; /**< First frame of the animated range.*/
+    int toFrame; /**< Last frame of the animated range, included.*/
+    int repetitions; /**< How many times the range is cycled through. 0 loops until removed.*/
+    int frametime; /**< How many mseconds each frame is displayed, when it has no duration.*/
+    int frameheight; /**< Height of the frames.*/
+    int framewidth; /**< Width of the frames.*/
+    int startX; /**< Starting X value to print at.*/
+    int startY; /**< Starting Y value to print at.*/
+    int current_frame; /**< Index of the next frame to draw.*/
+    int prev_frame; /**< Index of the frame currently shown, or -1.*/
+    int current_rep; /**< How many cycles were completed.*/
+    uint64_t deadline_ns; /**< When the current frame is due, in nanoseconds from s4c_now_ns().*/
+    int heap_pos; /**< Position in the deadline heap.*/
+    int priority; /**< When output falls behind, lower priorities skip frames first.*/
+    unsigned long draw_seq; /**< Draw count of the S4C_Scheduler when this animation was last drawn, to rotate between equal priorities.*/
+    unsigned long frames_drawn; /**< How many frames were drawn.*/
+    unsigned long skipped; /**< How many frames were skipped to stay on time.*/
+} S4C_Scheduled_Animation;
+
+/**
+ * Drives many animations from a single thread, each with its own frametime and position.
+ * Next-frame deadlines are kept in a binary min-heap, so each step only touches the animations that are due,
+ * and all of their windows are flushed with one doupdate().
+ * @see s4c_scheduler_init()
+ * @see s4c_scheduler_step()
+ * @see s4c_scheduler_run()
+ */
+typedef struct S4C_Scheduler {
+    S4C_Scheduled_Animation* slots; /**< Animation slots, indexed by the ids returned by s4c_scheduler_add().*/
+    int* heap; /**< Slot indexes, as a min-heap on their deadlines.*/
+    int capacity; /**< How many slots are allocated.*/
+    int count; /**< How many animations are scheduled.*/
+    unsigned long frames_drawn; /**< How many frames were drawn, in total.*/
+    unsigned long skipped; /**< How many frames were skipped to stay on time, in total.*/
+    uint64_t frame_cost_ns; /**< Moving average of the time taken to output a frame.*/
+    int timer_fd; /**< Timer armed at the earliest deadline, or -1 until s4c_scheduler_timer_fd() is called.*/
+} S4C_Scheduler;
+
+int s4c_scheduler_init(S4C_Scheduler* sched, int capacity);
+int s4c_scheduler_add(S4C_Scheduler* sched, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY);
+int s4c_scheduler_add_shared(S4C_Scheduler* sched, S4C_Frame_Store* store, WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int startX, int startY);
+int s4c_scheduler_set_durations(S4C_Scheduler* sched, int id, const int durations[]);
+int s4c_scheduler_set_priority(S4C_Scheduler* sched, int id, int priority);
+int s4c_scheduler_remove(S4C_Scheduler* sched, int id);
+bool s4c_scheduler_is_active(const S4C_Scheduler* sched, int id);
+uint64_t s4c_scheduler_next_deadline(const S4C_Scheduler* sched);
+int s4c_scheduler_step(S4C_Scheduler* sched, uint64_t now_ns);
+int s4c_scheduler_run(S4C_Scheduler* sched, int duration);
+void s4c_scheduler_invalidate(S4C_Scheduler* sched);
+int s4c_scheduler_timer_fd(S4C_Scheduler* sched);
+int s4c_scheduler_dispatch(S4C_Scheduler* sched);
+void s4c_scheduler_free(S4C_Scheduler* sched);
+
+/**
+ * Holds a single animation played by s4c_player_tick(), for callers running their own event loop.
+ * Nothing sleeps inside the library: each tick draws the frame due, if any, and returns the next deadline.
+ * @see s4c_player_init()
+ * @see s4c_player_tick()
+ */
+typedef struct S4C_Player {
+    S4C_Scheduled_Animation anim; /**< The animation, its playback state and frame counters.*/
+} S4C_Player;
+
+int s4c_player_init(S4C_Player* player, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY);
+int s4c_player_init_shared(S4C_Player* player, S4C_Frame_Store* store, WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int startX, int startY);
+void s4c_player_set_durations(S4C_Player* player, const int durations[]);
+uint64_t s4c_player_tick(S4C_Player* player, uint64_t now_ns);
+bool s4c_player_done(const S4C_Player* player, uint64_t now_ns);
+void s4c_player_invalidate(S4C_Player* player);
+void s4c_player_free(S4C_Player* player);
+int s4c_deadline_timeout_ms(uint64_t deadline_ns, uint64_t now_ns);
+
+/**
+ * Defines the states of an animation played by a S4C_Animation_Handle.
+ * @see s4c_animation_get_state()
+ */
+typedef enum S4C_Animation_State {
+    S4C_ANIMATION_RUNNING = 0,
+    S4C_ANIMATION_PAUSED,
+    S4C_ANIMATION_DONE, /**< Completed its repetitions.*/
+    S4C_ANIMATION_STOPPED,
+} S4C_Animation_State;
+
+/**
+ * Opaque handle to an animation played on its own thread.
+ * Pause, seek and stop requests wake the thread immediately, instead of waiting for the current frame to end.
+ * @see s4c_animation_start()
+ * @see s4c_animation_stop()
+ */
+typedef struct S4C_Animation_Handle S4C_Animation_Handle;
+
+int s4c_animation_start(S4C_Animation_Handle** handle, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY);
+int s4c_animation_start_shared(S4C_Animation_Handle** handle, S4C_Frame_Store* store, WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int startX, int startY);
+void s4c_animation_set_durations(S4C_Animation_Handle* handle, const int durations[]);
+int s4c_animation_pause(S4C_Animation_Handle* handle);
+int s4c_animation_resume(S4C_Animation_Handle* handle);
+int s4c_animation_seek(S4C_Animation_Handle* handle, int frame_index);
+S4C_Animation_State s4c_animation_get_state(S4C_Animation_Handle* handle);
+int s4c_animation_get_frame(S4C_Animation_Handle* handle);
+void s4c_animation_wait(S4C_Animation_Handle* handle);
+void s4c_animation_stop(S4C_Animation_Handle* handle);
+
+/**
+ * Defines the commands executed by the render thread of a S4C_Render_Queue.
+ * @see S4C_Render_Command
+ */
+typedef enum S4C_Render_Command_Type {
+    S4C_RENDER_FRAME = 0, /**< Draws a frame, only printing the spans changed from prev_frame.*/
+    S4C_RENDER_CLEAR, /**< Clears the window.*/
+    S4C_RENDER_CALL, /**< Calls a function with the window, for any other ncurses output.*/
+} S4C_Render_Command_Type;
+
+/**
+ * Holds a command for the render thread of a S4C_Render_Queue. Copied into the queue on submission.
+ * @see s4c_render_queue_submit()
+ */
+typedef struct S4C_Render_Command {
+    S4C_Render_Command_Type type; /**< What to execute.*/
+    WINDOW* win; /**< WINDOW to output to, refreshed after the command. May be NULL for S4C_RENDER_CALL.*/
+    char (*sprites)[S4C_MAXROWS][S4C_MAXCOLS]; /**< Array holding the frame, or NULL to use the frames in store.*/
+    S4C_Frame_Store* store; /**< Store holding the frame, referenced until the command is executed, or NULL.*/
+    int frame_index; /**< Frame to draw.*/
+    int prev_frame; /**< Frame on screen at the same coords, or -1 to draw the whole frame.*/
+    int frameheight; /**< Height of the frame.*/
+    int framewidth; /**< Width of the frame.*/
+    int startX; /**< X coord of the window to start printing to.*/
+    int startY; /**< Y coord of the window to start printing to.*/
+    bool boxed; /**< Draws a box around the window before the frame.*/
+    void (*call)(WINDOW* win, void* arg); /**< Function called by S4C_RENDER_CALL.*/
+    void* arg; /**< Argument passed to call.*/
+} S4C_Render_Command;
+
+/**
+ * Holds counters for a S4C_Render_Queue.
+ * @see s4c_render_queue_stats()
+ */
+typedef struct S4C_Render_Queue_Stats {
+    unsigned long submitted; /**< How many commands were accepted.*/
+    unsigned long executed; /**< How many commands were executed.*/
+    unsigned long batches; /**< How many times the render thread called doupdate().*/
+    unsigned long full; /**< How many commands were rejected because the queue was full.*/
+} S4C_Render_Queue_Stats;
+
+/**
+ * Opaque handle to a render thread owning all ncurses output, fed by a lock-free ring of S4C_Render_Command.
+ * Any thread can submit commands without blocking. The render thread executes them in order, in batches flushed with one doupdate().
+ * @see s4c_render_queue_start()
+ * @see s4c_render_queue_submit()
+ * @see s4c_render_queue_stop()
+ */
+typedef struct S4C_Render_Queue S4C_Render_Queue;
+
+int s4c_render_queue_start(S4C_Render_Queue** queue, int capacity);
+int s4c_render_queue_submit(S4C_Render_Queue* queue, const S4C_Render_Command* cmd);
+int s4c_render_queue_submit_frame(S4C_Render_Queue* queue, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], WINDOW* w, int frame_index, int prev_frame, int frameheight, int framewidth, int startX, int startY);
+void s4c_render_queue_flush(S4C_Render_Queue* queue);
+void s4c_render_queue_stats(S4C_Render_Queue* queue, S4C_Render_Queue_Stats* stats);
+void s4c_render_queue_stop(S4C_Render_Queue* queue);
+int s4c_animation_start_queued(S4C_Animation_Handle** handle, S4C_Render_Queue* queue, S4C_Frame_Store* store, WINDOW* w, int fromFrame, int toFrame, int repetitions, int frametime, int startX, int startY);
+
+/**
+ * Defines the kinds of target s4c can draw sprites to.
+ * @see S4C_Target
+ */
+typedef enum S4C_Target_Kind {
+    S4C_TARGET_NCURSES = 0, /**< Draws to a WINDOW, using ncurses color pairs.*/
+    S4C_TARGET_ANSI, /**< Encodes frames as 24-bit ANSI escape sequences and writes them to a file descriptor, bypassing ncurses.*/
+    S4C_TARGET_HEADLESS, /**< Draws to an in-memory grid of S4C_Cell, with no terminal involved.*/
+} S4C_Target_Kind;
+
+/**
+ * Holds the state for a S4C_TARGET_ANSI target.
+ * @see s4c_target_ansi_init()
+ */
+typedef struct S4C_Ansi_Target {
+    int fd; /**< File descriptor frames are written to.*/
+    int origin_x; /**< Terminal column (0-based) of the upper-left corner of the target.*/
+    int origin_y; /**< Terminal row (0-based) of the upper-left corner of the target.*/
+    int rows; /**< Height of the target, in terminal rows.*/
+    int cols; /**< Width of the target, in terminal columns.*/
+    S4C_Color* palette; /**< Palette used to map sprite chars to 24-bit colors.*/
+    int palette_size; /**< Size of the palette.*/
+    char* buffer; /**< Preallocated buffer a whole frame is encoded into.*/
+    size_t buffer_size; /**< Capacity of the buffer.*/
+    size_t buffer_len; /**< Bytes currently encoded in the buffer.*/
+    int* shadow; /**< Last colors written to each cell, used to skip unchanged cells. Negative for unknown.*/
+    bool shadow_stale; /**< Set when the screen was written without updating the shadow.*/
+    unsigned long generation; /**< Bumped on resize and palette change, used to invalidate encoded frames.*/
+    unsigned long screen_epoch; /**< Bumped when the target is invalidated.*/
+} S4C_Ansi_Target;
+
+/**
+ * Holds the content of a cell of a S4C_TARGET_HEADLESS target.
+ */
+typedef struct S4C_Cell {
+    int ch; /**< Codepoint drawn in the cell: ' ' for S4C_RENDER_FULLBLOCK, 0x2580 or 0x2584 for S4C_RENDER_HALFBLOCK, 0 if never drawn.*/
+    short pair; /**< Color pair index as used by s4c_print_spriteline(), which is also the foreground color index.*/
+    short bg; /**< Background color index for S4C_RENDER_HALFBLOCK cells, as passed to s4c_color_pair(). -1 for the default background.*/
+    attr_t attrs; /**< Attributes the cell was drawn with.*/
+} S4C_Cell;
+
+/**
+ * Holds the state for a S4C_TARGET_HEADLESS target.
+ * @see s4c_target_headless_init()
+ */
+typedef struct S4C_Headless_Target {
+    int rows; /**< Height of the grid.*/
+    int cols; /**< Width of the grid.*/
+    S4C_Cell* cells; /**< The grid, row-major.*/
+    unsigned long frames_drawn; /**< How many frames were drawn.*/
+    unsigned long cells_drawn; /**< How many cells were written.*/
+} S4C_Headless_Target;
+
+/**
+ * Holds a target to draw sprites to, selectable at runtime.
+ * @see s4c_target_ncurses()
+ * @see s4c_target_ansi_init()
+ */
+typedef struct S4C_Target {
+    S4C_Target_Kind kind; /**< Kind of the target.*/
+    WINDOW* win; /**< WINDOW to draw to, for S4C_TARGET_NCURSES.*/
+    S4C_Ansi_Target ansi; /**< State for S4C_TARGET_ANSI.*/
+    S4C_Headless_Target headless; /**< State for S4C_TARGET_HEADLESS.*/
+} S4C_Target;
+
+S4C_Target s4c_target_ncurses(WINDOW* win);
+int s4c_target_ansi_init(S4C_Target* target, int fd, int origin_x, int origin_y, int rows, int cols, S4C_Color* palette, int palette_size);
+int s4c_target_headless_init(S4C_Target* target, int rows, int cols);
+const S4C_Cell* s4c_target_cell_at(const S4C_Target* target, int y, int x);
+void s4c_target_invalidate(S4C_Target* target);
+void s4c_target_free(S4C_Target* target);
+
+int s4c_target_display_sprite_at_coords(S4C_Target* target, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int sprite_index, int num_frames, int frameheight, int framewidth, int startX, int startY);
+int s4c_target_animate_sprites_at_coords(S4C_Target* target, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY);
+int s4c_target_animate_rangeof_sprites_at_coords(S4C_Target* target, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int fromFrame, int toFrame, int repetitions, int frametime, int num_frames, int frameheight, int framewidth, int startX, int startY);
+int s4c_target_ansi_resize(S4C_Target* target, int rows, int cols);
+int s4c_target_ansi_set_palette(S4C_Target* target, S4C_Color* palette, int palette_size);
+
+/**
+ * Holds the encoded byte streams of an animation played at a fixed position on a S4C_TARGET_ANSI target.
+ * Blobs are encoded the first time each frame is played, then replayed with no per-cell work.
+ * For each frame, both the full frame and the delta from the previous frame are kept.
+ * @see s4c_blob_cache_init()
+ */
+typedef struct S4C_Blob_Cache {
+    S4C_Target* target; /**< The S4C_TARGET_ANSI target the blobs are written to.*/
+    char (*sprites)[S4C_MAXROWS][S4C_MAXCOLS]; /**< The sprites array, not copied.*/
+    int num_frames; /**< Index of the last frame of the animation, as for s4c_animate_sprites_at_coords().*/
+    int frameheight; /**< Height of the frames.*/
+    int framewidth; /**< Width of the frames.*/
+    int startX; /**< X coord of the target the animation is played at.*/
+    int startY; /**< Y coord of the target the animation is played at.*/
+    size_t max_bytes; /**< Memory budget for the blobs. 0 means no limit.*/
+    size_t bytes; /**< Memory currently held by the cache.*/
+    S4C_Render_Mode render_mode; /**< Render mode the blobs were encoded with.*/
+    unsigned long generation; /**< Target generation the blobs were encoded for.*/
+    unsigned long screen_epoch; /**< Target screen epoch last_frame refers to.*/
+    int last_frame; /**< Last frame played, -1 if the screen content is unknown.*/
+    char** full; /**< Blob drawing each whole frame.*/
+    size_t* full_len; /**< Length of each full blob.*/
+    char** delta; /**< Blob drawing each frame over the previous one, wrapping around.*/
+    size_t* delta_len; /**< Length of each delta blob.*/
+} S4C_Blob_Cache;
+
+int s4c_blob_cache_init(S4C_Blob_Cache* cache, S4C_Target* target, char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int num_frames, int frameheight, int framewidth, int startX, int startY, size_t max_bytes);
+void s4c_blob_cache_invalidate(S4C_Blob_Cache* cache);
+void s4c_blob_cache_free(S4C_Blob_Cache* cache);
+size_t s4c_blob_cache_bytes(const S4C_Blob_Cache* cache);
+int s4c_blob_cache_play_frame(S4C_Blob_Cache* cache, int frame_index);
+int s4c_blob_caches_play_frames(S4C_Blob_Cache* caches[], const int frame_indexes[], int count);
+int s4c_blob_cache_animate(S4C_Blob_Cache* cache, int repetitions, int frametime);
 
 #ifdef S4C_EXPERIMENTAL
 int s4c_display_frame(S4C_Animation* src, int frame_index, WINDOW* w, int num_frames, int frameheight, int framewidth, int startX, int startY);
@@ -270,6 +1128,8 @@ void s4c_free_animation(S4C_Animation* animation, int frames, int rows);
 #endif
 
 int s4c_load_sprites(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], FILE* file, int frames, int rows, int columns);
+int s4c_load_sprites_stats(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], FILE* file, int frames, int rows, int columns, S4C_Diff_Stats* stats);
+int s4c_load_sprites_timed(char sprites[][S4C_MAXROWS][S4C_MAXCOLS], int durations[], FILE* file, int frames, int rows, int columns);
 void s4c_copy_animation(char source[][S4C_MAXROWS][S4C_MAXCOLS], char dest[S4C_MAXFRAMES][S4C_MAXROWS][S4C_MAXCOLS], int frames, int rows, int cols);
 #ifdef S4C_RAYLIB_EXTENSION
 #ifndef RAYLIB_H
@@ -281,12 +1141,16 @@ Color color_from_s4c_color(S4C_Color c);
 #define ColorFromS4CPalette(palette, idx) color_from_s4c_color((palette)[(idx) - S4C_BASE_COLOR_INDEX]) /**< Macro to retrieve a Color from S4C_Color palette by index.*/
 //void s4rl_print_spriteline(char* line, int coordY, int line_length, int startX, int pixelSize, S4C_Color* palette, int palette_size);
 void s4rl_draw_sprite_at_coords(char sprite[][S4C_MAXCOLS], int frameheight, int framewidth, int startX, int startY, int pixelSize, S4C_Color* palette, int palette_size);
+void s4rl_draw_frame_view_at_coords(const S4C_Frame_View* view, int startX, int startY, int pixelSize, S4C_Color* palette, int palette_size);
+void s4rl_draw_packed_frame_at_coords(const S4C_Packed_Plane* packed, int frame_index, S4C_Transform transform, int startX, int startY, int pixelSize, S4C_Color* palette, int palette_size);
 int s4rl_draw_sprite_at_rect(char sprite[][S4C_MAXCOLS], Rectangle rect, int frameheight, int framewidth, int pixelSize, S4C_Color* palette, int palette_size);
 #define DrawSprite(sprite, height, width, pixelsize, palette, palette_size) s4rl_draw_sprite_at_coords((sprite),(height),(width),0,0,(pixelsize),(palette),(palette_size))
 #define DrawSpriteRect(sprite, rect, height, width, pixelsize, palette, palette_size) s4rl_draw_sprite_at_rect((sprite),(rect),(height),(width),(pixelsize),(palette),(palette_size))
 int s4rl_draw_sprite_at_rect_V(char sprite[][S4C_MAXCOLS], Rectangle rect, Vector2 framesize, int pixelSize, S4C_Color* palette, int palette_size);
 int s4rl_draw_s4c_sprite_at_rect(S4C_Sprite sprite, Rectangle rect, int pixelSize);
 #define DrawS4CSpriteRect(sprite, rect, pixelsize) s4rl_draw_s4c_sprite_at_rect((sprite),(rect),(pixelsize))
+int s4rl_draw_sprite_ref_at_rect(S4C_Sprite_Ref sprite, Rectangle rect, int pixelSize);
+#define DrawS4CSpriteRefRect(sprite, rect, pixelsize) s4rl_draw_sprite_ref_at_rect((sprite),(rect),(pixelsize))
 #endif // S4C_RAYLIB_EXTENSION
 
 #endif // S4C_ANIMATE_H